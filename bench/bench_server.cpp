@@ -0,0 +1,194 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/connection_balancer.hpp"
+#include "co_http_uring/request.hpp"
+#include "co_http_uring/response_writer.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/socket_address.hpp"
+#include "co_http_uring/status_code.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/wait_policy.hpp"
+
+#include <fmt/core.h>
+
+#include <charconv>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <netinet/in.h>
+}
+
+namespace co_http_uring::bench {
+
+namespace {
+
+constexpr std::string_view USAGE =
+    "usage: co_http_uring_bench_server [options]\n"
+    "  --port=PORT            port to listen on (8000)\n"
+    "  --threads=N            servers to run with SO_REUSEPORT (1)\n"
+    "  --max-connections=N    connections per server (1024)\n"
+    "  --max-imbalance=N      hand connections to less loaded servers once\n"
+    "                         a server has N more than the least loaded one\n"
+    "  --wait=MODE            block, batch, spin or adaptive (block)\n"
+    "  --min-completions=N    completions a batch waits for (1)\n"
+    "  --max-wait-us=T        longest a batch waits for, in us (0)\n"
+    "  --spin-us=T            longest to spin for, in us (0)\n"
+    "  --h2c                  also serve HTTP/2 over cleartext\n";
+
+constexpr std::string_view RESPONSE_BODY = "Hello, world!\n";
+
+struct Options {
+    u16 port = 8000;
+    int threads = 1;
+    int max_connections = 1024;
+    std::optional<u32> max_imbalance;
+    WaitPolicy wait_policy;
+    bool h2c = false;
+};
+
+template <typename T>
+bool parse_number(std::string_view str, T &value) {
+    auto result = std::from_chars(str.data(), str.data() + str.size(), value);
+    return result.ec == std::errc{} && result.ptr == str.data() + str.size();
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if (arg.starts_with("--port=")) {
+            if (!parse_number(arg.substr(7), options.port)) {
+                return false;
+            }
+        } else if (arg.starts_with("--threads=")) {
+            if (!parse_number(arg.substr(10), options.threads) ||
+                options.threads <= 0) {
+                return false;
+            }
+        } else if (arg.starts_with("--max-connections=")) {
+            if (!parse_number(arg.substr(18), options.max_connections) ||
+                options.max_connections < 2) {
+                return false;
+            }
+        } else if (arg.starts_with("--max-imbalance=")) {
+            u32 max_imbalance{};
+
+            if (!parse_number(arg.substr(16), max_imbalance)) {
+                return false;
+            }
+
+            options.max_imbalance = max_imbalance;
+        } else if (arg.starts_with("--wait=")) {
+            std::string_view mode = arg.substr(7);
+
+            if (mode == "block") {
+                options.wait_policy.mode = WaitPolicy::Mode::BLOCK;
+            } else if (mode == "batch") {
+                options.wait_policy.mode = WaitPolicy::Mode::BATCH;
+            } else if (mode == "spin") {
+                options.wait_policy.mode = WaitPolicy::Mode::SPIN;
+            } else if (mode == "adaptive") {
+                options.wait_policy.mode = WaitPolicy::Mode::ADAPTIVE;
+            } else {
+                return false;
+            }
+        } else if (arg.starts_with("--min-completions=")) {
+            WaitPolicy &policy = options.wait_policy;
+
+            if (!parse_number(arg.substr(18), policy.min_completions)) {
+                return false;
+            }
+        } else if (arg.starts_with("--max-wait-us=")) {
+            u32 max_wait{};
+
+            if (!parse_number(arg.substr(14), max_wait)) {
+                return false;
+            }
+
+            options.wait_policy.max_wait = std::chrono::microseconds{max_wait};
+        } else if (arg.starts_with("--spin-us=")) {
+            u32 spin_duration{};
+
+            if (!parse_number(arg.substr(10), spin_duration)) {
+                return false;
+            }
+
+            options.wait_policy.spin_duration =
+                std::chrono::microseconds{spin_duration};
+        } else if (arg == "--h2c") {
+            options.h2c = true;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Task<> handle_request(const Request &, ResponseWriter res) {
+    co_await res.write_status(StatusCode::OK);
+    co_await res.write_header("Content-Type", "text/plain");
+    co_await res.write_body(RESPONSE_BODY);
+    co_await res.send();
+}
+
+void run_server(
+    const Options &options,
+    const std::shared_ptr<ConnectionBalancer> &balancer
+) {
+    // The fixed file table holds twice as many descriptors as the listen
+    // backlog.
+    int max_pending_conns = options.max_connections / 2;
+    Server server{
+        handle_request,
+        static_cast<unsigned int>(4 * max_pending_conns + 2),
+    };
+    server.set_connection_balancer(balancer);
+    server.set_wait_policy(options.wait_policy);
+    server.set_h2c(options.h2c);
+    server.run(Ipv4Address{INADDR_LOOPBACK, options.port}, max_pending_conns);
+}
+
+} // namespace
+
+} // namespace co_http_uring::bench
+
+int main(int argc, char **argv) {
+    using namespace co_http_uring::bench;
+
+    Options options;
+
+    if (!parse_options(argc, argv, options)) {
+        fmt::print(stderr, "{}", USAGE);
+        return EXIT_FAILURE;
+    }
+
+    std::shared_ptr<co_http_uring::ConnectionBalancer> balancer;
+
+    if (options.max_imbalance) {
+        balancer = std::make_shared<co_http_uring::ConnectionBalancer>(
+            options.threads,
+            *options.max_imbalance
+        );
+    }
+
+    std::vector<std::jthread> threads;
+
+    for (int i = 0; i < options.threads; i++) {
+        threads.emplace_back([&options, &balancer] {
+            run_server(options, balancer);
+        });
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/http_utils.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <string_view>
+
+namespace co_http_uring {
+
+namespace {
+
+constexpr std::string_view SHORT_TOKEN = "Host";
+constexpr std::string_view LONG_TOKEN = "X-Forwarded-For-Original-Client-Addr";
+constexpr std::string_view FIELD_VALUE =
+    "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8";
+
+void BM_IsToken(benchmark::State &state, std::string_view token) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(http_utils::is_token(token));
+    }
+
+    state.SetBytesProcessed(state.iterations() * token.size());
+}
+
+void BM_IsFieldValue(benchmark::State &state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(http_utils::is_field_value(FIELD_VALUE));
+    }
+
+    state.SetBytesProcessed(state.iterations() * FIELD_VALUE.size());
+}
+
+void BM_MakeHeaderName(benchmark::State &state, std::string_view name) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(http_utils::make_header_name(name));
+    }
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_IsToken, short, SHORT_TOKEN);
+BENCHMARK_CAPTURE(BM_IsToken, long, LONG_TOKEN);
+BENCHMARK(BM_IsFieldValue);
+BENCHMARK_CAPTURE(BM_MakeHeaderName, short, SHORT_TOKEN);
+BENCHMARK_CAPTURE(BM_MakeHeaderName, long, LONG_TOKEN);
+
+} // namespace co_http_uring
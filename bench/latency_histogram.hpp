@@ -0,0 +1,99 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_BENCH_LATENCY_HISTOGRAM_HPP
+#define CO_HTTP_URING_BENCH_LATENCY_HISTOGRAM_HPP
+
+#include "co_http_uring/types.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace co_http_uring::bench {
+
+// Log-linear histogram in the style of HdrHistogram: every power of two is
+// split into 2^SUB_BUCKET_BITS linear sub-buckets, which bounds the relative
+// error of any reported value to under 1%.
+class LatencyHistogram {
+    static constexpr int SUB_BUCKET_BITS = 7;
+    static constexpr u64 SUB_BUCKET_COUNT = u64{1} << SUB_BUCKET_BITS;
+    static constexpr int MAX_VALUE_BITS = 48;
+
+    std::vector<u64> counts_;
+    u64 total_count_{};
+    u64 max_value_{};
+
+    static std::size_t bucket_index(u64 value) {
+        if (value < SUB_BUCKET_COUNT) {
+            return value;
+        }
+
+        int shift = std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+        u64 sub_bucket = (value >> shift) - SUB_BUCKET_COUNT;
+        return SUB_BUCKET_COUNT + shift * SUB_BUCKET_COUNT + sub_bucket;
+    }
+
+    static u64 highest_equivalent_value(std::size_t index) {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+
+        u64 shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+        u64 sub_bucket = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+        u64 lowest = (SUB_BUCKET_COUNT + sub_bucket) << shift;
+        return lowest + (u64{1} << shift) - 1;
+    }
+
+public:
+    LatencyHistogram() :
+        counts_(bucket_index((u64{1} << MAX_VALUE_BITS) - 1) + 1) {}
+
+    void record(u64 value) {
+        value = std::min(value, (u64{1} << MAX_VALUE_BITS) - 1);
+        counts_[bucket_index(value)]++;
+        total_count_++;
+        max_value_ = std::max(max_value_, value);
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (std::size_t i = 0; i < counts_.size(); i++) {
+            counts_[i] += other.counts_[i];
+        }
+
+        total_count_ += other.total_count_;
+        max_value_ = std::max(max_value_, other.max_value_);
+    }
+
+    [[nodiscard]] u64 total_count() const { return total_count_; }
+
+    [[nodiscard]] u64 max_value() const { return max_value_; }
+
+    [[nodiscard]] u64 value_at_percentile(double percentile) const {
+        if (total_count_ == 0) {
+            return 0;
+        }
+
+        auto target = static_cast<u64>(
+            std::ceil(percentile / 100.0 * static_cast<double>(total_count_))
+        );
+        target = std::clamp<u64>(target, 1, total_count_);
+        u64 seen = 0;
+
+        for (std::size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+
+            if (seen >= target) {
+                return std::min(highest_equivalent_value(i), max_value_);
+            }
+        }
+
+        return max_value_;
+    }
+};
+
+} // namespace co_http_uring::bench
+
+#endif // CO_HTTP_URING_BENCH_LATENCY_HISTOGRAM_HPP
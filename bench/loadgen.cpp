@@ -0,0 +1,648 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "latency_histogram.hpp"
+
+#include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/socket_address.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+extern "C" {
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+using namespace std::literals::chrono_literals;
+
+namespace co_http_uring::bench {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr u64 DATA_TIMER = ~u64{0};
+constexpr u64 OP_SEND = 0;
+constexpr u64 OP_RECV = 1;
+constexpr std::size_t RECV_BUFFER_SIZE = 64 * 1024;
+constexpr std::chrono::microseconds MIN_TIMER_INTERVAL = 50us;
+
+constexpr std::string_view USAGE =
+    "usage: co_http_uring_loadgen [options]\n"
+    "  --host=ADDR         IPv4 address of the server (127.0.0.1)\n"
+    "  --port=PORT         port of the server (8000)\n"
+    "  --path=PATH         request target (/)\n"
+    "  --connections=N     keep-alive connections to open (16)\n"
+    "  --pipeline=N        requests in flight per connection (1)\n"
+    "  --rate=N            requests/s in open loop, 0 for closed loop (0)\n"
+    "  --duration=SECONDS  length of the run (10)\n";
+
+struct Options {
+    std::string host = "127.0.0.1";
+    u16 port = 8000;
+    std::string path = "/";
+    int connections = 16;
+    int pipeline = 1;
+    double rate = 0;
+    std::chrono::seconds duration = 10s;
+};
+
+template <typename T>
+bool parse_number(std::string_view str, T &value) {
+    auto result = std::from_chars(str.data(), str.data() + str.size(), value);
+    return result.ec == std::errc{} && result.ptr == str.data() + str.size();
+}
+
+std::optional<Options> parse_options(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto equals = arg.find('=');
+
+        if (!arg.starts_with("--") || equals == std::string_view::npos) {
+            return {};
+        }
+
+        std::string_view name = arg.substr(2, equals - 2);
+        std::string_view value = arg.substr(equals + 1);
+        bool ok = true;
+
+        if (name == "host") {
+            options.host = value;
+        } else if (name == "port") {
+            ok = parse_number(value, options.port);
+        } else if (name == "path") {
+            options.path = value;
+        } else if (name == "connections") {
+            ok = parse_number(value, options.connections) &&
+                options.connections > 0;
+        } else if (name == "pipeline") {
+            ok = parse_number(value, options.pipeline) && options.pipeline > 0;
+        } else if (name == "rate") {
+            ok = parse_number(value, options.rate) && options.rate >= 0;
+        } else if (name == "duration") {
+            int seconds{};
+            ok = parse_number(value, seconds) && seconds > 0;
+            options.duration = std::chrono::seconds{seconds};
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            return {};
+        }
+    }
+
+    return options;
+}
+
+// Every connection has at most one send and one recv in flight, plus the timer.
+unsigned int ring_entries(int connections) {
+    return std::bit_ceil(2 * static_cast<unsigned int>(connections) + 1);
+}
+
+// Sizes of responses that cannot be delimited.
+constexpr std::size_t MALFORMED = std::string_view::npos;
+
+// Finds `needle`, which must be lowercase, in `haystack` ignoring case.
+std::size_t
+find_ignore_case(std::string_view haystack, std::string_view needle) {
+    auto it = std::search(
+        haystack.cbegin(),
+        haystack.cend(),
+        needle.cbegin(),
+        needle.cend(),
+        [](unsigned char a, unsigned char b) { return std::tolower(a) == b; }
+    );
+    return it == haystack.cend() ? std::string_view::npos
+                                 : it - haystack.cbegin();
+}
+
+// Returns the value of the first field of `head` that starts with `prefix`,
+// such as "\r\ncontent-length:".
+std::optional<std::string_view>
+find_header(std::string_view head, std::string_view prefix) {
+    std::size_t start = find_ignore_case(head, prefix);
+
+    if (start == std::string_view::npos) {
+        return {};
+    }
+
+    std::string_view value = head.substr(start + prefix.size());
+    value = value.substr(0, value.find("\r\n"));
+    value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+    return value;
+}
+
+// Returns the size of the chunked body at the start of `data`, trailer
+// section included, nothing until all of it has been received, or MALFORMED.
+std::optional<std::size_t> chunked_body_size(std::string_view data) {
+    std::size_t size = 0;
+
+    while (true) {
+        std::size_t line_end = data.find("\r\n", size);
+
+        if (line_end == std::string_view::npos) {
+            return {};
+        }
+
+        // Chunk extensions are ignored.
+        std::string_view line = data.substr(size, line_end - size);
+        line = line.substr(0, line.find(';'));
+        u64 chunk_size{};
+        const char *line_end_ptr = line.data() + line.size();
+        auto [ptr, ec] =
+            std::from_chars(line.data(), line_end_ptr, chunk_size, 16);
+
+        if (ec != std::errc{} || ptr == line.data()) {
+            return MALFORMED;
+        }
+
+        size = line_end + 2;
+
+        if (chunk_size == 0) {
+            break;
+        }
+
+        if (chunk_size > data.size() - size ||
+            data.size() - size - chunk_size < 2) {
+            return {};
+        }
+
+        size += chunk_size;
+
+        if (data.substr(size, 2) != "\r\n") {
+            return MALFORMED;
+        }
+
+        size += 2;
+    }
+
+    // Trailer fields, up to an empty line.
+    while (true) {
+        std::size_t line_end = data.find("\r\n", size);
+
+        if (line_end == std::string_view::npos) {
+            return {};
+        }
+
+        bool last = line_end == size;
+        size = line_end + 2;
+
+        if (last) {
+            return size;
+        }
+    }
+}
+
+// Returns the size of the response at the start of `received`, nothing until
+// all of it has been received, or MALFORMED.
+std::optional<std::size_t> response_size(std::string_view received) {
+    std::size_t head_end = received.find("\r\n\r\n");
+
+    if (head_end == std::string_view::npos) {
+        return {};
+    }
+
+    std::string_view head = received.substr(0, head_end + 2);
+    std::size_t head_size = head_end + 4;
+
+    if (auto coding = find_header(head, "\r\ntransfer-encoding:")) {
+        if (find_ignore_case(*coding, "chunked") == std::string_view::npos) {
+            return MALFORMED;
+        }
+
+        std::optional<std::size_t> body_size =
+            chunked_body_size(received.substr(head_size));
+
+        if (!body_size || *body_size == MALFORMED) {
+            return body_size;
+        }
+
+        return head_size + *body_size;
+    }
+
+    u64 content_length{};
+
+    if (auto value = find_header(head, "\r\ncontent-length:")) {
+        auto result = std::from_chars(
+            value->data(),
+            value->data() + value->size(),
+            content_length
+        );
+
+        if (result.ec != std::errc{}) {
+            return MALFORMED;
+        }
+    }
+
+    if (received.size() - head_size < content_length) {
+        return {};
+    }
+
+    return head_size + content_length;
+}
+
+struct Client {
+    int fd{};
+    // Bytes handed to the kernel by the in-flight send, which must not move.
+    std::string sending;
+    std::string queued;
+    std::string received;
+    std::vector<char> recv_buffer;
+    // Intended start times of requests written to the socket, and of requests
+    // held back by the pipelining limit or by the connection being closed.
+    std::deque<Clock::time_point> in_flight;
+    std::deque<Clock::time_point> backlog;
+    bool open = true;
+};
+
+class LoadGenerator {
+    Options options_;
+    IoUring ring_;
+    std::string request_;
+    std::vector<Client> clients_;
+    LatencyHistogram histogram_;
+    u64 completed_{};
+    u64 non_2xx_{};
+    u64 errors_{};
+    // Open-loop requests that had no response when the run ended, either
+    // still in flight or dropped along with their closed connection.
+    u64 unfinished_{};
+    u64 dropped_{};
+    u64 bytes_received_{};
+    u64 scheduled_{};
+    std::size_t next_client_{};
+    Clock::time_point start_;
+    Clock::time_point end_;
+    __kernel_timespec timer_{};
+
+    [[nodiscard]] bool open_loop() const { return options_.rate > 0; }
+
+    [[nodiscard]] Clock::time_point intended_start(u64 request) const {
+        auto offset = std::chrono::duration<double>(
+            static_cast<double>(request) / options_.rate
+        );
+        return start_ + std::chrono::duration_cast<Clock::duration>(offset);
+    }
+
+    void connect_clients() {
+        in_addr addr{};
+
+        if (::inet_pton(AF_INET, options_.host.c_str(), &addr) != 1) {
+            throw std::runtime_error("invalid IPv4 address: " + options_.host);
+        }
+
+        Ipv4Address address{::ntohl(addr.s_addr), options_.port};
+
+        for (int i = 0; i < options_.connections; i++) {
+            int fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+            if (fd == -1 ||
+                ::connect(fd, address.sockaddr(), address.sockaddr_size()) ==
+                    -1) {
+                const char *what = "connect() failed";
+                throw std::system_error(errno, std::generic_category(), what);
+            }
+
+            int no_delay = 1;
+            ::setsockopt(
+                fd,
+                IPPROTO_TCP,
+                TCP_NODELAY,
+                &no_delay,
+                sizeof(no_delay)
+            );
+
+            Client &client = clients_.emplace_back();
+            client.fd = fd;
+            client.recv_buffer.resize(RECV_BUFFER_SIZE);
+        }
+    }
+
+    void submit_send(std::size_t index) {
+        Client &client = clients_[index];
+        IoUringSqe sqe = ring_.get_sqe();
+        sqe.prep_send(
+            client.fd,
+            client.sending.data(),
+            client.sending.size(),
+            MSG_NOSIGNAL
+        );
+        sqe.set_data64(index << 1 | OP_SEND);
+        ring_.submit();
+    }
+
+    void submit_recv(std::size_t index) {
+        Client &client = clients_[index];
+        IoUringSqe sqe = ring_.get_sqe();
+        sqe.prep_recv(
+            client.fd,
+            client.recv_buffer.data(),
+            client.recv_buffer.size(),
+            0
+        );
+        sqe.set_data64(index << 1 | OP_RECV);
+        ring_.submit();
+    }
+
+    void submit_timer(Clock::time_point deadline) {
+        auto delay = std::max<Clock::duration>(
+            deadline - Clock::now(),
+            MIN_TIMER_INTERVAL
+        );
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(delay);
+        timer_ = {
+            .tv_sec = ns.count() / 1'000'000'000,
+            .tv_nsec = ns.count() % 1'000'000'000,
+        };
+
+        IoUringSqe sqe = ring_.get_sqe();
+        sqe.prep_timeout(&timer_, 0, 0);
+        sqe.set_data64(DATA_TIMER);
+        ring_.submit();
+    }
+
+    void enqueue_request(std::size_t index, Clock::time_point start) {
+        Client &client = clients_[index];
+
+        if (!client.open) {
+            client.backlog.push_back(start);
+            return;
+        }
+
+        if (client.in_flight.size() >=
+            static_cast<std::size_t>(options_.pipeline)) {
+            client.backlog.push_back(start);
+            return;
+        }
+
+        client.in_flight.push_back(start);
+
+        if (client.sending.empty()) {
+            client.sending = request_;
+            submit_send(index);
+        } else {
+            client.queued += request_;
+        }
+    }
+
+    void close_client(std::size_t index) {
+        Client &client = clients_[index];
+
+        if (client.open) {
+            errors_++;
+            client.open = false;
+        }
+    }
+
+    void handle_send(std::size_t index, i32 res) {
+        Client &client = clients_[index];
+
+        if (res < 0) {
+            close_client(index);
+            return;
+        }
+
+        client.sending.erase(0, res);
+        client.sending += client.queued;
+        client.queued.clear();
+
+        if (!client.sending.empty()) {
+            submit_send(index);
+        }
+    }
+
+    void handle_recv(std::size_t index, i32 res, Clock::time_point now) {
+        Client &client = clients_[index];
+
+        if (res <= 0) {
+            close_client(index);
+            return;
+        }
+
+        bytes_received_ += res;
+        client.received.append(client.recv_buffer.data(), res);
+
+        while (true) {
+            std::string_view received = client.received;
+            std::optional<std::size_t> size = response_size(received);
+
+            if (!size) {
+                break;
+            }
+
+            if (*size == MALFORMED || client.in_flight.empty()) {
+                close_client(index);
+                return;
+            }
+
+            if (!received.starts_with("HTTP/1.") || received.size() < 10 ||
+                received[9] != '2') {
+                non_2xx_++;
+            }
+
+            if (now < end_) {
+                histogram_.record(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        now - client.in_flight.front()
+                    )
+                        .count()
+                );
+                completed_++;
+            }
+
+            client.received.erase(0, *size);
+            client.in_flight.pop_front();
+
+            if (!client.backlog.empty()) {
+                Clock::time_point start = client.backlog.front();
+                client.backlog.pop_front();
+                enqueue_request(index, start);
+            } else if (!open_loop()) {
+                enqueue_request(index, now);
+            }
+        }
+
+        submit_recv(index);
+    }
+
+    // Requests without a response would otherwise leave the latency
+    // distribution, right when the server falls behind. They are recorded as
+    // having taken as long as they had been waiting for.
+    void record_unfinished(Clock::time_point now) {
+        for (const Client &client : clients_) {
+            for (const auto *starts : {&client.in_flight, &client.backlog}) {
+                for (Clock::time_point start : *starts) {
+                    histogram_.record(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            now - start
+                        )
+                            .count()
+                    );
+                    (client.open ? unfinished_ : dropped_)++;
+                }
+            }
+        }
+    }
+
+    void handle_timer(Clock::time_point now) {
+        if (!open_loop() || now >= end_) {
+            return;
+        }
+
+        while (intended_start(scheduled_) <= now) {
+            enqueue_request(next_client_, intended_start(scheduled_));
+            next_client_ = (next_client_ + 1) % clients_.size();
+            scheduled_++;
+        }
+
+        submit_timer(std::min(intended_start(scheduled_), end_));
+    }
+
+public:
+    explicit LoadGenerator(Options options) :
+        options_{std::move(options)},
+        ring_{ring_entries(options_.connections)},
+        request_{fmt::format(
+            "GET {} HTTP/1.1\r\nHost: {}:{}\r\n\r\n",
+            options_.path,
+            options_.host,
+            options_.port
+        )} {}
+
+    void run() {
+        connect_clients();
+        start_ = Clock::now();
+        end_ = start_ + options_.duration;
+
+        for (std::size_t i = 0; i < clients_.size(); i++) {
+            submit_recv(i);
+
+            for (int j = 0; !open_loop() && j < options_.pipeline; j++) {
+                enqueue_request(i, start_);
+            }
+        }
+
+        submit_timer(open_loop() ? start_ : end_);
+
+        Clock::time_point now = start_;
+
+        while (now < end_) {
+            IoUringCqe cqe = ring_.wait_cqe();
+            u64 data = cqe.get_data64();
+            i32 res = cqe.res();
+            ring_.seen_cqe(cqe);
+            now = Clock::now();
+
+            if (data == DATA_TIMER) {
+                handle_timer(now);
+            } else if ((data & 1) == OP_SEND) {
+                handle_send(data >> 1, res);
+            } else {
+                handle_recv(data >> 1, res, now);
+            }
+        }
+
+        if (open_loop()) {
+            record_unfinished(now);
+        }
+
+        for (Client &client : clients_) {
+            ::close(client.fd);
+        }
+    }
+
+    void print_report() const {
+        std::chrono::duration<double> seconds = options_.duration;
+
+        fmt::print(
+            "{} connections, pipeline {}, {}, {:.2f} s\n",
+            options_.connections,
+            options_.pipeline,
+            open_loop() ? fmt::format("open loop at {} req/s", options_.rate)
+                        : std::string{"closed loop"},
+            seconds.count()
+        );
+        fmt::print(
+            "requests: {} ({:.1f} req/s, {:.2f} MiB/s), non-2xx: {}, "
+            "errors: {}\n",
+            completed_,
+            static_cast<double>(completed_) / seconds.count(),
+            static_cast<double>(bytes_received_) / seconds.count() / 1048576,
+            non_2xx_,
+            errors_
+        );
+        if (open_loop()) {
+            fmt::print(
+                "unfinished: {} in flight, {} dropped by closed connections\n",
+                unfinished_,
+                dropped_
+            );
+        }
+
+        fmt::print("latency (us):");
+
+        for (double percentile : {50.0, 90.0, 99.0, 99.9, 99.99}) {
+            u64 value = histogram_.value_at_percentile(percentile);
+            fmt::print(
+                " p{}={:.1f}",
+                percentile,
+                static_cast<double>(value) / 1000
+            );
+        }
+
+        fmt::print(
+            " max={:.1f}\n",
+            static_cast<double>(histogram_.max_value()) / 1000
+        );
+    }
+};
+
+} // namespace
+
+} // namespace co_http_uring::bench
+
+int main(int argc, char **argv) {
+    using namespace co_http_uring::bench;
+
+    std::optional<Options> options = parse_options(argc, argv);
+
+    if (!options) {
+        fmt::print(stderr, "{}", USAGE);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        LoadGenerator generator{std::move(*options)};
+        generator.run();
+        generator.print_report();
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "error: {}\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sync_await.hpp"
+
+#include "co_http_uring/connection_reader.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/request.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace co_http_uring {
+
+namespace {
+
+constexpr std::string_view SMALL_REQUEST =
+    "GET / HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "\r\n";
+
+constexpr std::string_view LARGE_REQUEST =
+    "GET /api/v1/users/42/preferences?include=all HTTP/1.1\r\n"
+    "Host: api.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: https://www.example.com/dashboard\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=5f2b1c9e8d7a6b5c4d3e2f1a0b9c8d7e; theme=dark; lang=en\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "If-None-Match: \"33a64df551425fcc55e4d42a148795d9f25f89d4\"\r\n"
+    "If-Modified-Since: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+    "X-Request-Id: 7f1c2a9e-4b8d-4e0a-9c3f-2d5e6b7a8c9d\r\n"
+    "X-Forwarded-For: 203.0.113.195, 70.41.3.18, 150.172.238.178\r\n"
+    "X-Forwarded-Proto: https\r\n"
+    "\r\n";
+
+// Many repetitions of the same header name and a handful of long values, kept
+// under the reader's buffer size.
+std::string make_pathological_request() {
+    std::string request = "POST /upload HTTP/1.1\r\nHost: localhost\r\n";
+
+    for (int i = 0; i < 150; i++) {
+        request += "X-Repeated-Header-Name: value\r\n";
+    }
+
+    for (int i = 0; i < 4; i++) {
+        request += "X-Long-Value: ";
+        request.append(512, 'a');
+        request += "\r\n";
+    }
+
+    request += "Content-Length: 0\r\n\r\n";
+    return request;
+}
+
+// Requests are allocated from `arena`, reset between them the way the server
+// does, or from the heap if it is null.
+void receive_requests(
+    benchmark::State &state,
+    std::string_view raw_request,
+    std::pmr::monotonic_buffer_resource *arena
+) {
+    ConnectionReader reader{-1};
+    std::pmr::memory_resource *resource =
+        arena ? arena : std::pmr::get_default_resource();
+
+    for (auto _ : state) {
+        if (arena) {
+            arena->release();
+        }
+
+        reader.set_bytes_remaining(std::numeric_limits<u64>::max());
+        reader.feed(raw_request);
+
+        std::variant<Request, Error> result =
+            bench::sync_await(Request::receive(reader, resource));
+
+        if (!std::holds_alternative<Request>(result)) {
+            state.SkipWithError("request parsing failed");
+            break;
+        }
+
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetBytesProcessed(state.iterations() * raw_request.size());
+}
+
+void BM_RequestReceive(benchmark::State &state, std::string_view raw_request) {
+    receive_requests(state, raw_request, nullptr);
+}
+
+void BM_RequestReceiveArena(
+    benchmark::State &state,
+    std::string_view raw_request
+) {
+    std::array<std::byte, 8 * 1024> buffer;
+    std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size()};
+    receive_requests(state, raw_request, &arena);
+}
+
+void BM_RequestReceivePathological(benchmark::State &state) {
+    BM_RequestReceive(state, make_pathological_request());
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_RequestReceive, small, SMALL_REQUEST);
+BENCHMARK_CAPTURE(BM_RequestReceive, large, LARGE_REQUEST);
+BENCHMARK_CAPTURE(BM_RequestReceiveArena, small, SMALL_REQUEST);
+BENCHMARK_CAPTURE(BM_RequestReceiveArena, large, LARGE_REQUEST);
+BENCHMARK(BM_RequestReceivePathological);
+
+} // namespace co_http_uring
@@ -0,0 +1,68 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sync_await.hpp"
+
+#include "co_http_uring/connection_writer.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/response_writer.hpp"
+#include "co_http_uring/status_code.hpp"
+#include "co_http_uring/task.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <coroutine>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace co_http_uring {
+
+namespace {
+
+Task<std::optional<Error>>
+write_response(ConnectionWriter &writer, std::string_view body, int headers) {
+    ResponseWriter res{writer, 1};
+    std::optional<Error> error = co_await res.write_status(StatusCode::OK);
+
+    for (int i = 0; !error && i < headers; i++) {
+        error = co_await res.write_header("X-Bench-Header", "some value");
+    }
+
+    if (error || (error = co_await res.write_body(body))) {
+        co_return error;
+    }
+
+    co_return {};
+}
+
+void BM_ResponseWriter(benchmark::State &state) {
+    ConnectionWriter writer{-1};
+    std::string body(state.range(0), 'x');
+    auto headers = static_cast<int>(state.range(1));
+    std::size_t bytes_written = 0;
+
+    for (auto _ : state) {
+        if (bench::sync_await(write_response(writer, body, headers))) {
+            state.SkipWithError("response serialization failed");
+            break;
+        }
+
+        bytes_written += writer.buffered().size();
+        benchmark::DoNotOptimize(writer.buffered().data());
+        writer.clear();
+    }
+
+    state.SetBytesProcessed(static_cast<i64>(bytes_written));
+}
+
+} // namespace
+
+// Bodies stay below the writer's buffer size so that nothing is ever flushed.
+BENCHMARK(BM_ResponseWriter)
+    ->Args({0, 0})
+    ->Args({64, 2})
+    ->Args({1024, 8})
+    ->Args({4096, 16});
+
+} // namespace co_http_uring
@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+# Copyright (C) 2022 OverMighty
+# SPDX-License-Identifier: Apache-2.0
+
+# Starts co_http_uring_bench_server on loopback and drives it with
+# co_http_uring_loadgen. Any extra arguments are passed to the load generator.
+#
+# usage: run_e2e.sh BUILD_DIR [loadgen options...]
+#
+# Environment:
+#   PORT            port to listen on (8000)
+#   SERVER_THREADS  server threads (1)
+#   SERVER_CPUS     CPU list to pin the server to with taskset (unset)
+#   LOADGEN_CPUS    CPU list to pin the load generator to with taskset (unset)
+
+set -eu
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 BUILD_DIR [loadgen options...]" >&2
+    exit 1
+fi
+
+build_dir=$1
+shift
+
+port=${PORT:-8000}
+server_threads=${SERVER_THREADS:-1}
+
+pin() {
+    cpus=$1
+    shift
+
+    if [ -n "$cpus" ]; then
+        taskset -c "$cpus" "$@"
+    else
+        "$@"
+    fi
+}
+
+pin "${SERVER_CPUS:-}" "$build_dir/bench/co_http_uring_bench_server" \
+    --port="$port" --threads="$server_threads" &
+server_pid=$!
+trap 'kill "$server_pid" 2>/dev/null || true' EXIT INT TERM
+
+# Wait for the listener to come up.
+i=0
+while ! (exec 3<>"/dev/tcp/127.0.0.1/$port") 2>/dev/null; do
+    i=$((i + 1))
+
+    if [ "$i" -ge 50 ]; then
+        echo "server did not start listening on port $port" >&2
+        exit 1
+    fi
+
+    sleep 0.1
+done
+
+pin "${LOADGEN_CPUS:-}" "$build_dir/bench/co_http_uring_loadgen" \
+    --port="$port" "$@"
@@ -0,0 +1,27 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_BENCH_SYNC_AWAIT_HPP
+#define CO_HTTP_URING_BENCH_SYNC_AWAIT_HPP
+
+#include "co_http_uring/task.hpp"
+
+#include <cstdlib>
+#include <utility>
+
+namespace co_http_uring::bench {
+
+// Benchmarked tasks never submit to a ring, so they must have completed by the
+// time their initial call returns.
+template <typename T>
+T sync_await(Task<T> &&task) {
+    if (!task.await_ready()) {
+        std::abort();
+    }
+
+    return task.await_resume();
+}
+
+} // namespace co_http_uring::bench
+
+#endif // CO_HTTP_URING_BENCH_SYNC_AWAIT_HPP
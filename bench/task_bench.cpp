@@ -0,0 +1,61 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sync_await.hpp"
+
+#include "co_http_uring/task.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <coroutine>
+
+namespace co_http_uring {
+
+namespace {
+
+Task<int> leaf(int value) {
+    co_return value + 1;
+}
+
+Task<int> chain(int depth) {
+    if (depth == 0) {
+        co_return co_await leaf(0);
+    }
+
+    co_return co_await chain(depth - 1) + 1;
+}
+
+Task<> leaf_void() {
+    co_return;
+}
+
+void BM_TaskCreateDestroy(benchmark::State &state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench::sync_await(leaf(1)));
+    }
+}
+
+void BM_TaskVoidCreateDestroy(benchmark::State &state) {
+    for (auto _ : state) {
+        Task<> task = leaf_void();
+        benchmark::DoNotOptimize(task.await_ready());
+    }
+}
+
+void BM_TaskAwaitChain(benchmark::State &state) {
+    auto depth = static_cast<int>(state.range(0));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench::sync_await(chain(depth)));
+    }
+
+    state.SetItemsProcessed(state.iterations() * (state.range(0) + 2));
+}
+
+} // namespace
+
+BENCHMARK(BM_TaskCreateDestroy);
+BENCHMARK(BM_TaskVoidCreateDestroy);
+BENCHMARK(BM_TaskAwaitChain)->Arg(1)->Arg(8)->Arg(64);
+
+} // namespace co_http_uring
@@ -0,0 +1,95 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_ADMISSION_CONTROLLER_HPP
+#define CO_HTTP_URING_ADMISSION_CONTROLLER_HPP
+
+#include "types.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace co_http_uring {
+
+// Targets past which a server sheds load instead of letting latency grow for
+// every client. A target of zero is not checked.
+struct AdmissionPolicy {
+    // Open connections at which the server stops accepting, until they fall
+    // back below seven eighths of it.
+    std::size_t max_connections = 0;
+    // Average CQEs handled per iteration of the event loop.
+    unsigned int max_cqes_per_loop = 0;
+    // Average time that an iteration of the event loop spends handling CQEs
+    // and running coroutines, which is how long new completions wait.
+    std::chrono::microseconds max_queueing_delay{};
+    // Average time that handlers take to answer HTTP/1.1 requests.
+    std::chrono::microseconds max_handler_latency{};
+    // Sent to clients whose requests are shed.
+    std::chrono::seconds retry_after{1};
+};
+
+// Decides when a server sheds load. While an average crosses its target, the
+// server answers new HTTP/1.1 requests with 503 Service Unavailable and closes
+// their connections; past the connection limit, it pauses its accepts.
+//
+// Only its server's thread updates it, but stats() may be read from any.
+class AdmissionController {
+public:
+    struct Stats {
+        u64 connections;
+        u64 accept_pauses;
+        u64 shed_requests;
+        bool accepting;
+        bool overloaded;
+        double cqes_per_loop;
+        std::chrono::nanoseconds queueing_delay;
+        std::chrono::nanoseconds handler_latency;
+    };
+
+private:
+    AdmissionPolicy policy_;
+    std::string shed_response_;
+    std::atomic<u64> connections_{0};
+    std::atomic<u64> accept_pauses_{0};
+    std::atomic<u64> shed_requests_{0};
+    std::atomic<bool> accepting_{true};
+    std::atomic<bool> overloaded_{false};
+    // Exponential moving averages, with a weight of 1/8 for the latest sample.
+    std::atomic<double> cqes_per_loop_{0};
+    std::atomic<i64> queueing_delay_{0};
+    std::atomic<i64> handler_latency_{0};
+
+    void update_overloaded();
+
+public:
+    explicit AdmissionController(const AdmissionPolicy &policy);
+
+    [[nodiscard]] const AdmissionPolicy &policy() const { return policy_; }
+
+    void record_loop(unsigned int cqes, std::chrono::nanoseconds busy_time);
+
+    void record_handler(std::chrono::nanoseconds latency);
+
+    // Returns whether the server should accept connections with `connections`
+    // open, and counts the pauses.
+    bool update_accepting(std::size_t connections);
+
+    // Returns whether to shed the request just received, and counts it. Shed
+    // requests count as answered at once in the handler latency, so that the
+    // average falls back while the server sheds them.
+    bool shed_request();
+
+    // A complete 503 response that closes the connection.
+    [[nodiscard]] std::string_view shed_response() const {
+        return shed_response_;
+    }
+
+    [[nodiscard]] Stats stats() const;
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_ADMISSION_CONTROLLER_HPP
@@ -0,0 +1,46 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_BUFFER_RING_HPP
+#define CO_HTTP_URING_BUFFER_RING_HPP
+
+#include "io_uring.hpp"
+#include "pooled_buffer.hpp"
+#include "types.hpp"
+
+#include <liburing.h>
+
+#include <vector>
+
+namespace co_http_uring {
+
+// Pooled buffers provided to the kernel, which picks one for a receive only
+// once data has arrived. Connections waiting for a request can thus receive
+// without holding a buffer of their own.
+class BufferRing {
+    IoUring *ring_;
+    io_uring_buf_ring *buf_ring_;
+    u16 group_id_;
+    std::vector<PooledBuffer> buffers_;
+
+    void provide(u16 buffer_id);
+
+public:
+    static constexpr unsigned int ENTRIES = 256;
+
+    BufferRing(IoUring &ring, u16 group_id);
+
+    ~BufferRing();
+
+    BufferRing(const BufferRing &) = delete;
+    BufferRing &operator=(const BufferRing &) = delete;
+
+    [[nodiscard]] u16 group_id() const { return group_id_; }
+
+    // Takes the buffer the kernel filled, and provides a new one in its place.
+    PooledBuffer take(u16 buffer_id);
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_BUFFER_RING_HPP
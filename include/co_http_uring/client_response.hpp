@@ -0,0 +1,109 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_CLIENT_RESPONSE_HPP
+#define CO_HTTP_URING_CLIENT_RESPONSE_HPP
+
+#include "connection_reader.hpp"
+#include "error.hpp"
+#include "header_map.hpp"
+#include "known_headers.hpp"
+#include "request.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace co_http_uring {
+
+// A response received from an upstream server, with its body read in full.
+class ClientResponse {
+public:
+    struct BodyFraming {
+        enum Kind {
+            CONTENT_LENGTH,
+            CHUNKED,
+            UNTIL_CLOSE,
+        };
+
+        Kind kind;
+        u64 length{};
+    };
+
+private:
+    HttpVersion http_version_{};
+    int status_code_{};
+    HeaderMap headers_;
+    std::string body_;
+    bool keep_alive_{};
+
+    Task<std::optional<Error>> read_status_line(ConnectionReader &reader);
+
+    Task<std::optional<Error>> read_headers(ConnectionReader &reader);
+
+    Task<std::optional<Error>>
+    read_body(ConnectionReader &reader, u64 length, u64 max_body_size);
+
+    Task<std::optional<Error>>
+    read_chunked_body(ConnectionReader &reader, u64 max_body_size);
+
+    Task<std::optional<Error>>
+    read_body_until_close(ConnectionReader &reader, u64 max_body_size);
+
+public:
+    ClientResponse() = default;
+
+    // Receives the status line and headers, skipping interim responses.
+    static Task<std::variant<ClientResponse, Error>>
+    receive_head(ConnectionReader &reader);
+
+    static Task<std::variant<ClientResponse, Error>> receive(
+        ConnectionReader &reader,
+        std::string_view request_method,
+        u64 max_body_size
+    );
+
+    [[nodiscard]] HttpVersion http_version() const { return http_version_; }
+
+    [[nodiscard]] int status_code() const { return status_code_; }
+
+    [[nodiscard]] const HeaderMap &headers() const { return headers_; }
+
+    [[nodiscard]] const std::string &body() const { return body_; }
+
+    // Whether the connection can carry another request.
+    [[nodiscard]] bool keep_alive() const { return keep_alive_; }
+
+    [[nodiscard]] bool has_body(std::string_view request_method) const;
+
+    // How the end of the body is delimited, or nothing if the framing headers
+    // are invalid.
+    [[nodiscard]] std::optional<BodyFraming> body_framing() const;
+
+    std::optional<std::reference_wrapper<const HeaderMap::Values>>
+    get_header(std::string_view name) const {
+        if (const HeaderMap::Values *values = headers_.find(name)) {
+            return *values;
+        }
+
+        return {};
+    }
+
+    std::optional<std::reference_wrapper<const HeaderMap::Values>>
+    get_header(Header header) const {
+        if (const HeaderMap::Values *values = headers_.find(header)) {
+            return *values;
+        }
+
+        return {};
+    }
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_CLIENT_RESPONSE_HPP
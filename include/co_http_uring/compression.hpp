@@ -0,0 +1,76 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_COMPRESSION_HPP
+#define CO_HTTP_URING_COMPRESSION_HPP
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct z_stream_s;
+
+namespace co_http_uring {
+
+enum class ContentEncoding {
+    IDENTITY,
+    DEFLATE,
+    GZIP,
+};
+
+struct CompressionOptions {
+    int level = 6;
+    std::size_t min_size = 1024;
+};
+
+std::string_view content_encoding_name(ContentEncoding encoding);
+
+ContentEncoding
+negotiate_content_encoding(
+    const std::pmr::vector<std::pmr::string> &accept_encoding
+);
+
+class Deflater {
+    struct Result {
+        std::size_t bytes_written;
+        bool finished;
+    };
+
+    std::unique_ptr<z_stream_s> stream_;
+    ContentEncoding encoding_;
+    int level_;
+
+public:
+    Deflater(ContentEncoding encoding, int level);
+
+    ~Deflater();
+
+    Deflater(const Deflater &) = delete;
+    Deflater &operator=(const Deflater &) = delete;
+
+    Deflater(Deflater &&) noexcept;
+    Deflater &operator=(Deflater &&) noexcept;
+
+    [[nodiscard]] ContentEncoding encoding() const { return encoding_; }
+
+    [[nodiscard]] int level() const { return level_; }
+
+    void reset();
+
+    void set_input(std::string_view input);
+
+    Result deflate(std::span<u8> output, bool finish);
+};
+
+std::string
+compress(std::string_view data, ContentEncoding encoding, int level);
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_COMPRESSION_HPP
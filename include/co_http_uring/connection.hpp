@@ -9,12 +9,61 @@
 #include "connection_writer.hpp"
 #include "task.hpp"
 
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
 namespace co_http_uring {
 
 class Connection {
+    // Requests are allocated from the buffer, and only what overflows it comes
+    // from the heap.
+    struct Arena {
+        static constexpr std::size_t BUFFER_SIZE = 8 * 1024;
+
+        std::array<std::byte, BUFFER_SIZE> buffer;
+        std::pmr::monotonic_buffer_resource resource{
+            buffer.data(),
+            buffer.size(),
+        };
+    };
+
+    // Takes an arena from the thread's pool on the first allocation of a
+    // request, so that idle connections hold none. Kept apart so that the
+    // connection stays movable.
+    class ArenaResource : public std::pmr::memory_resource {
+        static constexpr std::size_t MAX_IDLE_ARENAS = 64;
+
+        static thread_local std::vector<std::unique_ptr<Arena>> idle_arenas_;
+
+        std::unique_ptr<Arena> arena_;
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+        void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+        [[nodiscard]] bool do_is_equal(
+            const std::pmr::memory_resource &other
+        ) const noexcept override {
+            return this == &other;
+        }
+
+    public:
+        ArenaResource() = default;
+
+        ArenaResource(ArenaResource &&) = default;
+
+        ArenaResource &operator=(ArenaResource &&) = default;
+
+        void release();
+    };
+
     int fixed_fd_;
     ConnectionReader reader_;
     ConnectionWriter writer_;
+    ArenaResource arena_;
 
     ConnectionFuture<Connection> submit_close();
 
@@ -27,6 +76,13 @@ public:
 
     ConnectionWriter &writer() { return writer_; }
 
+    // Memory for one request at a time.
+    std::pmr::memory_resource &arena() { return arena_; }
+
+    // Frees everything allocated from the arena at once and returns it to the
+    // pool. Nothing allocated from it may be used afterwards.
+    void release_arena() { arena_.release(); }
+
     Task<> close();
 };
 
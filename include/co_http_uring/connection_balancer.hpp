@@ -0,0 +1,61 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_CONNECTION_BALANCER_HPP
+#define CO_HTTP_URING_CONNECTION_BALANCER_HPP
+
+#include "types.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace co_http_uring {
+
+// Lets the servers of a process hand newly accepted connections to each other
+// with IORING_OP_MSG_RING, so that SO_REUSEPORT hashing does not pin load on a
+// single thread.
+//
+// A server hands a connection off when it has more than `max_imbalance` open
+// connections beyond those of the least loaded server.
+class ConnectionBalancer {
+public:
+    struct Member {
+        std::atomic<int> ring_fd{-1};
+        std::atomic<u32> connections{0};
+        // Handoffs to this member whose MSG_RING has not completed yet.
+        std::atomic<u32> handoffs{0};
+    };
+
+private:
+    std::unique_ptr<Member[]> members_;
+    std::size_t capacity_;
+    std::atomic<std::size_t> size_{0};
+    u32 max_imbalance_;
+
+public:
+    ConnectionBalancer(std::size_t max_servers, u32 max_imbalance);
+
+    [[nodiscard]] u32 max_imbalance() const { return max_imbalance_; }
+
+    // Slots are not reused, so every server that runs counts against
+    // `max_servers`, once per run.
+    Member &join(int ring_fd);
+
+    // Stops handing connections to `member`, whose server is no longer
+    // running. Handoffs already under way may still reach its ring until
+    // `member.handoffs` drops to zero.
+    void leave(Member &member);
+
+    // Returns the member to hand a new connection of `self` to, with the
+    // connection and the handoff already counted against it, or nullptr to
+    // keep it. The handoff must only be sent if the target's ring_fd is still
+    // set when loaded afterwards, and must be finished either way.
+    Member *pick_target(const Member &self);
+
+    void finish_handoff(Member &target);
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_CONNECTION_BALANCER_HPP
@@ -5,9 +5,12 @@
 #define CO_HTTP_URING_CONNECTION_FUTURE_HPP
 
 #include "server.hpp"
+#include "task.hpp"
 
 #include <fmt/core.h>
 
+#include <coroutine>
+
 namespace co_http_uring {
 
 template <typename T>
@@ -26,15 +29,19 @@ public:
 
     [[nodiscard]] bool await_ready() const { return false; }
 
-    void await_suspend(std::coroutine_handle<> coroutine) const {
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> coroutine) const {
+        int fixed_fd = ConnectionTraits::fixed_fd(wrapper_);
         auto [it, inserted] = Server::thread_instance()->coroutines().emplace(
-            ConnectionTraits::fixed_fd(wrapper_),
+            fixed_fd,
             coroutine
         );
 
         if (!inserted) {
             fmt::print(stderr, "consecutive await_suspend()\n");
         }
+
+        await_operation(coroutine, fixed_fd);
     }
 
     void await_resume() const {
@@ -6,36 +6,73 @@
 
 #include "connection_future.hpp"
 #include "error.hpp"
+#include "file.hpp"
+#include "pooled_buffer.hpp"
 #include "task.hpp"
 #include "types.hpp"
 
-#include <array>
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
-#include <memory>
+#include <functional>
+#include <limits>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <variant>
 
 namespace co_http_uring {
 
-class ConnectionReader {
-    static constexpr std::size_t BUFFER_SIZE = 8192;
+class BufferRing;
+class ConnectionWriter;
 
-    using Buffer = std::array<char, BUFFER_SIZE>;
+// Reads from a connection through a pooled buffer that is only held once data
+// has arrived. The buffer starts at PooledBuffer::MIN_SIZE and is only grown,
+// up to the maximum buffer size, for lines that do not fit.
+class ConnectionReader {
+public:
+    // Feeds the reader through feed() instead of a socket, or returns the
+    // error that ends the input.
+    using Source = std::function<Task<std::optional<Error>>()>;
 
+private:
     int fixed_fd_;
+    Source source_;
     u64 bytes_remaining_;
-    std::unique_ptr<Buffer> buffer_;
-    Buffer::const_iterator begin_;
-    Buffer::const_iterator end_;
+    std::size_t max_buffer_size_;
+    PooledBuffer buffer_;
+    std::size_t begin_{};
+    std::size_t end_{};
+    const ConnectionWriter *continue_writer_{};
+    u64 continue_flush_count_{};
+    bool has_own_read_timeout_{};
+    std::optional<std::chrono::seconds> read_timeout_;
+
+    void rewind_if_empty();
 
-    ConnectionFuture<ConnectionReader> submit_recv();
+    bool grow();
+
+    // Receives into the buffer, or into one picked from `buffer_ring`.
+    ConnectionFuture<ConnectionReader> submit_recv(BufferRing *buffer_ring);
+
+    ConnectionFuture<ConnectionReader> submit_send(std::string_view data);
 
     Task<std::optional<Error>> fill();
 
+    Task<std::optional<Error>> write_buffered_to(
+        const File &file,
+        u64 length,
+        u64 offset,
+        u64 &num_written
+    );
+
 public:
     explicit ConnectionReader(int fixed_fd);
 
+    // A reader of data that does not come from a socket, such as an HTTP/2
+    // stream's body. fixed_fd() is then -1.
+    explicit ConnectionReader(Source source);
+
     ~ConnectionReader() = default;
 
     ConnectionReader(const ConnectionReader &) = delete;
@@ -46,13 +83,93 @@ public:
 
     [[nodiscard]] int fixed_fd() const { return fixed_fd_; }
 
+    [[nodiscard]] u64 bytes_remaining() const { return bytes_remaining_; }
+
+    [[nodiscard]] std::size_t buffered_size() const { return end_ - begin_; }
+
     void set_bytes_remaining(u64 bytes_remaining) {
         bytes_remaining_ = bytes_remaining;
     }
 
+    [[nodiscard]] std::size_t max_buffer_size() const {
+        return max_buffer_size_;
+    }
+
+    void set_max_buffer_size(std::size_t max_buffer_size) {
+        max_buffer_size_ = max_buffer_size;
+    }
+
+    // Receives wait at most `read_timeout` instead of the server's read
+    // timeout, or indefinitely without one, until reset_read_timeout().
+    void set_read_timeout(std::optional<std::chrono::seconds> read_timeout) {
+        has_own_read_timeout_ = true;
+        read_timeout_ = read_timeout;
+    }
+
+    void reset_read_timeout() { has_own_read_timeout_ = false; }
+
+    // Returns the buffer to the pool if nothing is buffered. The next receive
+    // lets the kernel pick a buffer from the server's ring once data arrives,
+    // so that idle connections hold none.
+    void release_buffer();
+
+    std::size_t feed(std::string_view data);
+
+    // Makes the next receive send `100 Continue` first, unless `writer` has
+    // sent anything in the meantime, which would be the final response.
+    void expect_continue(const ConnectionWriter &writer);
+
+    [[nodiscard]] bool continue_pending() const {
+        return continue_writer_ != nullptr;
+    }
+
+    void cancel_continue() { continue_writer_ = nullptr; }
+
+    // Sends `100 Continue` now if it is still pending. Receiving does this
+    // implicitly.
+    Task<std::optional<Error>> send_pending_continue();
+
+    // Consumes up to `max_size` buffered bytes without receiving.
+    std::string_view take_buffered(std::size_t max_size) {
+        std::size_t begin = begin_;
+        begin_ += std::min<std::size_t>(max_size, end_ - begin_);
+        return {buffer_.data() + begin, begin_ - begin};
+    }
+
+    // The buffered bytes, which may be modified in place until consumed.
+    [[nodiscard]] std::span<char> buffered() {
+        return {buffer_.data() + begin_, end_ - begin_};
+    }
+
+    void consume(std::size_t size) { begin_ += size; }
+
+    // Receives until at least `size` bytes are buffered, growing the buffer if
+    // they do not fit.
+    Task<std::optional<Error>> fill_to(std::size_t size);
+
     Task<std::variant<std::string_view, Error>> read();
 
+    // Returns at most `max_size` bytes, receiving only if nothing is buffered.
+    Task<std::variant<std::string_view, Error>> read_some(
+        std::size_t max_size = std::numeric_limits<std::size_t>::max()
+    );
+
     Task<std::variant<std::string_view, Error>> read_line();
+
+    // Returns exactly `size` bytes, growing the buffer if they do not fit.
+    Task<std::variant<std::string_view, Error>> read_exact(std::size_t size);
+
+    // Writes the next `length` bytes to `file` at `offset`. Buffered bytes
+    // are written first, and the rest is spliced from the socket through a
+    // pipe without passing through user space, unless the reader has a
+    // source. `on_progress` is called with
+    // the number of bytes written so far after each step.
+    Task<std::optional<Error>> splice_to(
+        const File &file,
+        u64 length,
+        u64 offset = 0,
+        std::function<void(u64)> on_progress = {}
+    );
 };
 
 } // namespace co_http_uring
@@ -4,34 +4,67 @@
 #ifndef CO_HTTP_URING_CONNECTION_WRITER_HPP
 #define CO_HTTP_URING_CONNECTION_WRITER_HPP
 
-#include "connection_future.hpp"
 #include "error.hpp"
+#include "operation_future.hpp"
+#include "pooled_buffer.hpp"
 #include "task.hpp"
 #include "types.hpp"
 
-#include <array>
+#include <chrono>
 #include <cstddef>
-#include <memory>
+#include <functional>
 #include <optional>
+#include <span>
 #include <string_view>
 
 namespace co_http_uring {
 
+// Writes to a connection through a buffer taken from the thread's pool on
+// the first write, and given back once everything has been flushed.
 class ConnectionWriter {
-    static constexpr std::size_t BUFFER_SIZE = 8192;
-
-    using Buffer = std::array<u8, BUFFER_SIZE>;
+public:
+    // Takes what is flushed instead of a socket.
+    using Sink = std::function<Task<std::optional<Error>>(std::string_view)>;
 
+private:
     int fixed_fd_;
-    std::unique_ptr<Buffer> buffer_;
-    Buffer::iterator begin_;
-    Buffer::iterator end_;
-
-    ConnectionFuture<ConnectionWriter> submit_send();
+    Sink sink_;
+    PooledBuffer buffer_;
+    std::size_t begin_{};
+    std::size_t end_{};
+    u64 flush_count_{};
+    bool close_requested_{};
+    bool timed_out_{};
+    // Whether the server's response write timeout applies, and when it
+    // expires once the response's first send starts.
+    bool timing_response_{};
+    std::optional<std::chrono::steady_clock::time_point> response_deadline_;
+    // Time spent waiting on sends and bytes sent since the response started,
+    // against which the server's minimum send rate is checked.
+    std::chrono::nanoseconds send_time_{};
+    u64 sent_size_{};
+
+    void acquire_buffer() {
+        if (!buffer_) {
+            buffer_ = PooledBuffer::acquire();
+        }
+    }
+
+    // How long the next send may take under the server's write timeouts and
+    // minimum send rate.
+    std::chrono::nanoseconds get_send_timeout();
+
+    // Sends are not keyed by the fixed fd, so that they can be in flight
+    // while the connection's reader waits for data.
+    OperationFuture submit_send(std::chrono::nanoseconds timeout);
 
 public:
     explicit ConnectionWriter(int fixed_fd);
 
+    // A writer whose output does not go to a socket, such as an HTTP/2
+    // stream's body. fixed_fd() is then -1.
+    explicit ConnectionWriter(Sink sink);
+
     ~ConnectionWriter() = default;
 
     ConnectionWriter(const ConnectionWriter &) = delete;
@@ -42,6 +75,46 @@ public:
 
     [[nodiscard]] int fixed_fd() const { return fixed_fd_; }
 
+    [[nodiscard]] std::string_view buffered() const {
+        return {buffer_.data() + begin_, end_ - begin_};
+    }
+
+    [[nodiscard]] u64 flush_count() const { return flush_count_; }
+
+    // Whether the connection must be closed once the current response has
+    // been sent, because its end cannot be delimited otherwise.
+    [[nodiscard]] bool close_requested() const { return close_requested_; }
+
+    void request_close() { close_requested_ = true; }
+
+    // Starts measuring a response against the server's response write timeout
+    // and minimum send rate. Until then, and after finish_response(), sends
+    // are only bounded by the write timeout and the rate over all of them.
+    void start_response() {
+        timing_response_ = true;
+        response_deadline_.reset();
+        send_time_ = {};
+        sent_size_ = 0;
+    }
+
+    void finish_response() {
+        timing_response_ = false;
+        response_deadline_.reset();
+    }
+
+    std::span<u8> spare_capacity() {
+        acquire_buffer();
+        auto *data = reinterpret_cast<u8 *>(buffer_.data());
+        return {data + end_, data + buffer_.size()};
+    }
+
+    void commit(std::size_t num_bytes) { end_ += num_bytes; }
+
+    void clear() {
+        begin_ = 0;
+        end_ = 0;
+    }
+
     Task<std::optional<Error>> flush();
 
     Task<std::optional<Error>> write(std::string_view str);
@@ -15,6 +15,13 @@ enum class Error {
     INVALID_REQUEST,
     WRITE_ERROR,
     UNEXPECTED_RESPONSE_STATE,
+    DEADLINE_EXCEEDED,
+    CONNECT_ERROR,
+    INVALID_RESPONSE,
+    // The client sent the HTTP/2 connection preface instead of a request.
+    HTTP2_PREFACE,
+    // The peer did not take what was sent to it in time, or too slowly.
+    WRITE_TIMED_OUT,
 };
 
 } // namespace co_http_uring
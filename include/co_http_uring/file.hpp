@@ -0,0 +1,64 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_FILE_HPP
+#define CO_HTTP_URING_FILE_HPP
+
+#include "task.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <variant>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/stat.h>
+}
+
+namespace co_http_uring {
+
+// A file opened as a direct descriptor in the current thread's server ring.
+// Every operation is submitted to that ring, so a File must only be used from
+// the thread that opened it, and must be closed explicitly.
+class File {
+    int fixed_fd_ = -1;
+
+public:
+    File() = default;
+
+    explicit File(int fixed_fd) : fixed_fd_{fixed_fd} {}
+
+    static Task<std::variant<File, std::error_code>>
+    open(std::string path, int flags, mode_t mode = 0);
+
+    static Task<std::variant<struct statx, std::error_code>>
+    stat(std::string path, unsigned int mask = STATX_BASIC_STATS);
+
+    [[nodiscard]] int fixed_fd() const { return fixed_fd_; }
+
+    Task<std::variant<std::size_t, std::error_code>>
+    read(std::span<char> buffer, u64 offset) const;
+
+    // Reads into a buffer registered with IoUring::register_buffers().
+    // `buffer` must lie within the registered buffer at `buffer_index`.
+    Task<std::variant<std::size_t, std::error_code>>
+    read_fixed(std::span<char> buffer, u64 offset, int buffer_index) const;
+
+    Task<std::variant<std::size_t, std::error_code>>
+    write(std::span<const char> data, u64 offset) const;
+
+    Task<std::variant<std::size_t, std::error_code>>
+    write_fixed(std::span<const char> data, u64 offset, int buffer_index) const;
+
+    Task<std::optional<std::error_code>> fsync(bool data_only = false) const;
+
+    Task<std::optional<std::error_code>> close();
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_FILE_HPP
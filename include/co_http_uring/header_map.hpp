@@ -0,0 +1,121 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_HEADER_MAP_HPP
+#define CO_HTTP_URING_HEADER_MAP_HPP
+
+#include "known_headers.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace co_http_uring {
+
+// Header field values by lowercase field name, shared by requests and
+// client-side responses. Well-known fields are found by ID through a fixed
+// index, and the others through a hash map of their names. Iteration follows
+// the order in which fields first appeared. Everything is allocated from the
+// map's memory resource.
+class HeaderMap {
+public:
+    using Values = std::pmr::vector<std::pmr::string>;
+    using Field = std::pair<std::pmr::string, Values>;
+
+private:
+    // Case-insensitive, so that names can be looked up as they are.
+    struct NameHash {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view name) const;
+    };
+
+    struct NameEqual {
+        using is_transparent = void;
+
+        bool operator()(std::string_view a, std::string_view b) const;
+    };
+
+    std::pmr::vector<Field> fields_;
+    // One more than the index in fields_ of each well-known field, or 0.
+    std::array<u32, KNOWN_HEADER_COUNT> known_{};
+    std::pmr::unordered_map<std::pmr::string, u32, NameHash, NameEqual>
+        unknown_;
+
+    [[nodiscard]] const Field *find_field(std::string_view name) const;
+
+    // Erases the field at `index` - 1, if `index` is not 0.
+    void erase_field(u32 index);
+
+public:
+    explicit HeaderMap(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource()
+    ) :
+        fields_{resource},
+        unknown_{resource} {
+    }
+
+    [[nodiscard]] std::pmr::memory_resource *resource() const {
+        return fields_.get_allocator().resource();
+    }
+
+    [[nodiscard]] std::pmr::vector<Field>::const_iterator begin() const {
+        return fields_.cbegin();
+    }
+
+    [[nodiscard]] std::pmr::vector<Field>::const_iterator end() const {
+        return fields_.cend();
+    }
+
+    [[nodiscard]] std::size_t size() const { return fields_.size(); }
+
+    [[nodiscard]] bool empty() const { return fields_.empty(); }
+
+    // Appends a value, trimmed of whitespace, to the field `name`.
+    void add(std::string_view name, std::string_view value);
+
+    [[nodiscard]] const Values *find(Header header) const {
+        u32 index = known_[static_cast<std::size_t>(header)];
+        return index == 0 ? nullptr : &fields_[index - 1].second;
+    }
+
+    [[nodiscard]] const Values *find(std::string_view name) const {
+        const Field *field = find_field(name);
+        return field == nullptr ? nullptr : &field->second;
+    }
+
+    [[nodiscard]] bool contains(Header header) const {
+        return known_[static_cast<std::size_t>(header)] != 0;
+    }
+
+    [[nodiscard]] bool contains(std::string_view name) const {
+        return find_field(name) != nullptr;
+    }
+
+    // Whether a field holding a list of tokens, such as Connection, contains
+    // `token`, ignoring case.
+    [[nodiscard]] bool contains_token(Header header, std::string_view token)
+        const;
+
+    void erase(Header header);
+
+    void erase(std::string_view name);
+
+    void clear();
+};
+
+bool parse_header_line(HeaderMap &headers, std::string_view line);
+
+// Leaves `content_length` untouched when there is no Content-Length header.
+// Returns false if the header is malformed or repeated with different values.
+bool parse_content_length(const HeaderMap &headers, u64 &content_length);
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_HEADER_MAP_HPP
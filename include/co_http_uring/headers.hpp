@@ -8,9 +8,24 @@
 
 namespace co_http_uring::headers {
 
+constexpr std::string_view ACCEPT_ENCODING = "accept-encoding";
 constexpr std::string_view CONNECTION = "connection";
+constexpr std::string_view CONTENT_ENCODING = "content-encoding";
 constexpr std::string_view CONTENT_LENGTH = "content-length";
+constexpr std::string_view EXPECT = "expect";
 constexpr std::string_view HOST = "host";
+constexpr std::string_view HTTP2_SETTINGS = "http2-settings";
+constexpr std::string_view KEEP_ALIVE = "keep-alive";
+constexpr std::string_view PROXY_AUTHENTICATE = "proxy-authenticate";
+constexpr std::string_view PROXY_AUTHORIZATION = "proxy-authorization";
+constexpr std::string_view PROXY_CONNECTION = "proxy-connection";
+constexpr std::string_view SEC_WEBSOCKET_KEY = "sec-websocket-key";
+constexpr std::string_view SEC_WEBSOCKET_VERSION = "sec-websocket-version";
+constexpr std::string_view TE = "te";
+constexpr std::string_view TRAILER = "trailer";
+constexpr std::string_view TRANSFER_ENCODING = "transfer-encoding";
+constexpr std::string_view UPGRADE = "upgrade";
+constexpr std::string_view VARY = "vary";
 
 } // namespace co_http_uring::headers
 
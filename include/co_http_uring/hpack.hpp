@@ -0,0 +1,92 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_HPACK_HPP
+#define CO_HTTP_URING_HPACK_HPP
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace co_http_uring {
+
+// Header fields in the order of a header block, with lowercase names.
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+// The static table of RFC 7541 followed by one direction's dynamic table,
+// whose oldest entries are evicted once their total size exceeds its maximum.
+class HpackTable {
+    std::deque<std::pair<std::string, std::string>> entries_;
+    std::size_t size_{};
+    std::size_t max_size_;
+
+    void evict(std::size_t max_size);
+
+public:
+    static constexpr std::size_t DEFAULT_MAX_SIZE = 4096;
+
+    explicit HpackTable(std::size_t max_size = DEFAULT_MAX_SIZE) :
+        max_size_{max_size} {}
+
+    [[nodiscard]] std::size_t max_size() const { return max_size_; }
+
+    void set_max_size(std::size_t max_size);
+
+    void insert(std::string_view name, std::string_view value);
+
+    // Indices start at 1, and the dynamic table's at 62.
+    [[nodiscard]] std::optional<std::pair<std::string_view, std::string_view>>
+    get(std::size_t index) const;
+
+    // The index of an entry matching both `name` and `value`, or failing
+    // that the negated index of one matching `name`, or 0.
+    [[nodiscard]] i64 find(std::string_view name, std::string_view value) const;
+};
+
+class HpackDecoder {
+    HpackTable table_;
+    std::size_t max_table_size_;
+
+public:
+    // `max_table_size` is the SETTINGS_HEADER_TABLE_SIZE sent to the peer,
+    // which bounds the size updates it may encode.
+    explicit HpackDecoder(
+        std::size_t max_table_size = HpackTable::DEFAULT_MAX_SIZE
+    ) :
+        table_{max_table_size},
+        max_table_size_{max_table_size} {}
+
+    // Decodes a complete header block, appending to `fields`. Returns false
+    // on a compression error, or once the fields' size exceeds
+    // `max_list_size`, after which the decoder is unusable. Fields count as
+    // in SETTINGS_MAX_HEADER_LIST_SIZE (RFC 9113, section 6.5.2).
+    bool decode(
+        std::string_view block,
+        HeaderList &fields,
+        std::size_t max_list_size = std::numeric_limits<std::size_t>::max()
+    );
+};
+
+// Indexes fields worth reusing in its dynamic table, and Huffman-codes
+// strings when that makes them shorter.
+class HpackEncoder {
+    HpackTable table_;
+    std::optional<std::size_t> pending_size_update_;
+
+public:
+    // Applies the peer's SETTINGS_HEADER_TABLE_SIZE from the next block on.
+    void set_max_table_size(std::size_t max_table_size);
+
+    void encode(const HeaderList &fields, std::string &block);
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_HPACK_HPP
@@ -0,0 +1,231 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_HTTP2_HPP
+#define CO_HTTP_URING_HTTP2_HPP
+
+#include "compression.hpp"
+#include "connection_reader.hpp"
+#include "connection_writer.hpp"
+#include "error.hpp"
+#include "hpack.hpp"
+#include "request.hpp"
+#include "status_code.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace co_http_uring {
+
+class Http2Connection;
+class ResponseWriter;
+
+enum class Http2ErrorCode : u32 {
+    NO_ERROR = 0x0,
+    PROTOCOL_ERROR = 0x1,
+    INTERNAL_ERROR = 0x2,
+    FLOW_CONTROL_ERROR = 0x3,
+    STREAM_CLOSED = 0x5,
+    FRAME_SIZE_ERROR = 0x6,
+    REFUSED_STREAM = 0x7,
+    CANCEL = 0x8,
+    COMPRESSION_ERROR = 0x9,
+    ENHANCE_YOUR_CALM = 0xb,
+};
+
+// A request and its response on an HTTP/2 connection. The request's body
+// reads the stream's DATA frames, and what the response's writer flushes is
+// sent as DATA frames once the header section has been sent.
+class Http2Stream {
+    friend Http2Connection;
+
+    Http2Connection *connection_;
+    u32 id_;
+    Request request_;
+    ConnectionReader body_;
+    ConnectionWriter writer_;
+    // DATA payloads not yet read by the handler.
+    std::string received_;
+    u64 received_size_{};
+    i64 receive_window_;
+    // Bytes read since the receive window was last replenished.
+    u32 consumed_size_{};
+    i64 send_window_;
+    std::coroutine_handle<> waiter_;
+    std::optional<StatusCode> status_;
+    HeaderList headers_;
+    bool started_{};
+    bool end_stream_received_{};
+    bool headers_sent_{};
+    bool end_stream_sent_{};
+    bool reset_{};
+
+    // Resumes the stream's handler if it waits for data or flow control.
+    void wake();
+
+    Task<std::optional<Error>> receive();
+
+public:
+    Http2Stream(Http2Connection &connection, u32 id, i64 send_window);
+
+    Http2Stream(const Http2Stream &) = delete;
+    Http2Stream &operator=(const Http2Stream &) = delete;
+
+    [[nodiscard]] u32 id() const { return id_; }
+
+    void set_status(StatusCode code) { status_ = code; }
+
+    // Drops the connection-specific fields that HTTP/2 forbids.
+    void add_header(std::string_view name, std::string_view value);
+
+    ConnectionWriter &writer() { return writer_; }
+};
+
+// Serves a connection with HTTP/2 over cleartext TCP (h2c). Each stream is
+// handled by its own coroutine, like a request of an HTTP/1 connection, while
+// the connection's coroutine reads frames. Frames are written one at a time
+// under a lock, and the socket is flushed by whoever writes last.
+class Http2Connection {
+public:
+    using RequestHandler =
+        std::function<Task<>(const Request &, ResponseWriter)>;
+
+private:
+    friend Http2Stream;
+
+    struct Frame {
+        u32 length;
+        u8 type;
+        u8 flags;
+        u32 stream_id;
+    };
+
+    struct WriteLock;
+
+    ConnectionReader *reader_;
+    ConnectionWriter *writer_;
+    const RequestHandler *handler_;
+    std::optional<CompressionOptions> compression_;
+    std::size_t max_header_list_size_;
+    HpackDecoder decoder_;
+    HpackEncoder encoder_;
+    u32 peer_initial_window_size_;
+    u32 peer_max_frame_size_;
+    std::map<u32, std::unique_ptr<Http2Stream>> streams_;
+    u32 last_stream_id_{};
+    std::size_t running_streams_{};
+    i64 send_window_;
+    i64 receive_window_;
+    std::string header_block_;
+    u32 header_block_stream_id_{};
+    bool header_block_end_stream_{};
+    bool writing_{};
+    std::deque<std::coroutine_handle<>> write_waiters_;
+    std::coroutine_handle<> closing_waiter_;
+    bool input_closed_{};
+    bool output_failed_{};
+
+    WriteLock lock_writer();
+
+    // Flushes the socket unless another coroutine waits to write, in which
+    // case it takes over the lock and flushes later.
+    Task<std::optional<Error>> unlock_writer();
+
+    Task<std::optional<Error>>
+    write_frame(u8 type, u8 flags, u32 stream_id, std::string_view payload);
+
+    Task<std::optional<Error>>
+    send_frame(u8 type, u8 flags, u32 stream_id, std::string_view payload);
+
+    Task<std::optional<Error>> write_preface();
+
+    Task<std::optional<Error>>
+    write_headers(Http2Stream &stream, bool end_stream);
+
+    Task<std::optional<Error>>
+    send_data(Http2Stream &stream, std::string_view data, bool end_stream);
+
+    Task<> send_window_update(u32 stream_id, u32 increment);
+
+    Task<> send_rst_stream(u32 stream_id, Http2ErrorCode code);
+
+    Task<> send_goaway(Http2ErrorCode code);
+
+    Task<> update_receive_window(Http2Stream &stream);
+
+    void wake_streams();
+
+    // Forgets the stream at once if its handler has not started.
+    Task<> reset_stream(Http2Stream &stream, Http2ErrorCode code);
+
+    bool make_request(Http2Stream &stream, HeaderList &&fields);
+
+    void start_stream(Http2Stream &stream);
+
+    Task<> run_stream(Http2Stream &stream);
+
+    std::optional<Http2ErrorCode> apply_settings(std::string_view payload);
+
+    Task<std::optional<Http2ErrorCode>>
+    handle_data(const Frame &frame, std::string_view payload);
+
+    Task<std::optional<Http2ErrorCode>>
+    handle_headers(const Frame &frame, std::string_view payload);
+
+    Task<std::optional<Http2ErrorCode>>
+    handle_continuation(const Frame &frame, std::string_view payload);
+
+    Task<std::optional<Http2ErrorCode>> handle_header_block();
+
+    std::optional<Http2ErrorCode>
+    handle_rst_stream(const Frame &frame, std::string_view payload);
+
+    Task<std::optional<Http2ErrorCode>>
+    handle_settings(const Frame &frame, std::string_view payload);
+
+    Task<std::optional<Http2ErrorCode>>
+    handle_ping(const Frame &frame, std::string_view payload);
+
+    Task<std::optional<Http2ErrorCode>>
+    handle_window_update(const Frame &frame, std::string_view payload);
+
+    Task<std::optional<Http2ErrorCode>>
+    handle_frame(const Frame &frame, std::string_view payload);
+
+public:
+    // `max_header_list_size` also bounds the body buffered for requests
+    // without a Content-Length, whose handler only starts once it is whole.
+    Http2Connection(
+        ConnectionReader &reader,
+        ConnectionWriter &writer,
+        const RequestHandler &handler,
+        std::optional<CompressionOptions> compression,
+        std::size_t max_header_list_size
+    );
+
+    Http2Connection(const Http2Connection &) = delete;
+    Http2Connection &operator=(const Http2Connection &) = delete;
+
+    // Whether an HTTP/1.1 request asks to upgrade to h2c in a way that can be
+    // honored: with valid HTTP2-Settings and without a body.
+    static bool is_upgrade_request(const Request &request);
+
+    // Serves the connection until the client closes it and every stream's
+    // handler has returned. Without an upgrade request, the client sent the
+    // connection preface, whose request line has been read already. With
+    // one, it is answered on stream 1.
+    Task<> serve(std::optional<Request> upgrade_request);
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_HTTP2_HPP
@@ -0,0 +1,106 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_HTTP_CLIENT_HPP
+#define CO_HTTP_URING_HTTP_CLIENT_HPP
+
+#include "client_response.hpp"
+#include "connection.hpp"
+#include "connection_writer.hpp"
+#include "error.hpp"
+#include "socket_address.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace co_http_uring {
+
+struct ClientRequest {
+    std::string method{"GET"};
+    std::string target{"/"};
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+};
+
+// An HTTP/1.1 client for one upstream address, running on the ring of the
+// current thread's server. Connections are kept alive and reused, so an
+// instance must only be used from the thread that created it.
+class HttpClient {
+    Ipv4Address address_;
+    std::string host_;
+    std::chrono::seconds connect_timeout_;
+    std::size_t max_idle_connections_;
+    u64 max_response_body_size_;
+    std::vector<std::unique_ptr<Connection>> idle_connections_;
+
+    Task<std::optional<Error>>
+    write_request(ConnectionWriter &writer, const ClientRequest &request);
+
+public:
+    explicit HttpClient(const Ipv4Address &address);
+
+    ~HttpClient() = default;
+
+    HttpClient(const HttpClient &) = delete;
+    HttpClient &operator=(const HttpClient &) = delete;
+
+    HttpClient(HttpClient &&) = default;
+    HttpClient &operator=(HttpClient &&) = default;
+
+    // The current thread's client for `address`.
+    static HttpClient &for_address(const Ipv4Address &address);
+
+    [[nodiscard]] const Ipv4Address &address() const { return address_; }
+
+    [[nodiscard]] const std::string &host() const { return host_; }
+
+    [[nodiscard]] std::chrono::seconds connect_timeout() const {
+        return connect_timeout_;
+    }
+
+    void set_connect_timeout(std::chrono::seconds connect_timeout) {
+        connect_timeout_ = connect_timeout;
+    }
+
+    [[nodiscard]] std::size_t max_idle_connections() const {
+        return max_idle_connections_;
+    }
+
+    void set_max_idle_connections(std::size_t max_idle_connections) {
+        max_idle_connections_ = max_idle_connections;
+    }
+
+    [[nodiscard]] u64 max_response_body_size() const {
+        return max_response_body_size_;
+    }
+
+    void set_max_response_body_size(u64 max_response_body_size) {
+        max_response_body_size_ = max_response_body_size;
+    }
+
+    [[nodiscard]] std::size_t idle_connections() const {
+        return idle_connections_.size();
+    }
+
+    // Takes the most recently used idle connection, if any.
+    std::unique_ptr<Connection> take_idle();
+
+    Task<std::variant<std::unique_ptr<Connection>, Error>> connect();
+
+    // Returns a connection to the idle pool, or closes it.
+    void release(std::unique_ptr<Connection> conn, bool keep_alive);
+
+    Task<std::variant<ClientResponse, Error>> send(ClientRequest request);
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_HTTP_CLIENT_HPP
@@ -11,6 +11,9 @@ namespace co_http_uring::http_utils {
 
 constexpr std::string_view HTTP_1_VERSION_PREFIX = "HTTP/1.";
 
+// How the HTTP/2 connection preface looks to an HTTP/1 request parser.
+constexpr std::string_view HTTP2_PREFACE_REQUEST_LINE = "PRI * HTTP/2.0";
+
 bool is_token(std::string_view str);
 
 bool is_digit(unsigned char c);
@@ -21,8 +24,22 @@ bool is_field_value(std::string_view str);
 
 std::string make_header_name(std::string_view name);
 
+// Compares ASCII strings, such as header names, case-insensitively.
+bool equals_ignore_case(std::string_view a, std::string_view b);
+
+// Trims the whitespace around a header value.
+std::string_view trim_header_value(std::string_view value);
+
 std::string make_header_value(std::string_view value);
 
+// Whether a comma-separated list of tokens, such as a Connection header's
+// value, contains `token`, ignoring case.
+bool contains_token(std::string_view list, std::string_view token);
+
+// Whether a request with this method can be sent again when an idle upstream
+// connection turns out to have been closed (RFC 9110, section 9.2.2).
+bool is_idempotent_method(std::string_view method);
+
 } // namespace co_http_uring::http_utils
 
 #endif // CO_HTTP_URING_HTTP_UTILS_HPP
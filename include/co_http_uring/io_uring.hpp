@@ -8,12 +8,16 @@
 
 #include <liburing.h>
 
+#include <chrono>
 #include <cstddef>
+#include <optional>
 #include <vector>
 
 extern "C" {
 #include <linux/time_types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 };
 
 namespace co_http_uring {
@@ -36,6 +40,13 @@ public:
 
     void set_flags(unsigned int flags) { io_uring_sqe_set_flags(sqe_, flags); }
 
+    // Has the kernel pick the operation's buffer from a provided buffer ring.
+    // Must be called after the SQE is prepared and its flags are set.
+    void set_buffer_group(u16 group_id) {
+        sqe_->flags |= IOSQE_BUFFER_SELECT;
+        sqe_->buf_group = group_id;
+    }
+
     void prep_multishot_accept_direct(
         int fd,
         sockaddr *addr,
@@ -45,18 +56,147 @@ public:
         io_uring_prep_multishot_accept_direct(sqe_, fd, addr, addrlen, flags);
     }
 
+    void prep_socket_direct_alloc(
+        int domain,
+        int type,
+        int protocol,
+        unsigned int flags
+    ) {
+        io_uring_prep_socket_direct_alloc(sqe_, domain, type, protocol, flags);
+    }
+
+    void prep_cmd_sock(
+        int cmd_op,
+        int fd,
+        int level,
+        int optname,
+        void *optval,
+        int optlen
+    ) {
+        io_uring_prep_cmd_sock(
+            sqe_,
+            cmd_op,
+            fd,
+            level,
+            optname,
+            optval,
+            optlen
+        );
+    }
+
+    void prep_connect(int fd, const sockaddr *addr, socklen_t addrlen) {
+        io_uring_prep_connect(sqe_, fd, addr, addrlen);
+    }
+
+    void prep_timeout(
+        __kernel_timespec *ts,
+        unsigned int count,
+        unsigned int flags
+    ) {
+        io_uring_prep_timeout(sqe_, ts, count, flags);
+    }
+
+    void prep_timeout_remove(u64 user_data, unsigned int flags) {
+        io_uring_prep_timeout_remove(sqe_, user_data, flags);
+    }
+
     void prep_link_timeout(__kernel_timespec *ts) {
         io_uring_prep_link_timeout(sqe_, ts, 0);
     }
 
+    void prep_cancel(u64 user_data) {
+        io_uring_prep_cancel64(sqe_, user_data, 0);
+    }
+
+    void prep_msg_ring_fd(
+        int fd,
+        int source_fd,
+        int target_fd,
+        u64 data,
+        unsigned int flags
+    ) {
+        io_uring_prep_msg_ring_fd(sqe_, fd, source_fd, target_fd, data, flags);
+    }
+
+    void prep_poll_add(int fd, unsigned int poll_mask) {
+        io_uring_prep_poll_add(sqe_, fd, poll_mask);
+    }
+
     void prep_close_direct(unsigned int file_index) {
         io_uring_prep_close_direct(sqe_, file_index);
     }
 
+    void prep_openat_direct(
+        int dfd,
+        const char *path,
+        int flags,
+        mode_t mode,
+        unsigned int file_index
+    ) {
+        io_uring_prep_openat_direct(sqe_, dfd, path, flags, mode, file_index);
+    }
+
+    void prep_statx(
+        int dfd,
+        const char *path,
+        int flags,
+        unsigned int mask,
+        struct statx *statxbuf
+    ) {
+        io_uring_prep_statx(sqe_, dfd, path, flags, mask, statxbuf);
+    }
+
+    void prep_fsync(int fd, unsigned int fsync_flags) {
+        io_uring_prep_fsync(sqe_, fd, fsync_flags);
+    }
+
     void prep_read(int fd, void *buf, unsigned int nbytes, u64 offset) {
         io_uring_prep_read(sqe_, fd, buf, nbytes, offset);
     }
 
+    void prep_read_fixed(
+        int fd,
+        void *buf,
+        unsigned int nbytes,
+        u64 offset,
+        int buf_index
+    ) {
+        io_uring_prep_read_fixed(sqe_, fd, buf, nbytes, offset, buf_index);
+    }
+
+    void prep_write(int fd, const void *buf, unsigned int nbytes, u64 offset) {
+        io_uring_prep_write(sqe_, fd, buf, nbytes, offset);
+    }
+
+    void prep_write_fixed(
+        int fd,
+        const void *buf,
+        unsigned int nbytes,
+        u64 offset,
+        int buf_index
+    ) {
+        io_uring_prep_write_fixed(sqe_, fd, buf, nbytes, offset, buf_index);
+    }
+
+    void prep_splice(
+        int fd_in,
+        i64 off_in,
+        int fd_out,
+        i64 off_out,
+        unsigned int nbytes,
+        unsigned int splice_flags
+    ) {
+        io_uring_prep_splice(
+            sqe_,
+            fd_in,
+            off_in,
+            fd_out,
+            off_out,
+            nbytes,
+            splice_flags
+        );
+    }
+
     void prep_send(int sockfd, void *buf, std::size_t len, int flags) {
         io_uring_prep_send(sqe_, sockfd, buf, len, flags);
     }
@@ -105,16 +245,35 @@ public:
     IoUring(IoUring &&) = default;
     IoUring &operator=(IoUring &&) = default;
 
+    [[nodiscard]] int fd() const { return ring_.ring_fd; }
+
     void register_files(const std::vector<int> &files);
 
+    void register_buffers(const std::vector<iovec> &buffers);
+
+    io_uring_buf_ring *setup_buf_ring(unsigned int entries, u16 group_id);
+
+    void free_buf_ring(
+        io_uring_buf_ring *buf_ring,
+        unsigned int entries,
+        u16 group_id
+    );
+
     IoUringSqe get_sqe();
 
     void submit();
 
     IoUringCqe peek_cqe();
 
+    std::optional<IoUringCqe> try_peek_cqe();
+
     IoUringCqe wait_cqe();
 
+    // Waits until `wait_nr` completions are ready or `timeout` has elapsed.
+    void wait_cqes(unsigned int wait_nr, std::chrono::microseconds timeout);
+
+    unsigned int cq_ready() { return io_uring_cq_ready(&ring_); }
+
     void seen_cqe(const IoUringCqe &cqe) {
         io_uring_cqe_seen(&ring_, cqe.cqe_);
     }
@@ -0,0 +1,146 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_KNOWN_HEADERS_HPP
+#define CO_HTTP_URING_KNOWN_HEADERS_HPP
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace co_http_uring {
+
+// Registered and widely used header fields, which header maps index by ID
+// instead of by name.
+enum class Header : u8 {
+    ACCEPT,
+    ACCEPT_CHARSET,
+    ACCEPT_ENCODING,
+    ACCEPT_LANGUAGE,
+    ACCEPT_PATCH,
+    ACCEPT_POST,
+    ACCEPT_RANGES,
+    ACCESS_CONTROL_ALLOW_CREDENTIALS,
+    ACCESS_CONTROL_ALLOW_HEADERS,
+    ACCESS_CONTROL_ALLOW_METHODS,
+    ACCESS_CONTROL_ALLOW_ORIGIN,
+    ACCESS_CONTROL_EXPOSE_HEADERS,
+    ACCESS_CONTROL_MAX_AGE,
+    ACCESS_CONTROL_REQUEST_HEADERS,
+    ACCESS_CONTROL_REQUEST_METHOD,
+    AGE,
+    ALLOW,
+    ALT_SVC,
+    AUTHORIZATION,
+    CACHE_CONTROL,
+    CACHE_STATUS,
+    CDN_CACHE_CONTROL,
+    CLEAR_SITE_DATA,
+    CONNECTION,
+    CONTENT_DISPOSITION,
+    CONTENT_ENCODING,
+    CONTENT_LANGUAGE,
+    CONTENT_LENGTH,
+    CONTENT_LOCATION,
+    CONTENT_RANGE,
+    CONTENT_SECURITY_POLICY,
+    CONTENT_SECURITY_POLICY_REPORT_ONLY,
+    CONTENT_TYPE,
+    COOKIE,
+    CROSS_ORIGIN_EMBEDDER_POLICY,
+    CROSS_ORIGIN_OPENER_POLICY,
+    CROSS_ORIGIN_RESOURCE_POLICY,
+    DATE,
+    DNT,
+    EARLY_DATA,
+    ETAG,
+    EXPECT,
+    EXPIRES,
+    FORWARDED,
+    FROM,
+    HOST,
+    HTTP2_SETTINGS,
+    IF_MATCH,
+    IF_MODIFIED_SINCE,
+    IF_NONE_MATCH,
+    IF_RANGE,
+    IF_UNMODIFIED_SINCE,
+    KEEP_ALIVE,
+    LAST_MODIFIED,
+    LINK,
+    LOCATION,
+    MAX_FORWARDS,
+    ORIGIN,
+    PERMISSIONS_POLICY,
+    PRAGMA,
+    PRIORITY,
+    PROXY_AUTHENTICATE,
+    PROXY_AUTHORIZATION,
+    PROXY_CONNECTION,
+    RANGE,
+    REFERER,
+    REFERRER_POLICY,
+    REFRESH,
+    RETRY_AFTER,
+    SEC_FETCH_DEST,
+    SEC_FETCH_MODE,
+    SEC_FETCH_SITE,
+    SEC_FETCH_USER,
+    SEC_WEBSOCKET_ACCEPT,
+    SEC_WEBSOCKET_EXTENSIONS,
+    SEC_WEBSOCKET_KEY,
+    SEC_WEBSOCKET_PROTOCOL,
+    SEC_WEBSOCKET_VERSION,
+    SERVER,
+    SERVER_TIMING,
+    SET_COOKIE,
+    STRICT_TRANSPORT_SECURITY,
+    TE,
+    TIMING_ALLOW_ORIGIN,
+    TRAILER,
+    TRANSFER_ENCODING,
+    UPGRADE,
+    UPGRADE_INSECURE_REQUESTS,
+    USER_AGENT,
+    VARY,
+    VIA,
+    WARNING,
+    WWW_AUTHENTICATE,
+    X_CONTENT_TYPE_OPTIONS,
+    X_FORWARDED_FOR,
+    X_FORWARDED_HOST,
+    X_FORWARDED_PROTO,
+    X_FRAME_OPTIONS,
+    X_REQUEST_ID,
+    X_REQUESTED_WITH,
+    X_XSS_PROTECTION,
+};
+
+constexpr std::size_t KNOWN_HEADER_COUNT =
+    static_cast<std::size_t>(Header::X_XSS_PROTECTION) + 1;
+
+// FNV-1a over the lowercase name, so that names hash alike whatever their
+// case.
+constexpr u32 hash_header_name(std::string_view name) {
+    u32 hash = 2166136261;
+
+    for (char c : name) {
+        hash ^= static_cast<u8>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+// The lowercase name of `header`.
+std::string_view header_name(Header header);
+
+// Looks `name` up case-insensitively through a perfect hash, without
+// allocating.
+std::optional<Header> find_header(std::string_view name);
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_KNOWN_HEADERS_HPP
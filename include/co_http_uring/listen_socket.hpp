@@ -0,0 +1,57 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_LISTEN_SOCKET_HPP
+#define CO_HTTP_URING_LISTEN_SOCKET_HPP
+
+#include "io_uring.hpp"
+#include "socket_address.hpp"
+#include "socket_options.hpp"
+
+#include <string>
+#include <utility>
+
+namespace co_http_uring {
+
+// A listening stream socket of any address family. A Unix socket bound to a
+// filesystem path removes its file when destroyed.
+class ListenSocket {
+    int fd_;
+    std::string unix_path_;
+
+public:
+    explicit ListenSocket(int family);
+
+    ~ListenSocket();
+
+    ListenSocket(const ListenSocket &) = delete;
+    ListenSocket &operator=(const ListenSocket &) = delete;
+
+    ListenSocket(ListenSocket &&other) noexcept :
+        fd_{std::exchange(other.fd_, -1)},
+        unix_path_{std::move(other.unix_path_)} {
+        other.unix_path_.clear();
+    }
+
+    ListenSocket &operator=(ListenSocket &&other) noexcept {
+        std::swap(fd_, other.fd_);
+        std::swap(unix_path_, other.unix_path_);
+        return *this;
+    }
+
+    // IP sockets are bound with SO_REUSEPORT, so that every thread's server
+    // can listen on the same address. A Unix path can only be bound once.
+    void bind(const SocketAddress &address);
+
+    void listen(int max_pending_conns) const;
+
+    void set_option(const SocketOption &option) const;
+
+    void prep_multishot_accept_direct(IoUringSqe &sqe) const {
+        sqe.prep_multishot_accept_direct(fd_, nullptr, nullptr, 0);
+    }
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_LISTEN_SOCKET_HPP
@@ -0,0 +1,85 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_OFFLOAD_HPP
+#define CO_HTTP_URING_OFFLOAD_HPP
+
+#include "server.hpp"
+#include "thread_pool.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace co_http_uring {
+
+template <typename F>
+class OffloadAwaitable {
+    using Result = std::invoke_result_t<F &>;
+    using Storage =
+        std::conditional_t<std::is_void_v<Result>, std::monostate, Result>;
+
+    ThreadPool *pool_;
+    F fn_;
+    std::optional<Storage> result_;
+    std::exception_ptr exception_;
+
+public:
+    OffloadAwaitable(ThreadPool &pool, F fn) :
+        pool_{&pool},
+        fn_{std::move(fn)} {
+    }
+
+    [[nodiscard]] bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> coroutine) {
+        Server *server = Server::thread_instance();
+
+        // An exception is rethrown on the server's thread, as it would
+        // otherwise terminate the worker and leave the coroutine suspended.
+        pool_->submit([this, server, coroutine] {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    std::invoke(fn_);
+                    result_.emplace();
+                } else {
+                    result_.emplace(std::invoke(fn_));
+                }
+            } catch (...) {
+                exception_ = std::current_exception();
+            }
+
+            server->schedule_remote(coroutine);
+        });
+    }
+
+    Result await_resume() {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+
+        if constexpr (!std::is_void_v<Result>) {
+            return std::move(*result_);
+        }
+    }
+};
+
+// Runs `fn` on a worker thread of `pool`, then resumes the awaiting coroutine
+// on the thread of the server it was running on.
+template <typename F>
+OffloadAwaitable<F> offload(ThreadPool &pool, F fn) {
+    return {pool, std::move(fn)};
+}
+
+template <typename F>
+OffloadAwaitable<F> offload(F fn) {
+    return {ThreadPool::shared(), std::move(fn)};
+}
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_OFFLOAD_HPP
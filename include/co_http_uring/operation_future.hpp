@@ -0,0 +1,55 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_OPERATION_FUTURE_HPP
+#define CO_HTTP_URING_OPERATION_FUTURE_HPP
+
+#include "io_uring.hpp"
+#include "server.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <fmt/core.h>
+
+#include <coroutine>
+#include <cstdio>
+
+namespace co_http_uring {
+
+// Awaits the single CQE of an operation submitted with a key obtained from
+// Server::allocate_operation_key(), and resumes with its result.
+class OperationFuture {
+    i64 key_;
+
+public:
+    explicit OperationFuture(i64 key) : key_{key} {}
+
+    [[nodiscard]] bool await_ready() const { return false; }
+
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> coroutine) const {
+        auto [it, inserted] =
+            Server::thread_instance()->coroutines().emplace(key_, coroutine);
+
+        if (!inserted) {
+            fmt::print(stderr, "operation key reused\n");
+        }
+
+        await_operation(coroutine, key_);
+    }
+
+    i32 await_resume() const {
+        Server *server = Server::thread_instance();
+        server->coroutines().erase(key_);
+
+        IoUring &ring = server->ring();
+        IoUringCqe cqe = ring.peek_cqe();
+        i32 res = cqe.res();
+        ring.seen_cqe(cqe);
+        return res;
+    }
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_OPERATION_FUTURE_HPP
@@ -0,0 +1,63 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_PIPE_HPP
+#define CO_HTTP_URING_PIPE_HPP
+
+#include "task.hpp"
+#include "types.hpp"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+
+namespace co_http_uring {
+
+// A pipe used as the kernel-side buffer of io_uring splices between two
+// direct descriptors. Pipes are pooled per thread.
+class Pipe {
+    int read_fd_;
+    int write_fd_;
+
+public:
+    // The default capacity of a pipe. Splicing at most this much into an
+    // empty pipe never blocks on the pipe itself.
+    static constexpr unsigned int CAPACITY = 64 * 1024;
+
+    Pipe();
+
+    ~Pipe();
+
+    Pipe(const Pipe &) = delete;
+    Pipe &operator=(const Pipe &) = delete;
+
+    static std::unique_ptr<Pipe> acquire();
+
+    // Only pipes that were fully drained may be released, since leftover
+    // bytes would end up in another stream.
+    static void release(std::unique_ptr<Pipe> pipe);
+
+    // Moves up to `size` bytes from `fixed_fd` into the pipe. An offset of -1
+    // reads from the current position, as sockets require. With a timeout,
+    // `fixed_fd` must be pollable, and the call fails with -ECANCELED if it
+    // does not become readable in time.
+    Task<i32> fill_from(
+        int fixed_fd,
+        i64 offset,
+        unsigned int size,
+        std::optional<std::chrono::seconds> timeout = {}
+    );
+
+    // Moves up to `size` bytes from the pipe to `fixed_fd`, with the same
+    // offset and timeout rules.
+    Task<i32> drain_to(
+        int fixed_fd,
+        i64 offset,
+        unsigned int size,
+        std::optional<std::chrono::seconds> timeout = {}
+    );
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_PIPE_HPP
@@ -0,0 +1,61 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_POOLED_BUFFER_HPP
+#define CO_HTTP_URING_POOLED_BUFFER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace co_http_uring {
+
+// A connection buffer borrowed from the current thread's pool. Sizes are
+// rounded up to a power of two from MIN_SIZE, and buffers up to MAX_SIZE go
+// back to the pool of the thread releasing them instead of being freed.
+class PooledBuffer {
+    std::unique_ptr<char[]> data_;
+    std::size_t size_{};
+
+    PooledBuffer(std::unique_ptr<char[]> data, std::size_t size) :
+        data_{std::move(data)}, size_{size} {}
+
+public:
+    static constexpr std::size_t MIN_SIZE = 8192;
+    static constexpr std::size_t MAX_SIZE = 1024 * 1024;
+
+    PooledBuffer() = default;
+
+    ~PooledBuffer() { release(); }
+
+    PooledBuffer(const PooledBuffer &) = delete;
+    PooledBuffer &operator=(const PooledBuffer &) = delete;
+
+    PooledBuffer(PooledBuffer &&other) noexcept :
+        data_{std::move(other.data_)}, size_{std::exchange(other.size_, 0)} {}
+
+    PooledBuffer &operator=(PooledBuffer &&other) noexcept {
+        if (this != &other) {
+            release();
+            data_ = std::move(other.data_);
+            size_ = std::exchange(other.size_, 0);
+        }
+
+        return *this;
+    }
+
+    // A buffer of at least `min_size` bytes.
+    static PooledBuffer acquire(std::size_t min_size = MIN_SIZE);
+
+    void release();
+
+    explicit operator bool() const { return data_ != nullptr; }
+
+    [[nodiscard]] char *data() const { return data_.get(); }
+
+    [[nodiscard]] std::size_t size() const { return size_; }
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_POOLED_BUFFER_HPP
@@ -0,0 +1,37 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_PROBES_HPP
+#define CO_HTTP_URING_PROBES_HPP
+
+// USDT probes of the co_http_uring provider, which bpftrace and perf can
+// attach to in a running server. An unattached probe is a single NOP. Without
+// <sys/sdt.h> (systemtap-sdt-dev), probes compile to nothing.
+//
+// accept(fixed_fd)
+// recv(fixed_fd, bytes)
+// request(fixed_fd, method, method_size, target, target_size)
+// handler_start(fixed_fd)
+// handler_end(fixed_fd)
+// flush(fixed_fd, bytes)
+// close(fixed_fd)
+//
+// Strings are not null-terminated, hence their sizes. The streams of an HTTP/2
+// connection share its fixed fd, so their probes interleave.
+
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+
+#define CO_HTTP_URING_PROBE1(name, a) DTRACE_PROBE1(co_http_uring, name, a)
+#define CO_HTTP_URING_PROBE2(name, a, b) \
+    DTRACE_PROBE2(co_http_uring, name, a, b)
+#define CO_HTTP_URING_PROBE5(name, a, b, c, d, e) \
+    DTRACE_PROBE5(co_http_uring, name, a, b, c, d, e)
+#else
+#define CO_HTTP_URING_PROBE1(name, a) ((void)(a))
+#define CO_HTTP_URING_PROBE2(name, a, b) ((void)(a), (void)(b))
+#define CO_HTTP_URING_PROBE5(name, a, b, c, d, e) \
+    ((void)(a), (void)(b), (void)(c), (void)(d), (void)(e))
+#endif
+
+#endif // CO_HTTP_URING_PROBES_HPP
@@ -0,0 +1,31 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_PROXY_HANDLER_HPP
+#define CO_HTTP_URING_PROXY_HANDLER_HPP
+
+#include "request.hpp"
+#include "response_writer.hpp"
+#include "socket_address.hpp"
+#include "task.hpp"
+
+namespace co_http_uring {
+
+// A request handler forwarding every request to one upstream server.
+// Bodies that are not already buffered are moved between the client and
+// upstream sockets with splice(2) through a pipe, without being copied to
+// user space. Upstream connections are pooled by the thread's HttpClient.
+class ProxyHandler {
+    Ipv4Address upstream_;
+
+public:
+    explicit ProxyHandler(const Ipv4Address &upstream);
+
+    [[nodiscard]] const Ipv4Address &upstream() const { return upstream_; }
+
+    Task<> operator()(const Request &req, ResponseWriter res) const;
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_PROXY_HANDLER_HPP
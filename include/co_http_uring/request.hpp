@@ -4,17 +4,19 @@
 #ifndef CO_HTTP_URING_REQUEST_HPP
 #define CO_HTTP_URING_REQUEST_HPP
 
+#include "compression.hpp"
 #include "connection_reader.hpp"
 #include "error.hpp"
-#include "http_utils.hpp"
+#include "header_map.hpp"
+#include "known_headers.hpp"
 #include "task.hpp"
 #include "types.hpp"
 
 #include <functional>
+#include <memory_resource>
 #include <optional>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -26,31 +28,47 @@ struct HttpVersion {
     int minor;
 };
 
+class Http2Connection;
+
 class Request {
-    using HeaderMap = std::unordered_map<std::string, std::vector<std::string>>;
+    friend Http2Connection;
 
-    std::string method_;
-    std::string target_;
+    std::pmr::string method_;
+    std::pmr::string target_;
     HttpVersion http_version_{};
     HeaderMap headers_;
     u64 content_length_{};
     ConnectionReader *body_{};
     bool keep_alive_{};
-
-    void add_header(std::string_view name, std::string_view value);
+    bool expects_continue_{};
+    ContentEncoding accepted_encoding_{};
 
     Task<std::optional<Error>> read_request_line(ConnectionReader &reader);
 
-    bool parse_header_line(std::string_view line);
-
     Task<std::optional<Error>> read_headers(ConnectionReader &reader);
 
-    bool parse_content_length();
-
 public:
     Request() = default;
 
-    static Task<std::variant<Request, Error>> receive(ConnectionReader &reader);
+    // Allocates the request line and the headers from `resource`, which must
+    // outlive the request.
+    explicit Request(std::pmr::memory_resource *resource) :
+        method_{resource},
+        target_{resource},
+        headers_{resource} {
+    }
+
+    static Task<std::variant<Request, Error>> receive(
+        ConnectionReader &reader,
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource()
+    );
+
+    // Where the request is allocated. Handlers may allocate from it what they
+    // need until they return, such as a buffer for the body, as the server
+    // gives each connection an arena that it releases between requests.
+    [[nodiscard]] std::pmr::memory_resource *memory_resource() const {
+        return headers_.resource();
+    }
 
     [[nodiscard]] std::string_view method() const { return method_; }
 
@@ -66,19 +84,43 @@ public:
 
     bool keep_alive() const { return keep_alive_; }
 
+    // Whether the client waits for `100 Continue` before sending its body.
+    // The server sends it when the handler first reads the body, so a
+    // handler can reject the request without receiving the body at all.
+    bool expects_continue() const { return expects_continue_; }
+
+    ContentEncoding accepted_encoding() const { return accepted_encoding_; }
+
     bool contains_header(std::string_view name) const {
-        return headers_.contains(http_utils::make_header_name(name));
+        return headers_.contains(name);
+    }
+
+    bool contains_header(Header header) const {
+        return headers_.contains(header);
     }
 
-    std::optional<std::reference_wrapper<const std::vector<std::string>>>
+    std::optional<std::reference_wrapper<const HeaderMap::Values>>
     get_header(std::string_view name) const {
-        auto it = headers_.find(http_utils::make_header_name(name));
+        if (const HeaderMap::Values *values = headers_.find(name)) {
+            return *values;
+        }
 
-        if (it == headers_.cend()) {
-            return {};
+        return {};
+    }
+
+    std::optional<std::reference_wrapper<const HeaderMap::Values>>
+    get_header(Header header) const {
+        if (const HeaderMap::Values *values = headers_.find(header)) {
+            return *values;
         }
 
-        return it->second;
+        return {};
+    }
+
+    // Whether a header holding a list of tokens, such as Connection, contains
+    // `token`, ignoring case.
+    bool header_contains_token(Header header, std::string_view token) const {
+        return headers_.contains_token(header, token);
     }
 };
 
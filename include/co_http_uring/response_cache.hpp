@@ -0,0 +1,110 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_RESPONSE_CACHE_HPP
+#define CO_HTTP_URING_RESPONSE_CACHE_HPP
+
+#include "types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace co_http_uring {
+
+class Request;
+
+// Cache of fully serialized responses, keyed by the request's method, target,
+// HTTP version and selected header values. Every server thread gets its own
+// memory-bounded LRU shard; only invalidation touches other threads' shards.
+class ResponseCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        u64 hits;
+        u64 misses;
+        u64 insertions;
+        u64 evictions;
+        u64 expirations;
+        u64 invalidations;
+    };
+
+    class Shard {
+        friend ResponseCache;
+
+        struct Entry;
+
+        using EntryMap = std::map<std::string, Entry, std::less<>>;
+
+        struct Entry {
+            std::shared_ptr<const std::string> response;
+            Clock::time_point expiry;
+            std::list<EntryMap::iterator>::iterator lru_it;
+        };
+
+        std::mutex mutex_;
+        std::size_t capacity_;
+        std::size_t size_{};
+        EntryMap entries_;
+        std::list<EntryMap::iterator> lru_;
+        Stats stats_{};
+
+        void erase(EntryMap::iterator it);
+
+    public:
+        explicit Shard(std::size_t capacity) : capacity_{capacity} {}
+
+        std::shared_ptr<const std::string> find(std::string_view key);
+
+        void insert(
+            std::string_view key,
+            std::string_view response,
+            Clock::duration ttl
+        );
+    };
+
+private:
+    std::size_t shard_capacity_;
+    std::vector<std::string> key_headers_;
+    std::mutex shards_mutex_;
+    std::list<Shard> shards_;
+
+public:
+    ResponseCache(
+        std::size_t shard_capacity,
+        std::vector<std::string> key_headers = {}
+    );
+
+    Shard &add_shard();
+
+    // Drops a shard added by a server that is destroyed, with its entries.
+    void remove_shard(Shard &shard);
+
+    [[nodiscard]] bool is_cacheable(const Request &req) const;
+
+    // "METHOD target HTTP/1.x encoding", where encoding is the one that the
+    // response is compressed with, then "\r\nname: value..." for each key
+    // header, e.g. "GET /users/1 HTTP/1.1 gzip".
+    [[nodiscard]] std::string make_key(const Request &req) const;
+
+    // Drops the entries whose keys start with `prefix`, and returns how many
+    // there were.
+    std::size_t invalidate_prefix(std::string_view prefix);
+
+    // Drops the GET and HEAD responses to targets starting with `prefix`,
+    // such as "/users/", and returns how many there were.
+    std::size_t invalidate_target_prefix(std::string_view prefix);
+
+    Stats stats();
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_RESPONSE_CACHE_HPP
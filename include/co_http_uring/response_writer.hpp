@@ -4,16 +4,26 @@
 #ifndef CO_HTTP_URING_RESPONSE_WRITER_HPP
 #define CO_HTTP_URING_RESPONSE_WRITER_HPP
 
+#include "compression.hpp"
 #include "connection_writer.hpp"
 #include "error.hpp"
+#include "response_cache.hpp"
 #include "status_code.hpp"
 #include "task.hpp"
+#include "types.hpp"
+#include "websocket.hpp"
 
+#include <cstddef>
 #include <optional>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <variant>
 
 namespace co_http_uring {
 
+class Http2Stream;
+
 class ResponseWriter {
     enum class State {
         STATUS_LINE,
@@ -21,12 +31,61 @@ class ResponseWriter {
     };
 
     ConnectionWriter *writer_;
+    Http2Stream *stream_{};
     int http_minor_version_;
     State state_;
+    // Whether a whole body has been written, as opposed to after end_headers().
+    bool body_written_{};
+    ContentEncoding content_encoding_{};
+    std::optional<CompressionOptions> compression_options_;
+    ResponseCache::Shard *cache_shard_{};
+    std::string cache_key_;
+    std::optional<ResponseCache::Clock::duration> cache_ttl_;
+    std::size_t cache_begin_{};
+    u64 cache_flush_count_{};
+
+    void insert_into_cache();
+
+    Task<std::optional<Error>> end_header_section();
+
+    Task<std::optional<Error>>
+    write_content_encoding_headers(ContentEncoding encoding);
+
+    // Chunked over HTTP/1.1, and in DATA frames as they fill over HTTP/2.
+    Task<std::optional<Error>>
+    write_streamed_compressed_body(std::string_view body);
 
 public:
     ResponseWriter(ConnectionWriter &writer, int http_minor_version);
 
+    // Writes the response of an HTTP/2 stream, whose header section is sent
+    // as a HEADERS frame and whose body goes through connection_writer() as
+    // DATA frames.
+    explicit ResponseWriter(Http2Stream &stream);
+
+    [[nodiscard]] ContentEncoding content_encoding() const {
+        return content_encoding_;
+    }
+
+    void set_compression(
+        ContentEncoding encoding,
+        const CompressionOptions &options = {}
+    ) {
+        content_encoding_ = encoding;
+        compression_options_ = options;
+    }
+
+    void disable_compression() {
+        content_encoding_ = ContentEncoding::IDENTITY;
+    }
+
+    void set_cache(ResponseCache::Shard &shard, std::string key) {
+        cache_shard_ = &shard;
+        cache_key_ = std::move(key);
+    }
+
+    void cache_for(ResponseCache::Clock::duration ttl) { cache_ttl_ = ttl; }
+
     Task<std::optional<Error>> write_status(StatusCode code);
 
     Task<std::optional<Error>>
@@ -34,6 +93,25 @@ public:
 
     Task<std::optional<Error>> write_body(std::string_view body);
 
+    Task<std::optional<Error>>
+    write_encoded_body(std::string_view body, ContentEncoding encoding);
+
+    // Ends the header section of a response without a body, or of one whose
+    // body the caller writes through connection_writer() itself.
+    Task<std::optional<Error>> end_headers();
+
+    ConnectionWriter &connection_writer() { return *writer_; }
+
+    // Completes the opening handshake of a WebSocket, which then has the
+    // connection to itself until the handler returns and the server closes
+    // it. Fails with INVALID_REQUEST unless WebSocket::is_upgrade_request().
+    Task<std::variant<WebSocket, Error>> accept_websocket(
+        const Request &request,
+        std::size_t max_message_size = WebSocket::DEFAULT_MAX_MESSAGE_SIZE
+    );
+
+    void close_connection() { writer_->request_close(); }
+
     Task<std::optional<Error>> send();
 };
 
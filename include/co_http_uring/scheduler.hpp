@@ -0,0 +1,32 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_SCHEDULER_HPP
+#define CO_HTTP_URING_SCHEDULER_HPP
+
+#include "server.hpp"
+
+#include <coroutine>
+
+namespace co_http_uring {
+
+class YieldAwaitable {
+public:
+    [[nodiscard]] bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> coroutine) const {
+        Server::thread_instance()->schedule(coroutine);
+    }
+
+    void await_resume() const {}
+};
+
+// Suspends the current coroutine and requeues it behind the coroutines that
+// are already ready and the completions that are already pending.
+inline YieldAwaitable yield() {
+    return {};
+}
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_SCHEDULER_HPP
@@ -4,22 +4,37 @@
 #ifndef CO_HTTP_URING_SERVER_HPP
 #define CO_HTTP_URING_SERVER_HPP
 
+#include "admission_controller.hpp"
+#include "buffer_ring.hpp"
+#include "compression.hpp"
+#include "connection_balancer.hpp"
 #include "eventfd.hpp"
 #include "io_uring.hpp"
+#include "listen_socket.hpp"
+#include "response_cache.hpp"
 #include "socket_address.hpp"
+#include "socket_options.hpp"
 #include "task.hpp"
-#include "tcp_socket.hpp"
 #include "types.hpp"
+#include "wait_policy.hpp"
 
 #include <chrono>
 #include <coroutine>
+#include <cstddef>
+#include <deque>
 #include <functional>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 namespace co_http_uring {
 
 class Connection;
+class ConnectionWriter;
 class Request;
 class ResponseWriter;
 
@@ -27,32 +42,113 @@ class Server {
     using RequestHandler =
         std::function<Task<>(const Request &, ResponseWriter)>;
 
+    // Coroutines made ready by other threads, handed over through the wake
+    // eventfd.
+    struct RemoteReadyQueue {
+        std::mutex mutex;
+        std::vector<std::coroutine_handle<>> coroutines;
+    };
+
+    struct Listener {
+        ListenSocket socket;
+        int max_pending_conns;
+        std::vector<SocketOption> connection_options;
+        // Whether a multishot accept is armed, or may still be.
+        bool accepting{};
+    };
+
     static thread_local Server *thread_instance_;
 
+    static constexpr i64 FIRST_OPERATION_KEY = -(i64{1} << 16);
+
     std::chrono::seconds read_timeout_;
+    std::chrono::seconds write_timeout_;
+    std::optional<std::chrono::seconds> response_write_timeout_;
+    u64 min_send_rate_{};
     u64 max_request_pre_body_size_;
-    TcpSocket socket_;
+    unsigned int run_budget_;
+    WaitPolicy wait_policy_;
+    std::vector<Listener> listeners_;
     RequestHandler handler_;
+    std::optional<CompressionOptions> compression_;
+    bool h2c_{};
+    std::shared_ptr<ResponseCache> response_cache_;
+    ResponseCache::Shard *response_cache_shard_{};
+    std::shared_ptr<ConnectionBalancer> connection_balancer_;
+    ConnectionBalancer::Member *balancer_member_{};
+    std::unique_ptr<AdmissionController> admission_controller_;
+    bool accept_paused_{};
+    std::chrono::steady_clock::time_point busy_since_;
     IoUring ring_;
     Eventfd stop_eventfd_;
+    Eventfd wake_eventfd_;
+    u64 wake_eventfd_value_{};
+    std::unique_ptr<RemoteReadyQueue> remote_ready_;
     std::vector<int> files_;
+    std::unique_ptr<BufferRing> buffer_ring_;
     std::map<int, Task<>> tasks_;
-    std::map<int, std::coroutine_handle<>> coroutines_;
+    std::map<i64, std::coroutine_handle<>> coroutines_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::vector<int> closed_conns_;
+    i64 next_operation_key_ = FIRST_OPERATION_KEY;
+    bool ring_socket_options_ = true;
+    std::chrono::steady_clock::time_point last_wakeup_;
+    std::chrono::nanoseconds average_wakeup_gap_ = std::chrono::seconds{1};
+
+    void submit_accept(std::size_t listener);
+
+    void update_accepting();
 
-    void submit_accept();
+    void submit_wake_read();
+
+    void submit_connection_options(std::size_t listener, int fixed_fd);
+
+    Task<bool> serve_cached(std::string_view key, ConnectionWriter &writer);
 
     Task<> serve_connection(Connection conn);
 
+    void start_connection(int fixed_fd);
+
+    Task<> hand_off_connection(
+        int fixed_fd,
+        ConnectionBalancer::Member &target
+    );
+
     void handle_stop_cqe(const IoUringCqe &&cqe);
 
-    void handle_accept_cqe(const IoUringCqe &&cqe);
+    void handle_accept_cqe(std::size_t listener, const IoUringCqe &&cqe);
+
+    void handle_wake_cqe(const IoUringCqe &&cqe);
+
+    void handle_handoff_cqe(const IoUringCqe &&cqe);
+
+    // Closes the connections that siblings hand to this server after it left
+    // their ConnectionBalancer, until none are under way.
+    void drain_handoffs();
+
+    void handle_socket_option_cqe(const IoUringCqe &&cqe);
+
+    void handle_cancel_cqe(const IoUringCqe &&cqe);
 
     void handle_coroutine_cqe(const IoUringCqe &&cqe);
 
+    void reap_closed_conns();
+
+    void handle_cqe(IoUringCqe &&cqe);
+
+    std::optional<IoUringCqe> spin_for_cqe(std::chrono::nanoseconds duration);
+
+    IoUringCqe wait_for_cqe();
+
+    // Returns how many CQEs were handled.
+    unsigned int handle_cqes();
+
+    void run_ready();
+
 public:
     explicit Server(RequestHandler handler, unsigned int sq_entries);
 
-    ~Server() = default;
+    ~Server();
 
     Server(const Server &) = delete;
     Server &operator=(const Server &) = delete;
@@ -70,6 +166,36 @@ public:
         read_timeout_ = read_timeout;
     }
 
+    // How long a single send may wait for the peer to take data.
+    [[nodiscard]] std::chrono::seconds write_timeout() const {
+        return write_timeout_;
+    }
+
+    void set_write_timeout(std::chrono::seconds write_timeout) {
+        write_timeout_ = write_timeout;
+    }
+
+    // How long an HTTP/1.1 response may take to send from its first byte, if
+    // bounded. Over HTTP/2 and WebSocket, only the other limits apply.
+    [[nodiscard]] std::optional<std::chrono::seconds>
+    response_write_timeout() const {
+        return response_write_timeout_;
+    }
+
+    void set_response_write_timeout(
+        std::optional<std::chrono::seconds> response_write_timeout
+    ) {
+        response_write_timeout_ = response_write_timeout;
+    }
+
+    // The rate in bytes per second below which the peer is considered too
+    // slow a reader once a grace period of one second has passed, or 0.
+    [[nodiscard]] u64 min_send_rate() const { return min_send_rate_; }
+
+    void set_min_send_rate(u64 min_send_rate) {
+        min_send_rate_ = min_send_rate;
+    }
+
     [[nodiscard]] u64 max_request_pre_body_size() const {
         return max_request_pre_body_size_;
     }
@@ -78,11 +204,110 @@ public:
         max_request_pre_body_size_ = max_request_pre_body_size;
     }
 
+    [[nodiscard]] const std::optional<CompressionOptions> &compression() const {
+        return compression_;
+    }
+
+    void set_compression(std::optional<CompressionOptions> compression) {
+        compression_ = compression;
+    }
+
+    // Whether connections may switch to HTTP/2 over cleartext, either with
+    // the connection preface (prior knowledge) or with an Upgrade request.
+    [[nodiscard]] bool h2c() const { return h2c_; }
+
+    void set_h2c(bool h2c) { h2c_ = h2c; }
+
+    [[nodiscard]] const std::shared_ptr<ResponseCache> &
+    response_cache() const {
+        return response_cache_;
+    }
+
+    void set_response_cache(std::shared_ptr<ResponseCache> response_cache) {
+        response_cache_ = std::move(response_cache);
+    }
+
+    // Maximum number of CQEs, and of ready coroutines, that one iteration of
+    // the event loop handles before switching to the other.
+    [[nodiscard]] unsigned int run_budget() const { return run_budget_; }
+
+    void set_run_budget(unsigned int run_budget) { run_budget_ = run_budget; }
+
+    [[nodiscard]] const WaitPolicy &wait_policy() const { return wait_policy_; }
+
+    void set_wait_policy(const WaitPolicy &wait_policy) {
+        wait_policy_ = wait_policy;
+    }
+
+    [[nodiscard]] const std::shared_ptr<ConnectionBalancer> &
+    connection_balancer() const {
+        return connection_balancer_;
+    }
+
+    void set_connection_balancer(
+        std::shared_ptr<ConnectionBalancer> connection_balancer
+    ) {
+        connection_balancer_ = std::move(connection_balancer);
+    }
+
+    // Null unless an admission policy is set.
+    [[nodiscard]] const AdmissionController *admission_controller() const {
+        return admission_controller_.get();
+    }
+
+    void set_admission_policy(std::optional<AdmissionPolicy> policy) {
+        admission_controller_ =
+            policy ? std::make_unique<AdmissionController>(*policy) : nullptr;
+    }
+
     IoUring &ring() { return ring_; }
 
-    std::map<int, std::coroutine_handle<>> &coroutines() { return coroutines_; }
+    // Null until the server runs.
+    BufferRing *buffer_ring() { return buffer_ring_.get(); }
+
+    std::map<i64, std::coroutine_handle<>> &coroutines() { return coroutines_; }
+
+    // Keys for operations that are not bound to a connection's fixed fd, such
+    // as file I/O. They are negative and never collide with internal SQE tags.
+    i64 allocate_operation_key() {
+        if (next_operation_key_ == std::numeric_limits<i64>::min()) {
+            next_operation_key_ = FIRST_OPERATION_KEY;
+        }
+
+        return next_operation_key_--;
+    }
+
+    // Cancels the operation that a coroutine waits on under `key`, which then
+    // completes with -ECANCELED unless it is already completing.
+    void cancel_operation(i64 key);
+
+    // Links a timeout to the SQE last prepared, which must have
+    // IOSQE_IO_LINK, and submits both. That operation then completes with
+    // -ECANCELED if it takes longer than `timeout`.
+    void submit_linked_timeout(std::chrono::nanoseconds timeout);
+
+    void schedule(std::coroutine_handle<> coroutine) {
+        ready_.push_back(coroutine);
+    }
+
+    // Thread-safe counterpart of schedule().
+    void schedule_remote(std::coroutine_handle<> coroutine);
+
+    // Binds and listens on `address` right away. Connections accepted by
+    // every listener are served alike once the server runs.
+    void listen(
+        const SocketAddress &address,
+        int max_pending_conns,
+        const SocketOptions &options = {}
+    );
 
-    void run(const Ipv4Address &address, int max_pending_conns);
+    // Serves the listeners' connections until stop() is called.
+    void run();
+
+    void run(const SocketAddress &address, int max_pending_conns) {
+        listen(address, max_pending_conns);
+        run();
+    }
 
     void stop();
 };
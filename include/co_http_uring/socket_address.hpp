@@ -6,8 +6,15 @@
 
 #include "types.hpp"
 
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
 extern "C" {
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 };
 
 namespace co_http_uring {
@@ -41,6 +48,129 @@ public:
     }
 };
 
+// A dual-stack address also accepts IPv4 connections, as IPv4-mapped IPv6
+// addresses, when listened on. Otherwise the socket is IPv6-only, whatever
+// the system default.
+class Ipv6Address {
+    sockaddr_in6 sockaddr_{};
+    bool dual_stack_;
+
+public:
+    Ipv6Address(const in6_addr &addr, u16 port, bool dual_stack = false) :
+        dual_stack_{dual_stack} {
+        sockaddr_.sin6_family = AF_INET6;
+        sockaddr_.sin6_port = ::htons(port);
+        sockaddr_.sin6_addr = addr;
+    }
+
+    [[nodiscard]] const struct sockaddr *sockaddr() const {
+        return reinterpret_cast<const struct sockaddr *>(&sockaddr_);
+    }
+
+    [[nodiscard]] socklen_t sockaddr_size() const { return sizeof(sockaddr_); }
+
+    [[nodiscard]] u16 port() const { return ::ntohs(sockaddr_.sin6_port); }
+
+    [[nodiscard]] const in6_addr &addr() const { return sockaddr_.sin6_addr; }
+
+    [[nodiscard]] bool dual_stack() const { return dual_stack_; }
+};
+
+// The address of a Unix domain socket, either a filesystem path or a name in
+// Linux's abstract namespace, which needs no file and vanishes with the
+// socket.
+class UnixAddress {
+    sockaddr_un sockaddr_{};
+    socklen_t size_;
+
+    UnixAddress(std::string_view name, std::size_t offset) {
+        if (offset + name.size() >= sizeof(sockaddr_.sun_path)) {
+            throw std::length_error("Unix socket address is too long");
+        }
+
+        sockaddr_.sun_family = AF_UNIX;
+        std::memcpy(sockaddr_.sun_path + offset, name.data(), name.size());
+        size_ = offsetof(sockaddr_un, sun_path) + offset + name.size();
+    }
+
+public:
+    explicit UnixAddress(std::string_view path) : UnixAddress{path, 0} {}
+
+    static UnixAddress abstract(std::string_view name) { return {name, 1}; }
+
+    [[nodiscard]] const struct sockaddr *sockaddr() const {
+        return reinterpret_cast<const struct sockaddr *>(&sockaddr_);
+    }
+
+    [[nodiscard]] socklen_t sockaddr_size() const { return size_; }
+
+    [[nodiscard]] bool is_abstract() const {
+        return size_ > offsetof(sockaddr_un, sun_path) &&
+               sockaddr_.sun_path[0] == '\0';
+    }
+
+    // Empty for abstract addresses.
+    [[nodiscard]] std::string_view path() const {
+        if (is_abstract()) {
+            return {};
+        }
+
+        return {sockaddr_.sun_path, size_ - offsetof(sockaddr_un, sun_path)};
+    }
+};
+
+// Any of the above, for APIs that accept every address family.
+class SocketAddress {
+    sockaddr_storage storage_{};
+    socklen_t size_;
+    bool dual_stack_{};
+
+    void assign(const struct sockaddr *sockaddr, socklen_t size) {
+        std::memcpy(&storage_, sockaddr, size);
+        size_ = size;
+    }
+
+public:
+    SocketAddress(const Ipv4Address &address) {
+        assign(address.sockaddr(), address.sockaddr_size());
+    }
+
+    SocketAddress(const Ipv6Address &address) :
+        dual_stack_{address.dual_stack()} {
+        assign(address.sockaddr(), address.sockaddr_size());
+    }
+
+    SocketAddress(const UnixAddress &address) {
+        assign(address.sockaddr(), address.sockaddr_size());
+    }
+
+    [[nodiscard]] int family() const { return storage_.ss_family; }
+
+    [[nodiscard]] const struct sockaddr *sockaddr() const {
+        return reinterpret_cast<const struct sockaddr *>(&storage_);
+    }
+
+    [[nodiscard]] socklen_t sockaddr_size() const { return size_; }
+
+    [[nodiscard]] bool dual_stack() const { return dual_stack_; }
+
+    // The filesystem path of a Unix address, empty for other addresses.
+    [[nodiscard]] std::string_view unix_path() const {
+        if (family() != AF_UNIX) {
+            return {};
+        }
+
+        const auto &sockaddr = reinterpret_cast<const sockaddr_un &>(storage_);
+        std::size_t size = size_ - offsetof(sockaddr_un, sun_path);
+
+        if (size == 0 || sockaddr.sun_path[0] == '\0') {
+            return {};
+        }
+
+        return {sockaddr.sun_path, size};
+    }
+};
+
 } // namespace co_http_uring
 
 #endif // CO_HTTP_URING_SOCKET_ADDRESS_HPP
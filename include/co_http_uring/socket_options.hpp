@@ -0,0 +1,67 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_SOCKET_OPTIONS_HPP
+#define CO_HTTP_URING_SOCKET_OPTIONS_HPP
+
+#include <optional>
+#include <vector>
+
+namespace co_http_uring {
+
+// Options for a listener and the connections it accepts. Unset options keep
+// the kernel's defaults, and TCP options are ignored for Unix sockets.
+struct SocketOptions {
+    // Set on the listening socket.
+
+    // TCP_DEFER_ACCEPT: seconds for which connections are only accepted once
+    // the client has sent data.
+    std::optional<int> defer_accept;
+
+    // TCP_FASTOPEN: maximum number of pending TCP Fast Open requests.
+    std::optional<int> fastopen_queue_length;
+
+    // SO_INCOMING_CPU: makes SO_REUSEPORT prefer this listener for
+    // connections whose packets are processed on the given CPU.
+    std::optional<int> incoming_cpu;
+
+    // SO_RCVBUF and SO_SNDBUF, which accepted sockets inherit. Only a receive
+    // buffer set before the handshake affects the TCP window scale.
+    std::optional<int> receive_buffer_size;
+    std::optional<int> send_buffer_size;
+
+    // Set on each accepted socket through the ring (Linux >= 6.7), or on the
+    // listening socket for accepted sockets to inherit on older kernels.
+
+    // TCP_NODELAY: disables Nagle's algorithm.
+    std::optional<bool> no_delay;
+
+    // TCP_NOTSENT_LOWAT: bytes of unsent data above which the socket stops
+    // being writable.
+    std::optional<int> not_sent_low_watermark;
+
+    // SO_BUSY_POLL: microseconds to busy poll the device queue for when
+    // receiving with nothing queued.
+    std::optional<int> busy_poll;
+
+    // SO_PREFER_BUSY_POLL: defers softirq processing to busy polling.
+    std::optional<bool> prefer_busy_poll;
+};
+
+struct SocketOption {
+    int level;
+    int name;
+    int value;
+};
+
+// The options of `options` that are set on a listening socket of `family`.
+std::vector<SocketOption>
+listener_socket_options(const SocketOptions &options, int family);
+
+// The options of `options` that are set on accepted sockets of `family`.
+std::vector<SocketOption>
+connection_socket_options(const SocketOptions &options, int family);
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_SOCKET_OPTIONS_HPP
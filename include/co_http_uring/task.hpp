@@ -4,14 +4,83 @@
 #ifndef CO_HTTP_URING_TASK_HPP
 #define CO_HTTP_URING_TASK_HPP
 
+#include "types.hpp"
+
 #include <fmt/core.h>
 
 #include <coroutine>
 #include <cstdio>
+#include <exception>
+#include <type_traits>
 #include <utility>
 
 namespace co_http_uring {
 
+class TaskGroup;
+
+// What a task is waiting on, so that it can be cancelled: the task it awaits,
+// the group of tasks it joins (see when.hpp), or a ring operation.
+class TaskPromiseBase {
+    TaskPromiseBase *parent_{};
+    TaskPromiseBase *child_{};
+    TaskGroup *group_{};
+    i64 operation_key_{};
+    std::coroutine_handle<> operation_coroutine_;
+    bool cancel_requested_ = false;
+    std::exception_ptr exception_;
+
+    void cancel_operation();
+
+public:
+    // Kept for the coroutine that awaits the task, which rethrows it.
+    void unhandled_exception() { exception_ = std::current_exception(); }
+
+    void rethrow_exception() {
+        if (exception_) {
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+        }
+    }
+
+    // Called before the frame of a finished task is destroyed.
+    void report_exception() const {
+        if (exception_) {
+            fmt::print(stderr, "unhandled exception in Task\n");
+        }
+    }
+
+    void await_child(TaskPromiseBase &child);
+
+    // Called by a task that finishes or is detached.
+    void leave_parent();
+
+    void join_group(TaskGroup &group);
+
+    void leave_group() { group_ = nullptr; }
+
+    void await_operation(i64 key, std::coroutine_handle<> coroutine);
+
+    // Cancels the ring operation that the task, or the innermost task it
+    // awaits, is waiting on, and every operation it submits afterwards. These
+    // complete with -ECANCELED, which reads report as timeouts, so the task
+    // fails fast instead of running to completion.
+    void cancel();
+};
+
+// Records what a coroutine awaits in its promise, if it is a task's.
+template <typename Promise>
+void await_child(std::coroutine_handle<Promise> coroutine, auto &child) {
+    if constexpr (std::is_base_of_v<TaskPromiseBase, Promise>) {
+        coroutine.promise().await_child(child);
+    }
+}
+
+template <typename Promise>
+void await_operation(std::coroutine_handle<Promise> coroutine, i64 key) {
+    if constexpr (std::is_base_of_v<TaskPromiseBase, Promise>) {
+        coroutine.promise().await_operation(key, coroutine);
+    }
+}
+
 template <typename T = void>
 class Task {
 public:
@@ -27,6 +96,14 @@ private:
 
         std::coroutine_handle<> await_suspend(Coroutine coroutine
         ) const noexcept {
+            coroutine.promise().leave_parent();
+
+            if (coroutine.promise().detached_) {
+                coroutine.promise().report_exception();
+                coroutine.destroy();
+                return std::noop_coroutine();
+            }
+
             if (!coroutine.promise().parent_coroutine_) {
                 return std::noop_coroutine();
             }
@@ -38,11 +115,12 @@ private:
     };
 
 public:
-    class promise_type {
+    class promise_type : public TaskPromiseBase {
         friend Task;
         friend ParentTaskAwaitable;
 
         std::coroutine_handle<> parent_coroutine_;
+        bool detached_ = false;
         T return_value_;
 
     public:
@@ -54,11 +132,7 @@ public:
 
         ParentTaskAwaitable final_suspend() noexcept { return {}; }
 
-        void return_value(T &&value) { return_value_ = value; }
-
-        void unhandled_exception() {
-            fmt::print(stderr, "unhandled exception in Task\n");
-        }
+        void return_value(T &&value) { return_value_ = std::move(value); }
     };
 
     explicit Task(Coroutine coroutine) : coroutine_{coroutine} {}
@@ -66,22 +140,67 @@ public:
     Task(const Task &) = delete;
     Task &operator=(const Task &) = delete;
 
-    Task(Task &&) noexcept = default;
-    Task &operator=(Task &&) noexcept = default;
+    Task(Task &&other) noexcept :
+        coroutine_{std::exchange(other.coroutine_, nullptr)} {
+    }
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (coroutine_ && coroutine_.done()) {
+                coroutine_.promise().report_exception();
+                coroutine_.destroy();
+            }
+
+            coroutine_ = std::exchange(other.coroutine_, nullptr);
+        }
+
+        return *this;
+    }
 
     ~Task() {
+        if (coroutine_ && coroutine_.done()) {
+            coroutine_.promise().report_exception();
+            coroutine_.destroy();
+        }
+    }
+
+    // Gives up ownership of the coroutine, which keeps running on its own and
+    // destroys its frame when it finishes. Its result is discarded.
+    void detach() {
+        if (!coroutine_) {
+            return;
+        }
+
         if (coroutine_.done()) {
+            coroutine_.promise().report_exception();
             coroutine_.destroy();
+        } else {
+            coroutine_.promise().parent_coroutine_ = nullptr;
+            coroutine_.promise().detached_ = true;
+            coroutine_.promise().leave_parent();
         }
+
+        coroutine_ = nullptr;
     }
 
     [[nodiscard]] bool await_ready() const { return coroutine_.done(); }
 
-    void await_suspend(std::coroutine_handle<> coroutine) const {
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> coroutine) const {
         coroutine_.promise().parent_coroutine_ = coroutine;
+        co_http_uring::await_child(coroutine, coroutine_.promise());
+    }
+
+    // Cancels the operations that the task is waiting on (see
+    // TaskPromiseBase::cancel()).
+    void cancel() const {
+        if (!coroutine_.done()) {
+            coroutine_.promise().cancel();
+        }
     }
 
     T await_resume() const {
+        coroutine_.promise().rethrow_exception();
         return std::move(coroutine_.promise().return_value_);
     }
 };
@@ -101,6 +220,14 @@ private:
 
         [[nodiscard]] std::coroutine_handle<> await_suspend(Coroutine coroutine
         ) const noexcept {
+            coroutine.promise().leave_parent();
+
+            if (coroutine.promise().detached_) {
+                coroutine.promise().report_exception();
+                coroutine.destroy();
+                return std::noop_coroutine();
+            }
+
             if (!coroutine.promise().parent_coroutine_) {
                 return std::noop_coroutine();
             }
@@ -112,11 +239,12 @@ private:
     };
 
 public:
-    class promise_type {
+    class promise_type : public TaskPromiseBase {
         friend Task;
         friend ParentTaskAwaitable;
 
         std::coroutine_handle<> parent_coroutine_;
+        bool detached_ = false;
 
     public:
         Task get_return_object() {
@@ -128,10 +256,6 @@ public:
         ParentTaskAwaitable final_suspend() noexcept { return {}; }
 
         void return_void() {}
-
-        void unhandled_exception() {
-            fmt::print(stderr, "unhandled exception in Task\n");
-        }
     };
 
     explicit Task(Coroutine coroutine) : coroutine_{coroutine} {}
@@ -139,22 +263,66 @@ public:
     Task(const Task &) = delete;
     Task &operator=(const Task &) = delete;
 
-    Task(Task &&) noexcept = default;
-    Task &operator=(Task &&) noexcept = default;
+    Task(Task &&other) noexcept :
+        coroutine_{std::exchange(other.coroutine_, nullptr)} {
+    }
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (coroutine_ && coroutine_.done()) {
+                coroutine_.promise().report_exception();
+                coroutine_.destroy();
+            }
+
+            coroutine_ = std::exchange(other.coroutine_, nullptr);
+        }
+
+        return *this;
+    }
 
     ~Task() {
+        if (coroutine_ && coroutine_.done()) {
+            coroutine_.promise().report_exception();
+            coroutine_.destroy();
+        }
+    }
+
+    // Gives up ownership of the coroutine, which keeps running on its own and
+    // destroys its frame when it finishes. Its result is discarded.
+    void detach() {
+        if (!coroutine_) {
+            return;
+        }
+
         if (coroutine_.done()) {
+            coroutine_.promise().report_exception();
             coroutine_.destroy();
+        } else {
+            coroutine_.promise().parent_coroutine_ = nullptr;
+            coroutine_.promise().detached_ = true;
+            coroutine_.promise().leave_parent();
         }
+
+        coroutine_ = nullptr;
     }
 
     [[nodiscard]] bool await_ready() const { return coroutine_.done(); }
 
-    void await_suspend(std::coroutine_handle<> coroutine) const {
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> coroutine) const {
         coroutine_.promise().parent_coroutine_ = coroutine;
+        co_http_uring::await_child(coroutine, coroutine_.promise());
+    }
+
+    // Cancels the operations that the task is waiting on (see
+    // TaskPromiseBase::cancel()).
+    void cancel() const {
+        if (!coroutine_.done()) {
+            coroutine_.promise().cancel();
+        }
     }
 
-    void await_resume() const {}
+    void await_resume() const { coroutine_.promise().rethrow_exception(); }
 };
 
 } // namespace co_http_uring
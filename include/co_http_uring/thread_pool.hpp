@@ -0,0 +1,65 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_THREAD_POOL_HPP
+#define CO_HTTP_URING_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace co_http_uring {
+
+// A pool of worker threads with one job deque each. Workers take their own
+// newest jobs first and steal the oldest jobs of the others when idle.
+class ThreadPool {
+    using Job = std::function<void()>;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    static thread_local ThreadPool *current_pool_;
+    static thread_local std::size_t current_index_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<std::size_t> next_index_{0};
+    std::atomic<std::size_t> pending_jobs_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable_any wake_;
+    std::vector<std::jthread> threads_;
+
+    bool try_run(std::size_t index);
+
+    void work(std::stop_token stop_token, std::size_t index);
+
+public:
+    explicit ThreadPool(std::size_t thread_count);
+
+    ~ThreadPool() = default;
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ThreadPool(ThreadPool &&) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    // The process-wide pool used by offload(), with one thread per core.
+    static ThreadPool &shared();
+
+    [[nodiscard]] std::size_t thread_count() const { return threads_.size(); }
+
+    void submit(Job job);
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_THREAD_POOL_HPP
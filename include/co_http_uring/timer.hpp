@@ -0,0 +1,100 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_TIMER_HPP
+#define CO_HTTP_URING_TIMER_HPP
+
+#include "error.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <optional>
+#include <variant>
+
+extern "C" {
+#include <linux/time_types.h>
+}
+
+namespace co_http_uring {
+
+Task<> sleep_for(std::chrono::nanoseconds duration);
+
+// A one-shot ring timeout that a coroutine can race against a task.
+class Deadline {
+    __kernel_timespec ts_;
+    i64 key_{};
+    bool armed_ = false;
+
+    void arm(std::coroutine_handle<> coroutine);
+
+    // Called when the racing coroutine resumes. Returns whether the task won.
+    bool settle(bool task_done);
+
+    template <typename T>
+    class Race {
+        Deadline *deadline_;
+        Task<T> *task_;
+
+    public:
+        Race(Deadline *deadline, Task<T> *task) :
+            deadline_{deadline},
+            task_{task} {
+        }
+
+        [[nodiscard]] bool await_ready() const { return task_->await_ready(); }
+
+        template <typename Promise>
+        void await_suspend(std::coroutine_handle<Promise> coroutine) const {
+            task_->await_suspend(coroutine);
+            deadline_->arm(coroutine);
+        }
+
+        bool await_resume() const {
+            return deadline_->settle(task_->await_ready());
+        }
+    };
+
+public:
+    explicit Deadline(std::chrono::nanoseconds timeout);
+
+    ~Deadline() = default;
+
+    Deadline(const Deadline &) = delete;
+    Deadline &operator=(const Deadline &) = delete;
+
+    Deadline(Deadline &&) = delete;
+    Deadline &operator=(Deadline &&) = delete;
+
+    // Resumes with true if `task` finished first, false if the deadline did.
+    template <typename T>
+    Race<T> race(Task<T> &task) {
+        return {this, &task};
+    }
+};
+
+// Awaits `task` for at most `timeout`. A task that misses its deadline is
+// cancelled (see Task::cancel()) and awaited until it finishes, so that none
+// of its operations outlive the call. Its result is discarded.
+template <typename T>
+Task<std::variant<T, Error>>
+with_deadline(std::chrono::nanoseconds timeout, Task<T> task) {
+    Deadline deadline{timeout};
+
+    if (!co_await deadline.race(task)) {
+        task.cancel();
+        co_await task;
+        co_return Error::DEADLINE_EXCEEDED;
+    }
+
+    T result = co_await task;
+    co_return result;
+}
+
+Task<std::optional<Error>>
+with_deadline(std::chrono::nanoseconds timeout, Task<> task);
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_TIMER_HPP
@@ -0,0 +1,143 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_TRACE_HPP
+#define CO_HTTP_URING_TRACE_HPP
+
+#include "types.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// A trace of what each server thread did to its connections and when, kept in
+// a fixed-size ring per thread and dumped to a file for co_http_uring_trace to
+// decode. Built with the ENABLE_TRACING CMake option; otherwise, recording
+// compiles to nothing.
+namespace co_http_uring::trace {
+
+#ifdef CO_HTTP_URING_TRACING
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+enum class Event : u8 {
+    ACCEPT,
+    RECV_SUBMIT,
+    RECV_COMPLETE,
+    PARSE_DONE,
+    HANDLER_START,
+    HANDLER_END,
+    SEND_SUBMIT,
+    SEND_COMPLETE,
+    CLOSE,
+    READ_TIMEOUT,
+    WRITE_TIMEOUT,
+    REQUEST_SHED,
+};
+
+constexpr std::size_t EVENT_COUNT =
+    static_cast<std::size_t>(Event::REQUEST_SHED) + 1;
+
+const char *event_name(Event event);
+
+struct Record {
+    // Processor timestamp counter, or nanoseconds of CLOCK_MONOTONIC where
+    // there is none.
+    u64 timestamp;
+    i32 fixed_fd;
+    Event event;
+    u8 reserved[3];
+};
+
+static_assert(sizeof(Record) == 16);
+
+// Records of one thread, overwritten oldest first once full.
+struct Ring {
+    std::unique_ptr<Record[]> records;
+    std::size_t mask;
+    u32 thread;
+    std::atomic<u64> next{0};
+
+    Ring(std::size_t capacity, u32 thread);
+};
+
+// A dump is this header, then for every thread, a ThreadHeader followed by
+// its records from oldest to newest.
+struct FileHeader {
+    static constexpr u64 MAGIC = 0x31434152'54484f43; // "COHTRAC1"
+
+    u64 magic;
+    u32 thread_count;
+    u32 reserved;
+    // Pairs of timestamps and CLOCK_MONOTONIC nanoseconds taken when tracing
+    // started and when the dump was written, from which the decoder derives
+    // the timestamp frequency.
+    u64 start_timestamp;
+    u64 start_ns;
+    u64 dump_timestamp;
+    u64 dump_ns;
+};
+
+struct ThreadHeader {
+    u32 thread;
+    u32 reserved;
+    u64 record_count;
+};
+
+constexpr std::size_t DEFAULT_CAPACITY = std::size_t{1} << 16;
+constexpr std::size_t MAX_THREADS = 256;
+
+extern thread_local Ring *thread_ring;
+
+u64 read_monotonic_ns();
+
+inline u64 read_timestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return read_monotonic_ns();
+#endif
+}
+
+// Gives the calling thread a ring of `capacity` records, rounded up to a power
+// of two, unless it has one. Rings outlive their threads, so that dumps keep
+// the last moments of those that exited.
+void start_thread(std::size_t capacity = DEFAULT_CAPACITY);
+
+inline void record(Event event, int fixed_fd) {
+    if constexpr (ENABLED) {
+        Ring *ring = thread_ring;
+
+        if (ring == nullptr) {
+            return;
+        }
+
+        // Only the owning thread writes, so a dump taken meanwhile may only
+        // see the newest record half written.
+        u64 index = ring->next.load(std::memory_order_relaxed);
+        ring->records[index & ring->mask] = {
+            .timestamp = read_timestamp(),
+            .fixed_fd = fixed_fd,
+            .event = event,
+            .reserved = {},
+        };
+        ring->next.store(index + 1, std::memory_order_release);
+    }
+}
+
+// Writes the rings of every thread to `path`, and returns whether it could.
+// Async-signal-safe.
+bool dump(const char *path);
+
+// Dumps to `path` whenever the process receives `signal`. The path is copied.
+void dump_on_signal(int signal, const char *path);
+
+} // namespace co_http_uring::trace
+
+#endif // CO_HTTP_URING_TRACE_HPP
@@ -0,0 +1,36 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_WAIT_POLICY_HPP
+#define CO_HTTP_URING_WAIT_POLICY_HPP
+
+#include <chrono>
+
+namespace co_http_uring {
+
+// How a server waits for completions once it has nothing else to do.
+struct WaitPolicy {
+    enum class Mode {
+        // Blocks until a completion arrives.
+        BLOCK,
+        // Blocks until a completion arrives, then until `min_completions`
+        // have arrived or `max_wait` has elapsed, trading latency for fewer
+        // wakeups.
+        BATCH,
+        // Polls the completion queue for up to `spin_duration` before
+        // blocking, trading CPU time for latency.
+        SPIN,
+        // Spins like SPIN while completions have recently arrived less than
+        // `spin_duration` apart on average, and blocks otherwise.
+        ADAPTIVE,
+    };
+
+    Mode mode = Mode::BLOCK;
+    unsigned int min_completions = 1;
+    std::chrono::microseconds max_wait{};
+    std::chrono::microseconds spin_duration{};
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_WAIT_POLICY_HPP
@@ -0,0 +1,134 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_WEBSOCKET_HPP
+#define CO_HTTP_URING_WEBSOCKET_HPP
+
+#include "connection_reader.hpp"
+#include "connection_writer.hpp"
+#include "error.hpp"
+#include "pooled_buffer.hpp"
+#include "request.hpp"
+#include "task.hpp"
+#include "types.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace co_http_uring {
+
+enum class WebSocketOpcode : u8 {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xa,
+};
+
+struct WebSocketMessage {
+    WebSocketOpcode opcode;
+    // Points into the connection's buffer until the next receive().
+    std::string_view data;
+};
+
+// A WebSocket (RFC 6455) over an upgraded HTTP/1.1 connection, which reads
+// frames into the connection reader's buffer and unmasks them there. The
+// fragments of a message are joined in the same pass, so a message is handed
+// out without being copied. Pings are answered and pongs ignored as they
+// arrive. Sends may overlap a receive, and each other.
+class WebSocket {
+    struct SendLock;
+
+    ConnectionReader *reader_{};
+    ConnectionWriter *writer_{};
+    std::size_t max_message_size_{};
+    std::optional<std::chrono::seconds> idle_timeout_;
+    // What the last message took up in the reader's buffer.
+    std::size_t consumed_size_{};
+    bool sending_{};
+    std::deque<std::coroutine_handle<>> send_waiters_;
+    bool close_received_{};
+    bool close_sent_{};
+
+    SendLock lock_sender();
+
+    void unlock_sender();
+
+    Task<std::optional<Error>>
+    send_frame(WebSocketOpcode opcode, std::string_view payload);
+
+    // Sends a close frame unless one was sent already, and returns the error
+    // that ends receiving.
+    Task<Error> fail(u16 code);
+
+public:
+    static constexpr std::size_t DEFAULT_MAX_MESSAGE_SIZE =
+        PooledBuffer::MAX_SIZE;
+
+    // Close codes (RFC 6455, section 7.4.1).
+    static constexpr u16 NORMAL_CLOSURE = 1000;
+    static constexpr u16 GOING_AWAY = 1001;
+    static constexpr u16 PROTOCOL_ERROR = 1002;
+    static constexpr u16 INVALID_PAYLOAD = 1007;
+    static constexpr u16 MESSAGE_TOO_BIG = 1009;
+
+    WebSocket() = default;
+
+    // Takes over a connection whose handshake is complete. Messages larger
+    // than `max_message_size` close the connection.
+    WebSocket(
+        ConnectionReader &reader,
+        ConnectionWriter &writer,
+        std::size_t max_message_size = DEFAULT_MAX_MESSAGE_SIZE
+    );
+
+    WebSocket(const WebSocket &) = delete;
+    WebSocket &operator=(const WebSocket &) = delete;
+
+    // Senders waiting for their turn point at the WebSocket, so it cannot be
+    // moved while a send is in flight.
+    WebSocket(WebSocket &&other);
+    WebSocket &operator=(WebSocket &&other);
+
+    [[nodiscard]] std::optional<std::chrono::seconds> idle_timeout() const {
+        return idle_timeout_;
+    }
+
+    // How long receive() waits for the next message to start, if bounded.
+    // Once a frame has started, the server's read timeout applies to the rest
+    // of the message instead.
+    void set_idle_timeout(std::optional<std::chrono::seconds> idle_timeout) {
+        idle_timeout_ = idle_timeout;
+    }
+
+    // Whether an HTTP/1.1 request is a valid opening handshake.
+    static bool is_upgrade_request(const Request &request);
+
+    // The Sec-WebSocket-Accept value answering a Sec-WebSocket-Key.
+    static std::string make_accept_key(std::string_view key);
+
+    // Returns the next text or binary message. Once the client closes the
+    // WebSocket, its close frame is echoed and CONNECTION_CLOSED returned.
+    // Protocol violations close it with INVALID_REQUEST.
+    Task<std::variant<WebSocketMessage, Error>> receive();
+
+    Task<std::optional<Error>>
+    send(std::string_view data, WebSocketOpcode opcode = WebSocketOpcode::TEXT);
+
+    Task<std::optional<Error>> ping(std::string_view data = {});
+
+    // Sends a close frame, after which nothing else can be sent.
+    Task<std::optional<Error>>
+    close(u16 code = NORMAL_CLOSURE, std::string_view reason = {});
+};
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_WEBSOCKET_HPP
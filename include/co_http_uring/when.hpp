@@ -0,0 +1,305 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_WHEN_HPP
+#define CO_HTTP_URING_WHEN_HPP
+
+#include "task.hpp"
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace co_http_uring {
+
+template <typename T>
+using TaskResult = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+// Tasks that run concurrently on the same ring, and that the coroutine which
+// started them joins once they have all finished. With `cancel_losers`, the
+// first task to finish cancels the others.
+class TaskGroup {
+public:
+    // Awaits one task of the group, and resumes the joining coroutine if it
+    // finishes last.
+    class Member {
+    public:
+        class promise_type;
+
+    private:
+        using Coroutine = std::coroutine_handle<promise_type>;
+
+        Coroutine coroutine_;
+
+        struct FinalAwaitable {
+            [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(Coroutine coroutine
+            ) const noexcept {
+                promise_type &promise = coroutine.promise();
+                return promise.group_->finish(promise.index_);
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+    public:
+        class promise_type : public TaskPromiseBase {
+            friend FinalAwaitable;
+
+            TaskGroup *group_;
+            std::size_t index_;
+
+        public:
+            template <typename... Args>
+            explicit promise_type(
+                TaskGroup &group,
+                std::size_t index,
+                Args &...
+            ) :
+                group_{&group},
+                index_{index} {
+                group.running_++;
+            }
+
+            Member get_return_object() {
+                return Member{Coroutine::from_promise(*this)};
+            }
+
+            std::suspend_never initial_suspend() { return {}; }
+
+            FinalAwaitable final_suspend() noexcept { return {}; }
+
+            void return_void() {}
+
+            // Rethrown by the joining coroutine, as the task has no result.
+            void unhandled_exception() {
+                if (!group_->exception_) {
+                    group_->exception_ = std::current_exception();
+                }
+            }
+        };
+
+        explicit Member(Coroutine coroutine) : coroutine_{coroutine} {}
+
+        Member(const Member &) = delete;
+        Member &operator=(const Member &) = delete;
+
+        Member(Member &&other) noexcept :
+            coroutine_{std::exchange(other.coroutine_, nullptr)} {
+        }
+
+        Member &operator=(Member &&other) = delete;
+
+        ~Member() {
+            if (coroutine_ && coroutine_.done()) {
+                coroutine_.destroy();
+            }
+        }
+
+        void cancel() const { coroutine_.promise().cancel(); }
+    };
+
+private:
+    class JoinAwaitable {
+        TaskGroup *group_;
+        TaskPromiseBase *promise_{};
+
+    public:
+        explicit JoinAwaitable(TaskGroup *group) : group_{group} {}
+
+        [[nodiscard]] bool await_ready() const {
+            return group_->running_ == 0;
+        }
+
+        template <typename Promise>
+        void await_suspend(std::coroutine_handle<Promise> coroutine) {
+            group_->joiner_ = coroutine;
+
+            if constexpr (std::is_base_of_v<TaskPromiseBase, Promise>) {
+                promise_ = &coroutine.promise();
+                promise_->join_group(*group_);
+            }
+        }
+
+        void await_resume() const {
+            if (promise_ != nullptr) {
+                promise_->leave_group();
+            }
+        }
+    };
+
+    std::vector<Member> members_;
+    std::size_t running_ = 0;
+    std::optional<std::size_t> winner_;
+    bool cancel_losers_;
+    std::coroutine_handle<> joiner_;
+    std::exception_ptr exception_;
+
+    std::coroutine_handle<> finish(std::size_t index);
+
+    // `group` and `index` are for the promise's constructor.
+    template <typename T>
+    static Member
+    run([[maybe_unused]] TaskGroup &group,
+        [[maybe_unused]] std::size_t index,
+        Task<T> task,
+        std::optional<TaskResult<T>> &result) {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+            result.emplace();
+        } else {
+            result.emplace(co_await task);
+        }
+    }
+
+public:
+    explicit TaskGroup(bool cancel_losers) : cancel_losers_{cancel_losers} {}
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    TaskGroup(TaskGroup &&) = delete;
+    TaskGroup &operator=(TaskGroup &&) = delete;
+
+    ~TaskGroup() = default;
+
+    // Adds a task that stores its result in `result` when it finishes. Both
+    // must outlive the group.
+    template <typename T>
+    void add(Task<T> task, std::optional<TaskResult<T>> &result) {
+        std::size_t index = members_.size();
+        members_.push_back(run(*this, index, std::move(task), result));
+
+        // A task that was added earlier may have finished already.
+        if (cancel_losers_ && winner_) {
+            members_.back().cancel();
+        }
+    }
+
+    // The index of the first task to finish.
+    [[nodiscard]] std::optional<std::size_t> winner() const { return winner_; }
+
+    // Resumes once every task has finished.
+    JoinAwaitable join() { return JoinAwaitable{this}; }
+
+    // Rethrows the first exception that a task let escape, if any.
+    void rethrow_exception() const {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+    void cancel();
+};
+
+// Runs `tasks` concurrently and resumes once with all of their results.
+template <typename... Ts>
+Task<std::tuple<TaskResult<Ts>...>> when_all(Task<Ts>... tasks) {
+    std::tuple<std::optional<TaskResult<Ts>>...> results;
+    TaskGroup group{false};
+
+    [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+        (group.add(std::move(tasks), std::get<Is>(results)), ...);
+    }(std::index_sequence_for<Ts...>{});
+
+    co_await group.join();
+    group.rethrow_exception();
+
+    co_return std::apply(
+        [](auto &...result) {
+            return std::tuple<TaskResult<Ts>...>{std::move(*result)...};
+        },
+        results
+    );
+}
+
+template <typename T>
+Task<std::vector<TaskResult<T>>> when_all(std::vector<Task<T>> tasks) {
+    std::vector<std::optional<TaskResult<T>>> results(tasks.size());
+    TaskGroup group{false};
+
+    for (std::size_t i = 0; i < tasks.size(); i++) {
+        group.add(std::move(tasks[i]), results[i]);
+    }
+
+    co_await group.join();
+    group.rethrow_exception();
+    std::vector<TaskResult<T>> values;
+    values.reserve(results.size());
+
+    for (std::optional<TaskResult<T>> &result : results) {
+        values.push_back(std::move(*result));
+    }
+
+    co_return values;
+}
+
+// Runs `tasks` concurrently and resumes once with the result of the first to
+// finish, whose index is that of the variant. The others are cancelled, and
+// waited for so that nothing they use is destroyed under them.
+template <typename... Ts>
+Task<std::variant<TaskResult<Ts>...>> when_any(Task<Ts>... tasks) {
+    static_assert(sizeof...(Ts) > 0, "when_any() needs a task");
+
+    std::tuple<std::optional<TaskResult<Ts>>...> results;
+    TaskGroup group{true};
+
+    [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+        (group.add(std::move(tasks), std::get<Is>(results)), ...);
+    }(std::index_sequence_for<Ts...>{});
+
+    co_await group.join();
+    group.rethrow_exception();
+
+    // The winner's alternative is built in place, so that no other has to be
+    // default-constructible.
+    using Variant = std::variant<TaskResult<Ts>...>;
+    using Results = decltype(results);
+
+    co_return [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+        constexpr std::array<Variant (*)(Results &), sizeof...(Ts)> take{
+            [](Results &results) {
+                return Variant{
+                    std::in_place_index<Is>,
+                    std::move(*std::get<Is>(results)),
+                };
+            }...,
+        };
+        return take[*group.winner()](results);
+    }(std::index_sequence_for<Ts...>{});
+}
+
+// Returns the index of the first task to finish along with its result, or the
+// number of tasks if there are none.
+template <typename T>
+Task<std::pair<std::size_t, TaskResult<T>>>
+when_any(std::vector<Task<T>> tasks) {
+    std::vector<std::optional<TaskResult<T>>> results(tasks.size());
+    TaskGroup group{true};
+
+    for (std::size_t i = 0; i < tasks.size(); i++) {
+        group.add(std::move(tasks[i]), results[i]);
+    }
+
+    co_await group.join();
+    group.rethrow_exception();
+
+    if (!group.winner()) {
+        co_return std::pair<std::size_t, TaskResult<T>>{tasks.size(), {}};
+    }
+
+    std::size_t winner = *group.winner();
+    co_return std::pair{winner, std::move(*results[winner])};
+}
+
+} // namespace co_http_uring
+
+#endif // CO_HTTP_URING_WHEN_HPP
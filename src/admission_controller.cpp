@@ -0,0 +1,125 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/admission_controller.hpp"
+
+#include "co_http_uring/types.hpp"
+
+#include <fmt/core.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace co_http_uring {
+
+namespace {
+
+constexpr auto RELAXED = std::memory_order_relaxed;
+
+// The next exponential moving average, with a weight of 1/8 for `sample`.
+template <typename T>
+T next_average(T average, T sample) {
+    return average + (sample - average) / 8;
+}
+
+} // namespace
+
+AdmissionController::AdmissionController(const AdmissionPolicy &policy) :
+    policy_{policy},
+    shed_response_{fmt::format(
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Retry-After: {}\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        policy.retry_after.count()
+    )} {
+}
+
+void AdmissionController::update_overloaded() {
+    bool overloaded =
+        (policy_.max_cqes_per_loop != 0 &&
+         cqes_per_loop_.load(RELAXED) > policy_.max_cqes_per_loop) ||
+        (policy_.max_queueing_delay.count() != 0 &&
+         std::chrono::nanoseconds{queueing_delay_.load(RELAXED)} >
+             policy_.max_queueing_delay) ||
+        (policy_.max_handler_latency.count() != 0 &&
+         std::chrono::nanoseconds{handler_latency_.load(RELAXED)} >
+             policy_.max_handler_latency);
+    overloaded_.store(overloaded, RELAXED);
+}
+
+void AdmissionController::record_loop(
+    unsigned int cqes,
+    std::chrono::nanoseconds busy_time
+) {
+    // Only this server's thread stores these, so they need no atomic
+    // read-modify-write.
+    cqes_per_loop_.store(
+        next_average(cqes_per_loop_.load(RELAXED), static_cast<double>(cqes)),
+        RELAXED
+    );
+    queueing_delay_.store(
+        next_average(queueing_delay_.load(RELAXED), busy_time.count()),
+        RELAXED
+    );
+    update_overloaded();
+}
+
+void AdmissionController::record_handler(std::chrono::nanoseconds latency) {
+    handler_latency_.store(
+        next_average(handler_latency_.load(RELAXED), latency.count()),
+        RELAXED
+    );
+    update_overloaded();
+}
+
+bool AdmissionController::update_accepting(std::size_t connections) {
+    connections_.store(connections, RELAXED);
+
+    if (policy_.max_connections == 0) {
+        return true;
+    }
+
+    bool accepting = accepting_.load(RELAXED);
+
+    if (accepting && connections >= policy_.max_connections) {
+        accepting = false;
+        accept_pauses_.store(accept_pauses_.load(RELAXED) + 1, RELAXED);
+    } else if (!accepting &&
+               connections <
+                   policy_.max_connections - policy_.max_connections / 8) {
+        accepting = true;
+    }
+
+    accepting_.store(accepting, RELAXED);
+    return accepting;
+}
+
+bool AdmissionController::shed_request() {
+    if (!overloaded_.load(RELAXED)) {
+        return false;
+    }
+
+    shed_requests_.store(shed_requests_.load(RELAXED) + 1, RELAXED);
+    record_handler({});
+    return true;
+}
+
+AdmissionController::Stats AdmissionController::stats() const {
+    return {
+        .connections = connections_.load(RELAXED),
+        .accept_pauses = accept_pauses_.load(RELAXED),
+        .shed_requests = shed_requests_.load(RELAXED),
+        .accepting = accepting_.load(RELAXED),
+        .overloaded = overloaded_.load(RELAXED),
+        .cqes_per_loop = cqes_per_loop_.load(RELAXED),
+        .queueing_delay =
+            std::chrono::nanoseconds{queueing_delay_.load(RELAXED)},
+        .handler_latency =
+            std::chrono::nanoseconds{handler_latency_.load(RELAXED)},
+    };
+}
+
+} // namespace co_http_uring
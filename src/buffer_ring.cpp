@@ -0,0 +1,50 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/buffer_ring.hpp"
+
+#include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/pooled_buffer.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <liburing.h>
+
+#include <utility>
+
+namespace co_http_uring {
+
+BufferRing::BufferRing(IoUring &ring, u16 group_id) :
+    ring_{&ring},
+    buf_ring_{ring.setup_buf_ring(ENTRIES, group_id)},
+    group_id_{group_id},
+    buffers_(ENTRIES) {
+    for (unsigned int i = 0; i < ENTRIES; ++i) {
+        provide(static_cast<u16>(i));
+    }
+}
+
+BufferRing::~BufferRing() {
+    ring_->free_buf_ring(buf_ring_, ENTRIES, group_id_);
+}
+
+void BufferRing::provide(u16 buffer_id) {
+    PooledBuffer &buffer = buffers_[buffer_id];
+    buffer = PooledBuffer::acquire();
+    io_uring_buf_ring_add(
+        buf_ring_,
+        buffer.data(),
+        buffer.size(),
+        buffer_id,
+        io_uring_buf_ring_mask(ENTRIES),
+        0
+    );
+    io_uring_buf_ring_advance(buf_ring_, 1);
+}
+
+PooledBuffer BufferRing::take(u16 buffer_id) {
+    PooledBuffer buffer = std::move(buffers_[buffer_id]);
+    provide(buffer_id);
+    return buffer;
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,270 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/client_response.hpp"
+
+#include "co_http_uring/connection_reader.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/header_map.hpp"
+#include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <charconv>
+#include <coroutine>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace co_http_uring {
+
+Task<std::optional<Error>>
+ClientResponse::read_status_line(ConnectionReader &reader) {
+    std::variant<std::string_view, Error> result = co_await reader.read_line();
+
+    if (const auto *error = std::get_if<Error>(&result)) {
+        co_return *error;
+    }
+
+    // HTTP/1.x SSS reason
+    auto line = std::get<std::string_view>(result);
+
+    if (line.size() < 12 ||
+        !line.starts_with(http_utils::HTTP_1_VERSION_PREFIX) ||
+        !http_utils::is_digit(line[7]) || line[8] != ' ' ||
+        (line.size() > 12 && line[12] != ' ')) {
+        co_return Error::INVALID_RESPONSE;
+    }
+
+    std::string_view code = line.substr(9, 3);
+
+    if (!http_utils::is_number(code)) {
+        co_return Error::INVALID_RESPONSE;
+    }
+
+    std::from_chars(code.data(), code.data() + code.size(), status_code_);
+    http_version_ = {1, line[7] - '0'};
+    co_return {};
+}
+
+Task<std::optional<Error>>
+ClientResponse::read_headers(ConnectionReader &reader) {
+    while (true) {
+        std::variant<std::string_view, Error> result =
+            co_await reader.read_line();
+
+        if (const auto *error = std::get_if<Error>(&result)) {
+            co_return *error;
+        }
+
+        auto line = std::get<std::string_view>(result);
+
+        if (line.empty()) {
+            co_return {};
+        }
+
+        if (!parse_header_line(headers_, line)) {
+            co_return Error::INVALID_RESPONSE;
+        }
+    }
+}
+
+Task<std::optional<Error>> ClientResponse::read_body(
+    ConnectionReader &reader,
+    u64 length,
+    u64 max_body_size
+) {
+    // Written so that a huge chunk size cannot wrap around.
+    if (length > max_body_size - body_.size()) {
+        co_return Error::READ_LIMIT_REACHED;
+    }
+
+    while (length > 0) {
+        std::variant<std::string_view, Error> result =
+            co_await reader.read_some(length);
+
+        if (const auto *error = std::get_if<Error>(&result)) {
+            co_return *error;
+        }
+
+        auto data = std::get<std::string_view>(result);
+        body_ += data;
+        length -= data.size();
+    }
+
+    co_return {};
+}
+
+Task<std::optional<Error>>
+ClientResponse::read_chunked_body(ConnectionReader &reader, u64 max_body_size) {
+    while (true) {
+        std::variant<std::string_view, Error> result =
+            co_await reader.read_line();
+
+        if (const auto *error = std::get_if<Error>(&result)) {
+            co_return *error;
+        }
+
+        // Chunk extensions are ignored.
+        auto line = std::get<std::string_view>(result);
+        line = line.substr(0, line.find(';'));
+        u64 chunk_size{};
+        const char *line_end = line.data() + line.size();
+        auto [ptr, ec] = std::from_chars(line.data(), line_end, chunk_size, 16);
+
+        if (ec != std::errc{} || ptr == line.data()) {
+            co_return Error::INVALID_RESPONSE;
+        }
+
+        if (chunk_size == 0) {
+            break;
+        }
+
+        std::optional<Error> error =
+            co_await read_body(reader, chunk_size, max_body_size);
+
+        if (error) {
+            co_return error;
+        }
+
+        result = co_await reader.read_line();
+
+        if (const auto *read_error = std::get_if<Error>(&result)) {
+            co_return *read_error;
+        }
+
+        if (!std::get<std::string_view>(result).empty()) {
+            co_return Error::INVALID_RESPONSE;
+        }
+    }
+
+    // Trailer fields are merged into the headers.
+    co_return co_await read_headers(reader);
+}
+
+Task<std::optional<Error>> ClientResponse::read_body_until_close(
+    ConnectionReader &reader,
+    u64 max_body_size
+) {
+    while (true) {
+        std::variant<std::string_view, Error> result =
+            co_await reader.read_some();
+
+        if (const auto *error = std::get_if<Error>(&result)) {
+            if (*error == Error::CONNECTION_CLOSED) {
+                co_return {};
+            }
+
+            co_return *error;
+        }
+
+        auto data = std::get<std::string_view>(result);
+
+        if (data.size() > max_body_size - body_.size()) {
+            co_return Error::READ_LIMIT_REACHED;
+        }
+
+        body_ += data;
+    }
+}
+
+Task<std::variant<ClientResponse, Error>>
+ClientResponse::receive_head(ConnectionReader &reader) {
+    ClientResponse response;
+    std::optional<Error> error;
+
+    // Interim responses carry no body and precede the final one.
+    do {
+        response.headers_.clear();
+
+        if ((error = co_await response.read_status_line(reader)) ||
+            (error = co_await response.read_headers(reader))) {
+            co_return *error;
+        }
+    } while (response.status_code_ >= 100 && response.status_code_ < 200 &&
+             response.status_code_ != 101);
+
+    const HeaderMap &headers = response.headers_;
+    response.keep_alive_ = response.http_version_.minor >= 1
+        ? !headers.contains_token(Header::CONNECTION, "close")
+        : headers.contains_token(Header::CONNECTION, "keep-alive");
+    co_return response;
+}
+
+bool ClientResponse::has_body(std::string_view request_method) const {
+    return request_method != "HEAD" && status_code_ != 204 &&
+        status_code_ != 304 && status_code_ != 101;
+}
+
+std::optional<ClientResponse::BodyFraming>
+ClientResponse::body_framing() const {
+    if (headers_.contains(Header::TRANSFER_ENCODING)) {
+        if (!headers_.contains_token(Header::TRANSFER_ENCODING, "chunked")) {
+            return {};
+        }
+
+        return BodyFraming{BodyFraming::CHUNKED};
+    }
+
+    u64 content_length = std::numeric_limits<u64>::max();
+
+    if (!parse_content_length(headers_, content_length)) {
+        return {};
+    }
+
+    if (content_length == std::numeric_limits<u64>::max()) {
+        return BodyFraming{BodyFraming::UNTIL_CLOSE};
+    }
+
+    return BodyFraming{BodyFraming::CONTENT_LENGTH, content_length};
+}
+
+Task<std::variant<ClientResponse, Error>> ClientResponse::receive(
+    ConnectionReader &reader,
+    std::string_view request_method,
+    u64 max_body_size
+) {
+    std::variant<ClientResponse, Error> result =
+        co_await receive_head(reader);
+
+    if (std::holds_alternative<Error>(result)) {
+        co_return result;
+    }
+
+    auto &response = std::get<ClientResponse>(result);
+
+    if (!response.has_body(request_method)) {
+        co_return result;
+    }
+
+    std::optional<BodyFraming> framing = response.body_framing();
+    std::optional<Error> error;
+
+    if (!framing) {
+        co_return Error::INVALID_RESPONSE;
+    }
+
+    switch (framing->kind) {
+    case BodyFraming::CONTENT_LENGTH:
+        error =
+            co_await response.read_body(reader, framing->length, max_body_size);
+        break;
+    case BodyFraming::CHUNKED:
+        error = co_await response.read_chunked_body(reader, max_body_size);
+        break;
+    case BodyFraming::UNTIL_CLOSE:
+        response.keep_alive_ = false;
+        error = co_await response.read_body_until_close(reader, max_body_size);
+        break;
+    }
+
+    if (error) {
+        co_return *error;
+    }
+
+    co_return result;
+}
+
+} // namespace co_http_uring
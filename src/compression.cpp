@@ -0,0 +1,229 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/compression.hpp"
+
+#include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace co_http_uring {
+
+namespace {
+
+constexpr int WINDOW_BITS = 15;
+constexpr int GZIP_WINDOW_BITS = WINDOW_BITS + 16;
+constexpr int MEM_LEVEL = 8;
+
+// Parses the weight of a "coding;q=x" element, defaulting to 1.
+double parse_weight(std::string_view params) {
+    while (!params.empty()) {
+        std::size_t param_end = params.find(';');
+        std::string_view param =
+            http_utils::trim_header_value(params.substr(0, param_end));
+        params.remove_prefix(
+            param_end == std::string_view::npos ? params.size() : param_end + 1
+        );
+
+        if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') ||
+            param[1] != '=') {
+            continue;
+        }
+
+        param.remove_prefix(2);
+        double weight = 0;
+        auto result =
+            std::from_chars(param.data(), param.data() + param.size(), weight);
+
+        if (result.ec != std::errc{}) {
+            return 0;
+        }
+
+        return std::clamp(weight, 0.0, 1.0);
+    }
+
+    return 1;
+}
+
+} // namespace
+
+std::string_view content_encoding_name(ContentEncoding encoding) {
+    switch (encoding) {
+        using enum ContentEncoding;
+    case IDENTITY: return "identity";
+    case DEFLATE: return "deflate";
+    case GZIP: return "gzip";
+    }
+
+    return "identity";
+}
+
+ContentEncoding
+negotiate_content_encoding(
+    const std::pmr::vector<std::pmr::string> &accept_encoding
+) {
+    double gzip_weight = -1;
+    double deflate_weight = -1;
+    double wildcard_weight = -1;
+
+    for (std::string_view value : accept_encoding) {
+        while (!value.empty()) {
+            std::size_t element_end = value.find(',');
+            std::string_view element = value.substr(0, element_end);
+            value.remove_prefix(
+                element_end == std::string_view::npos ? value.size()
+                                                      : element_end + 1
+            );
+
+            std::size_t coding_end = element.find(';');
+            std::string_view coding =
+                http_utils::trim_header_value(element.substr(0, coding_end));
+            double weight = coding_end == std::string_view::npos
+                ? 1
+                : parse_weight(element.substr(coding_end + 1));
+
+            if (http_utils::equals_ignore_case(coding, "gzip") ||
+                http_utils::equals_ignore_case(coding, "x-gzip")) {
+                gzip_weight = std::max(gzip_weight, weight);
+            } else if (http_utils::equals_ignore_case(coding, "deflate")) {
+                deflate_weight = std::max(deflate_weight, weight);
+            } else if (coding == "*") {
+                wildcard_weight = std::max(wildcard_weight, weight);
+            }
+        }
+    }
+
+    if (gzip_weight < 0) {
+        gzip_weight = wildcard_weight;
+    }
+
+    if (deflate_weight < 0) {
+        deflate_weight = wildcard_weight;
+    }
+
+    if (gzip_weight <= 0 && deflate_weight <= 0) {
+        return ContentEncoding::IDENTITY;
+    }
+
+    return gzip_weight >= deflate_weight ? ContentEncoding::GZIP
+                                         : ContentEncoding::DEFLATE;
+}
+
+Deflater::Deflater(ContentEncoding encoding, int level) :
+    stream_{std::make_unique<z_stream_s>()},
+    encoding_{encoding},
+    level_{level} {
+    if (encoding == ContentEncoding::IDENTITY) {
+        throw std::invalid_argument("identity is not a deflate encoding");
+    }
+
+    int window_bits =
+        encoding == ContentEncoding::GZIP ? GZIP_WINDOW_BITS : WINDOW_BITS;
+    int ret = deflateInit2(
+        stream_.get(),
+        level,
+        Z_DEFLATED,
+        window_bits,
+        MEM_LEVEL,
+        Z_DEFAULT_STRATEGY
+    );
+
+    if (ret != Z_OK) {
+        throw std::runtime_error("deflateInit2() failed");
+    }
+}
+
+Deflater::~Deflater() {
+    if (stream_) {
+        deflateEnd(stream_.get());
+    }
+}
+
+Deflater::Deflater(Deflater &&) noexcept = default;
+
+Deflater &Deflater::operator=(Deflater &&other) noexcept {
+    if (this != &other) {
+        if (stream_) {
+            deflateEnd(stream_.get());
+        }
+
+        stream_ = std::move(other.stream_);
+        encoding_ = other.encoding_;
+        level_ = other.level_;
+    }
+
+    return *this;
+}
+
+void Deflater::reset() {
+    if (deflateReset(stream_.get()) != Z_OK) {
+        throw std::runtime_error("deflateReset() failed");
+    }
+}
+
+void Deflater::set_input(std::string_view input) {
+    // zlib never writes through next_in.
+    stream_->next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream_->avail_in = static_cast<uInt>(input.size());
+}
+
+Deflater::Result Deflater::deflate(std::span<u8> output, bool finish) {
+    stream_->next_out = output.data();
+    stream_->avail_out = static_cast<uInt>(
+        std::min<std::size_t>(output.size(), std::numeric_limits<uInt>::max())
+    );
+
+    int ret = ::deflate(stream_.get(), finish ? Z_FINISH : Z_NO_FLUSH);
+
+    if (ret == Z_STREAM_ERROR) {
+        throw std::runtime_error("deflate() failed");
+    }
+
+    return {
+        .bytes_written = output.size() - stream_->avail_out,
+        .finished = ret == Z_STREAM_END,
+    };
+}
+
+std::string
+compress(std::string_view data, ContentEncoding encoding, int level) {
+    if (encoding == ContentEncoding::IDENTITY) {
+        return std::string{data};
+    }
+
+    Deflater deflater{encoding, level};
+    deflater.set_input(data);
+
+    std::string compressed;
+    compressed.resize(compressBound(data.size()) + 32);
+    std::size_t size = 0;
+
+    while (true) {
+        std::span<u8> output{
+            reinterpret_cast<u8 *>(compressed.data()) + size,
+            compressed.size() - size,
+        };
+        auto [bytes_written, finished] = deflater.deflate(output, true);
+        size += bytes_written;
+
+        if (finished) {
+            break;
+        }
+
+        compressed.resize(2 * compressed.size());
+    }
+
+    compressed.resize(size);
+    return compressed;
+}
+
+} // namespace co_http_uring
@@ -5,6 +5,7 @@
 
 #include "co_http_uring/connection_future.hpp"
 #include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/probes.hpp"
 #include "co_http_uring/server.hpp"
 #include "co_http_uring/task.hpp"
 #include "co_http_uring/types.hpp"
@@ -14,6 +15,9 @@
 #include <coroutine>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace co_http_uring {
 
@@ -23,6 +27,39 @@ Connection::Connection(int fixed_fd) :
     writer_{fixed_fd_} {
 }
 
+thread_local std::vector<std::unique_ptr<Connection::Arena>>
+    Connection::ArenaResource::idle_arenas_;
+
+void *Connection::ArenaResource::do_allocate(
+    std::size_t bytes,
+    std::size_t alignment
+) {
+    if (!arena_) {
+        if (idle_arenas_.empty()) {
+            arena_ = std::make_unique_for_overwrite<Arena>();
+        } else {
+            arena_ = std::move(idle_arenas_.back());
+            idle_arenas_.pop_back();
+        }
+    }
+
+    return arena_->resource.allocate(bytes, alignment);
+}
+
+void Connection::ArenaResource::release() {
+    if (!arena_) {
+        return;
+    }
+
+    arena_->resource.release();
+
+    if (idle_arenas_.size() < MAX_IDLE_ARENAS) {
+        idle_arenas_.push_back(std::move(arena_));
+    }
+
+    arena_.reset();
+}
+
 ConnectionFuture<Connection> Connection::submit_close() {
     IoUring &ring = Server::thread_instance()->ring();
 
@@ -35,6 +72,7 @@ ConnectionFuture<Connection> Connection::submit_close() {
 }
 
 Task<> Connection::close() {
+    CO_HTTP_URING_PROBE1(close, fixed_fd_);
     co_await submit_close();
     IoUring &ring = Server::thread_instance()->ring();
 
@@ -0,0 +1,88 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/connection_balancer.hpp"
+
+#include "co_http_uring/types.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+namespace co_http_uring {
+
+ConnectionBalancer::ConnectionBalancer(
+    std::size_t max_servers,
+    u32 max_imbalance
+) :
+    members_{std::make_unique<Member[]>(max_servers)},
+    capacity_{max_servers},
+    max_imbalance_{max_imbalance} {
+}
+
+ConnectionBalancer::Member &ConnectionBalancer::join(int ring_fd) {
+    std::size_t index = size_.fetch_add(1, std::memory_order_relaxed);
+
+    if (index >= capacity_) {
+        throw std::length_error("too many servers in ConnectionBalancer");
+    }
+
+    Member &member = members_[index];
+    member.ring_fd.store(ring_fd, std::memory_order_release);
+    return member;
+}
+
+void ConnectionBalancer::leave(Member &member) {
+    // Sequentially consistent, like the handoff count and the sender's load
+    // of ring_fd in between, so that either the sender sees the member gone
+    // or the member sees the handoff.
+    member.ring_fd.store(-1);
+    member.connections.store(0, std::memory_order_relaxed);
+}
+
+ConnectionBalancer::Member *
+ConnectionBalancer::pick_target(const Member &self) {
+    u32 self_connections = self.connections.load(std::memory_order_relaxed);
+
+    if (self_connections <= max_imbalance_) {
+        return nullptr;
+    }
+
+    std::size_t size =
+        std::min(size_.load(std::memory_order_relaxed), capacity_);
+    Member *target = nullptr;
+    u32 target_connections = self_connections - max_imbalance_;
+
+    for (std::size_t i = 0; i < size; ++i) {
+        Member &member = members_[i];
+
+        // Members that are still joining have no ring yet, and those that
+        // left have none anymore.
+        if (&member == &self ||
+            member.ring_fd.load(std::memory_order_acquire) == -1) {
+            continue;
+        }
+
+        u32 connections = member.connections.load(std::memory_order_relaxed);
+
+        if (connections < target_connections) {
+            target = &member;
+            target_connections = connections;
+        }
+    }
+
+    if (target) {
+        target->connections.fetch_add(1, std::memory_order_relaxed);
+        target->handoffs.fetch_add(1);
+    }
+
+    return target;
+}
+
+void ConnectionBalancer::finish_handoff(Member &target) {
+    target.handoffs.fetch_sub(1);
+}
+
+} // namespace co_http_uring
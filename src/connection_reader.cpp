@@ -3,11 +3,18 @@
 
 #include "co_http_uring/connection_reader.hpp"
 
+#include "co_http_uring/buffer_ring.hpp"
 #include "co_http_uring/connection_future.hpp"
+#include "co_http_uring/connection_writer.hpp"
 #include "co_http_uring/error.hpp"
+#include "co_http_uring/file.hpp"
 #include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/pipe.hpp"
+#include "co_http_uring/pooled_buffer.hpp"
+#include "co_http_uring/probes.hpp"
 #include "co_http_uring/server.hpp"
 #include "co_http_uring/task.hpp"
+#include "co_http_uring/trace.hpp"
 #include "co_http_uring/types.hpp"
 
 #include <fmt/core.h>
@@ -19,123 +26,457 @@
 #include <coroutine>
 #include <cstdio>
 #include <cstring>
+#include <functional>
 #include <limits>
+#include <memory>
 #include <optional>
-
-extern "C" {
-#include <linux/time_types.h>
-}
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
 
 namespace co_http_uring {
 
+namespace {
+
+constexpr std::string_view CONTINUE_RESPONSE =
+    "HTTP/1.1 100 Continue\r\n\r\n";
+
+} // namespace
+
 ConnectionReader::ConnectionReader(int fixed_fd) :
     fixed_fd_{fixed_fd},
     bytes_remaining_{std::numeric_limits<i64>::max()},
-    buffer_{std::make_unique<Buffer>()},
-    begin_{buffer_->cbegin()},
-    end_{begin_} {
+    max_buffer_size_{PooledBuffer::MAX_SIZE} {
+}
+
+ConnectionReader::ConnectionReader(Source source) : ConnectionReader{-1} {
+    source_ = std::move(source);
+}
+
+void ConnectionReader::rewind_if_empty() {
+    if (begin_ == end_) {
+        begin_ = 0;
+        end_ = 0;
+    }
 }
 
-ConnectionFuture<ConnectionReader> ConnectionReader::submit_recv() {
+bool ConnectionReader::grow() {
+    if (buffer_.size() >= max_buffer_size_) {
+        return false;
+    }
+
+    PooledBuffer buffer = PooledBuffer::acquire(buffer_.size() * 2);
+    std::copy(buffer_.data() + begin_, buffer_.data() + end_, buffer.data());
+    end_ -= begin_;
+    begin_ = 0;
+    buffer_ = std::move(buffer);
+    return true;
+}
+
+void ConnectionReader::release_buffer() {
     if (begin_ == end_) {
-        begin_ = buffer_->cbegin();
-        end_ = begin_;
+        buffer_.release();
+        begin_ = 0;
+        end_ = 0;
     }
+}
 
+ConnectionFuture<ConnectionReader>
+ConnectionReader::submit_recv(BufferRing *buffer_ring) {
     auto *server = Server::thread_instance();
     IoUring &ring = server->ring();
 
+    std::optional<std::chrono::seconds> timeout =
+        has_own_read_timeout_ ? read_timeout_ : server->read_timeout();
+
     IoUringSqe sqe = ring.get_sqe();
-    unsigned int num_bytes =
-        std::min(static_cast<u64>(buffer_->cend() - end_), bytes_remaining_);
-    u64 offset = end_ - buffer_->cbegin();
-    sqe.prep_recv(fixed_fd_, buffer_->data() + offset, num_bytes, 0);
+
+    if (buffer_ring != nullptr) {
+        unsigned int num_bytes =
+            std::min<u64>(PooledBuffer::MIN_SIZE, bytes_remaining_);
+        sqe.prep_recv(fixed_fd_, nullptr, num_bytes, 0);
+        sqe.set_flags(IOSQE_FIXED_FILE | (timeout ? IOSQE_IO_LINK : 0));
+        sqe.set_buffer_group(buffer_ring->group_id());
+    } else {
+        unsigned int num_bytes = std::min(
+            static_cast<u64>(buffer_.size() - end_),
+            bytes_remaining_
+        );
+        sqe.prep_recv(fixed_fd_, buffer_.data() + end_, num_bytes, 0);
+        sqe.set_flags(IOSQE_FIXED_FILE | (timeout ? IOSQE_IO_LINK : 0));
+    }
+
     sqe.set_data64(fixed_fd_);
-    sqe.set_flags(IOSQE_FIXED_FILE | IOSQE_IO_LINK);
 
-    sqe = ring.get_sqe();
-    __kernel_timespec timeout{
-        .tv_sec = server->read_timeout().count(),
-        .tv_nsec = 0,
-    };
-    sqe.prep_link_timeout(&timeout);
+    if (timeout) {
+        server->submit_linked_timeout(*timeout);
+    } else {
+        ring.submit();
+    }
+
+    return ConnectionFuture<ConnectionReader>(this);
+}
+
+ConnectionFuture<ConnectionReader>
+ConnectionReader::submit_send(std::string_view data) {
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
+
+    IoUringSqe sqe = ring.get_sqe();
+    sqe.prep_send(fixed_fd_, const_cast<char *>(data.data()), data.size(), 0);
     sqe.set_data64(fixed_fd_);
+    sqe.set_flags(IOSQE_FIXED_FILE | IOSQE_IO_LINK);
 
-    ring.submit();
+    server->submit_linked_timeout(server->write_timeout());
     return ConnectionFuture<ConnectionReader>(this);
 }
 
+void ConnectionReader::expect_continue(const ConnectionWriter &writer) {
+    continue_writer_ = &writer;
+    continue_flush_count_ = writer.flush_count();
+}
+
+Task<std::optional<Error>> ConnectionReader::send_pending_continue() {
+    const ConnectionWriter *writer = std::exchange(continue_writer_, nullptr);
+
+    if (writer == nullptr || writer->flush_count() != continue_flush_count_) {
+        co_return {};
+    }
+
+    // Sent directly rather than through the writer, in case the handler has
+    // already buffered part of its final response there.
+    std::string_view data = CONTINUE_RESPONSE;
+
+    while (!data.empty()) {
+        co_await submit_send(data);
+
+        IoUring &ring = Server::thread_instance()->ring();
+
+        IoUringCqe cqe = ring.peek_cqe();
+        i32 res = cqe.res();
+        ring.seen_cqe(cqe);
+
+        if (res == -ECANCELED) {
+            trace::record(trace::Event::WRITE_TIMEOUT, fixed_fd_);
+            co_return Error::WRITE_TIMED_OUT;
+        }
+
+        if (res < 0) {
+            fmt::print(stderr, "write error: {}\n", std::strerror(-res));
+            co_return Error::WRITE_ERROR;
+        }
+
+        data.remove_prefix(res);
+    }
+
+    co_return {};
+}
+
 Task<std::optional<Error>> ConnectionReader::fill() {
     if (bytes_remaining_ == 0) {
         co_return Error::READ_LIMIT_REACHED;
     }
 
-    if (end_ == buffer_->cend()) {
-        co_return Error::BUFFER_FULL;
+    // The client may be waiting for this before it sends anything.
+    if (std::optional<Error> error = co_await send_pending_continue()) {
+        co_return error;
+    }
+
+    rewind_if_empty();
+
+    if (buffer_ && end_ == buffer_.size()) {
+        if (begin_ == 0) {
+            co_return Error::BUFFER_FULL;
+        }
+
+        char *data = buffer_.data();
+        std::copy(data + begin_, data + end_, data);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+
+    if (source_) {
+        co_return co_await source_();
     }
 
-    co_await submit_recv();
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
+
+    // Without a buffer, the kernel picks one from the server's ring once
+    // data arrives. If the ring is exhausted, one is taken from the pool.
+    BufferRing *buffer_ring = nullptr;
+
+    if (!buffer_) {
+        buffer_ring = server->buffer_ring();
+
+        if (buffer_ring == nullptr) {
+            buffer_ = PooledBuffer::acquire();
+        }
+    }
 
-    IoUring &ring = Server::thread_instance()->ring();
+    trace::record(trace::Event::RECV_SUBMIT, fixed_fd_);
+    co_await submit_recv(buffer_ring);
+    trace::record(trace::Event::RECV_COMPLETE, fixed_fd_);
 
     IoUringCqe cqe = ring.peek_cqe();
     i32 res = cqe.res();
+    u32 flags = cqe.flags();
     ring.seen_cqe(cqe);
 
+    if (flags & IORING_CQE_F_BUFFER) {
+        buffer_ = buffer_ring->take(flags >> IORING_CQE_BUFFER_SHIFT);
+    } else if (res == -ENOBUFS) {
+        buffer_ = PooledBuffer::acquire();
+        co_return co_await fill();
+    }
+
     if (res == 0) {
         co_return Error::CONNECTION_CLOSED;
     }
 
     if (res < 0) {
-        if (res != -ETIME) {
+        if (res != -ECANCELED) {
             fmt::print(stderr, "read error: {}\n", std::strerror(-res));
             co_return Error::READ_ERROR;
         }
 
+        trace::record(trace::Event::READ_TIMEOUT, fixed_fd_);
         co_return Error::CONNECTION_TIMED_OUT;
     }
 
+    CO_HTTP_URING_PROBE2(recv, fixed_fd_, res);
     bytes_remaining_ -= res;
     end_ += res;
     co_return {};
 }
 
+std::size_t ConnectionReader::feed(std::string_view data) {
+    rewind_if_empty();
+
+    if (!buffer_) {
+        buffer_ = PooledBuffer::acquire();
+    }
+
+    std::size_t free_space = buffer_.size() - end_;
+    std::size_t num_bytes =
+        std::min<u64>({free_space, bytes_remaining_, data.size()});
+    std::copy_n(data.cbegin(), num_bytes, buffer_.data() + end_);
+    bytes_remaining_ -= num_bytes;
+    end_ += num_bytes;
+    return num_bytes;
+}
+
 Task<std::variant<std::string_view, Error>> ConnectionReader::read() {
     if (bytes_remaining_ == 0) {
         co_return Error::READ_LIMIT_REACHED;
     }
 
-    while (end_ != buffer_->cend() && bytes_remaining_ > 0) {
+    rewind_if_empty();
+
+    while ((!buffer_ || end_ != buffer_.size()) && bytes_remaining_ > 0) {
         if (std::optional<Error> error = co_await fill()) {
             co_return *error;
         }
     }
 
-    auto begin = begin_;
-    begin_ = end_;
-    co_return std::string_view{begin, end_};
+    co_return take_buffered(end_ - begin_);
+}
+
+Task<std::variant<std::string_view, Error>>
+ConnectionReader::read_some(std::size_t max_size) {
+    if (begin_ == end_) {
+        if (std::optional<Error> error = co_await fill()) {
+            co_return *error;
+        }
+    }
+
+    co_return take_buffered(max_size);
 }
 
 Task<std::variant<std::string_view, Error>> ConnectionReader::read_line() {
-    auto line_end = std::find(begin_, end_, '\n');
+    // Scanning resumes where the previous fill left off.
+    std::size_t scanned = 0;
 
-    while (line_end == end_) {
-        if (std::optional<Error> error = co_await fill()) {
+    while (true) {
+        const char *begin = buffer_.data() + begin_;
+        const char *end = buffer_.data() + end_;
+        const char *line_end = std::find(begin + scanned, end, '\n');
+
+        if (line_end != end) {
+            std::string_view line{begin, line_end};
+            begin_ += line.size() + 1;
+
+            if (line.ends_with('\r')) {
+                line.remove_suffix(1);
+            }
+
+            co_return line;
+        }
+
+        scanned = end_ - begin_;
+        std::optional<Error> error = co_await fill();
+
+        if (error == Error::BUFFER_FULL && grow()) {
+            error = co_await fill();
+        }
+
+        if (error) {
             co_return *error;
         }
+    }
+}
+
+Task<std::optional<Error>> ConnectionReader::fill_to(std::size_t size) {
+    while (end_ - begin_ < size) {
+        std::optional<Error> error = co_await fill();
+
+        if (error == Error::BUFFER_FULL && grow()) {
+            continue;
+        }
+
+        if (error) {
+            co_return error;
+        }
+    }
+
+    co_return {};
+}
+
+Task<std::variant<std::string_view, Error>>
+ConnectionReader::read_exact(std::size_t size) {
+    if (std::optional<Error> error = co_await fill_to(size)) {
+        co_return *error;
+    }
+
+    co_return take_buffered(size);
+}
+
+Task<std::optional<Error>> ConnectionReader::write_buffered_to(
+    const File &file,
+    u64 length,
+    u64 offset,
+    u64 &num_written
+) {
+    std::string_view buffered = take_buffered(length - num_written);
+
+    while (!buffered.empty()) {
+        std::variant<std::size_t, std::error_code> result =
+            co_await file.write(buffered, offset + num_written);
+
+        if (const auto *error = std::get_if<std::error_code>(&result)) {
+            fmt::print(stderr, "write error: {}\n", error->message());
+            co_return Error::WRITE_ERROR;
+        }
+
+        std::size_t size = std::get<std::size_t>(result);
+        buffered.remove_prefix(size);
+        num_written += size;
+    }
+
+    co_return {};
+}
+
+Task<std::optional<Error>> ConnectionReader::splice_to(
+    const File &file,
+    u64 length,
+    u64 offset,
+    std::function<void(u64)> on_progress
+) {
+    u64 num_written = 0;
+    std::optional<Error> error =
+        co_await write_buffered_to(file, length, offset, num_written);
+
+    if (error) {
+        co_return error;
+    }
+
+    if (on_progress && num_written > 0) {
+        on_progress(num_written);
+    }
+
+    if (num_written == length) {
+        co_return {};
+    }
+
+    // Without a socket, there is nothing to splice from.
+    if (source_) {
+        while (num_written < length) {
+            if ((error = co_await fill()) ||
+                (error = co_await write_buffered_to(
+                     file,
+                     length,
+                     offset,
+                     num_written
+                 ))) {
+                co_return error;
+            }
+
+            if (on_progress) {
+                on_progress(num_written);
+            }
+        }
 
-        line_end = std::find(begin_, end_, '\n');
+        co_return {};
     }
 
-    auto line_begin = begin_;
-    begin_ = line_end + 1;
-    std::string_view line{line_begin, line_end};
+    if ((error = co_await send_pending_continue())) {
+        co_return error;
+    }
+
+    std::unique_ptr<Pipe> pipe = Pipe::acquire();
+    std::chrono::seconds timeout = Server::thread_instance()->read_timeout();
+
+    while (num_written < length) {
+        if (bytes_remaining_ == 0) {
+            co_return Error::READ_LIMIT_REACHED;
+        }
+
+        unsigned int size = std::min<u64>(
+            {length - num_written, bytes_remaining_, Pipe::CAPACITY}
+        );
+        i32 res = co_await pipe->fill_from(fixed_fd_, -1, size, timeout);
 
-    if (line.ends_with('\r')) {
-        line.remove_suffix(1);
+        if (res == 0) {
+            co_return Error::CONNECTION_CLOSED;
+        }
+
+        if (res < 0) {
+            if (res != -ECANCELED) {
+                fmt::print(stderr, "read error: {}\n", std::strerror(-res));
+                co_return Error::READ_ERROR;
+            }
+
+            co_return Error::CONNECTION_TIMED_OUT;
+        }
+
+        bytes_remaining_ -= res;
+
+        while (res > 0) {
+            i32 written = co_await pipe->drain_to(
+                file.fixed_fd(),
+                static_cast<i64>(offset + num_written),
+                static_cast<unsigned int>(res)
+            );
+
+            if (written <= 0) {
+                const char *what = written < 0 ? std::strerror(-written)
+                                               : "no progress";
+                fmt::print(stderr, "write error: {}\n", what);
+                co_return Error::WRITE_ERROR;
+            }
+
+            res -= written;
+            num_written += written;
+        }
+
+        if (on_progress) {
+            on_progress(num_written);
+        }
     }
 
-    co_return line;
+    Pipe::release(std::move(pipe));
+    co_return {};
 }
 
 } // namespace co_http_uring
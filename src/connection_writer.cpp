@@ -3,20 +3,28 @@
 
 #include "co_http_uring/connection_writer.hpp"
 
-#include "co_http_uring/connection_future.hpp"
 #include "co_http_uring/error.hpp"
 #include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/operation_future.hpp"
+#include "co_http_uring/pooled_buffer.hpp"
+#include "co_http_uring/probes.hpp"
 #include "co_http_uring/server.hpp"
 #include "co_http_uring/task.hpp"
+#include "co_http_uring/trace.hpp"
 #include "co_http_uring/types.hpp"
 
 #include <fmt/core.h>
 #include <liburing.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <coroutine>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <functional>
+#include <utility>
 
 namespace co_http_uring {
 
@@ -24,38 +32,102 @@ namespace {
 
 constexpr std::string_view LINE_SEPARATOR = "\r\n";
 
+// How long sends may take before the minimum send rate applies.
+constexpr std::chrono::seconds MIN_SEND_RATE_GRACE{1};
+
 } // namespace
 
-ConnectionWriter::ConnectionWriter(int fixed_fd) :
-    fixed_fd_{fixed_fd},
-    buffer_{std::make_unique<Buffer>()},
-    begin_{buffer_->begin()},
-    end_{begin_} {
+ConnectionWriter::ConnectionWriter(int fixed_fd) : fixed_fd_{fixed_fd} {}
+
+ConnectionWriter::ConnectionWriter(Sink sink) :
+    fixed_fd_{-1},
+    sink_{std::move(sink)} {
+}
+
+std::chrono::nanoseconds ConnectionWriter::get_send_timeout() {
+    Server *server = Server::thread_instance();
+    std::chrono::nanoseconds timeout = server->write_timeout();
+
+    if (timing_response_ && server->response_write_timeout()) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (!response_deadline_) {
+            response_deadline_ = now + *server->response_write_timeout();
+        }
+
+        timeout = std::min<std::chrono::nanoseconds>(
+            timeout,
+            *response_deadline_ - now
+        );
+    }
+
+    // Past a grace period, sends may take as long as what was sent so far
+    // would at the minimum rate.
+    if (u64 min_send_rate = server->min_send_rate()) {
+        auto allowed_time = MIN_SEND_RATE_GRACE +
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::duration<double>(
+                    static_cast<double>(sent_size_) /
+                    static_cast<double>(min_send_rate)
+                )
+            );
+        timeout = std::min(timeout, allowed_time - send_time_);
+    }
+
+    return timeout;
 }
 
-ConnectionFuture<ConnectionWriter> ConnectionWriter::submit_send() {
-    IoUring &ring = Server::thread_instance()->ring();
+OperationFuture
+ConnectionWriter::submit_send(std::chrono::nanoseconds timeout) {
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
 
+    i64 key = server->allocate_operation_key();
     IoUringSqe sqe = ring.get_sqe();
     unsigned int num_bytes = end_ - begin_;
-    u64 offset = begin_ - buffer_->begin();
-    sqe.prep_send(fixed_fd_, buffer_->data() + offset, num_bytes, 0);
-    sqe.set_data64(fixed_fd_);
-    sqe.set_flags(IOSQE_FIXED_FILE);
+    sqe.prep_send(fixed_fd_, buffer_.data() + begin_, num_bytes, 0);
+    sqe.set_data64(key);
+    sqe.set_flags(IOSQE_FIXED_FILE | IOSQE_IO_LINK);
 
-    ring.submit();
-    return ConnectionFuture<ConnectionWriter>(this);
+    server->submit_linked_timeout(timeout);
+    return OperationFuture(key);
 }
 
 Task<std::optional<Error>> ConnectionWriter::flush() {
-    while (begin_ != end_) {
-        co_await submit_send();
+    std::size_t size = end_ - begin_;
 
-        IoUring &ring = Server::thread_instance()->ring();
+    if (sink_ && begin_ != end_) {
+        if (std::optional<Error> error = co_await sink_(buffered())) {
+            co_return error;
+        }
 
-        IoUringCqe cqe = ring.peek_cqe();
-        int res = cqe.res();
-        ring.seen_cqe(cqe);
+        begin_ = end_;
+    }
+
+    while (begin_ != end_) {
+        // Once the peer has been too slow, nothing more is sent to it, and
+        // the connection is closed after the current request.
+        std::chrono::nanoseconds timeout = get_send_timeout();
+
+        if (timed_out_ || timeout <= std::chrono::nanoseconds::zero()) {
+            trace::record(trace::Event::WRITE_TIMEOUT, fixed_fd_);
+            timed_out_ = true;
+            close_requested_ = true;
+            co_return Error::WRITE_TIMED_OUT;
+        }
+
+        trace::record(trace::Event::SEND_SUBMIT, fixed_fd_);
+        auto start = std::chrono::steady_clock::now();
+        i32 res = co_await submit_send(timeout);
+        send_time_ += std::chrono::steady_clock::now() - start;
+        trace::record(trace::Event::SEND_COMPLETE, fixed_fd_);
+
+        if (res == -ECANCELED) {
+            trace::record(trace::Event::WRITE_TIMEOUT, fixed_fd_);
+            timed_out_ = true;
+            close_requested_ = true;
+            co_return Error::WRITE_TIMED_OUT;
+        }
 
         if (res < 0) {
             fmt::print(stderr, "write error: {}\n", std::strerror(-res));
@@ -63,37 +135,62 @@ Task<std::optional<Error>> ConnectionWriter::flush() {
         }
 
         begin_ += res;
+        sent_size_ += res;
     }
 
-    begin_ = buffer_->begin();
-    end_ = begin_;
+    CO_HTTP_URING_PROBE2(flush, fixed_fd_, size);
+    begin_ = 0;
+    end_ = 0;
+    buffer_.release();
+    flush_count_++;
     co_return {};
 }
 
 Task<std::optional<Error>> ConnectionWriter::write(std::string_view str) {
-    while (static_cast<std::size_t>(buffer_->end() - end_) < str.size()) {
-        std::optional<Error> error = co_await flush();
+    while (!str.empty()) {
+        acquire_buffer();
+        std::size_t num_bytes = std::min(buffer_.size() - end_, str.size());
+        std::copy_n(str.cbegin(), num_bytes, buffer_.data() + end_);
+        end_ += num_bytes;
+        str.remove_prefix(num_bytes);
+
+        if (str.empty()) {
+            co_return {};
+        }
 
-        if (error) {
+        if (std::optional<Error> error = co_await flush()) {
             co_return *error;
         }
     }
 
-    end_ = std::copy(str.cbegin(), str.cend(), end_);
     co_return {};
 }
 
 Task<std::optional<Error>> ConnectionWriter::write_line(std::string_view line) {
     std::size_t line_real_size = line.size() + LINE_SEPARATOR.size();
+    acquire_buffer();
 
-    if (static_cast<std::size_t>(buffer_->end() - end_) < line_real_size) {
+    if (buffer_.size() - end_ < line_real_size) {
         if (std::optional<Error> error = co_await flush()) {
             co_return *error;
         }
+
+        acquire_buffer();
+    }
+
+    // Lines longer than a buffer are written piecewise.
+    if (buffer_.size() < line_real_size) {
+        if (std::optional<Error> error = co_await write(line)) {
+            co_return error;
+        }
+
+        co_return co_await write(LINE_SEPARATOR);
     }
 
-    auto line_end = std::copy(line.cbegin(), line.cend(), end_);
-    end_ = std::copy(LINE_SEPARATOR.cbegin(), LINE_SEPARATOR.cend(), line_end);
+    char *line_end = buffer_.data() + end_;
+    line_end = std::copy(line.cbegin(), line.cend(), line_end);
+    std::copy(LINE_SEPARATOR.cbegin(), LINE_SEPARATOR.cend(), line_end);
+    end_ += line_real_size;
     co_return {};
 }
 
@@ -0,0 +1,164 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/file.hpp"
+
+#include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/operation_future.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <variant>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/stat.h>
+}
+
+namespace co_http_uring {
+
+namespace {
+
+struct PreparedOperation {
+    IoUringSqe sqe;
+    i64 key;
+};
+
+PreparedOperation prepare_operation() {
+    Server *server = Server::thread_instance();
+    return {server->ring().get_sqe(), server->allocate_operation_key()};
+}
+
+OperationFuture submit_operation(PreparedOperation &op, unsigned int flags) {
+    op.sqe.set_flags(flags);
+    op.sqe.set_data64(op.key);
+    Server::thread_instance()->ring().submit();
+    return OperationFuture(op.key);
+}
+
+std::error_code make_error_code(i32 res) {
+    return {-res, std::generic_category()};
+}
+
+std::variant<std::size_t, std::error_code> make_size_result(i32 res) {
+    if (res < 0) {
+        return make_error_code(res);
+    }
+
+    return static_cast<std::size_t>(res);
+}
+
+std::optional<std::error_code> make_status_result(i32 res) {
+    if (res < 0) {
+        return make_error_code(res);
+    }
+
+    return std::nullopt;
+}
+
+} // namespace
+
+Task<std::variant<File, std::error_code>>
+File::open(std::string path, int flags, mode_t mode) {
+    // Direct descriptors are never inherited, and the kernel rejects
+    // O_CLOEXEC for them.
+    PreparedOperation op = prepare_operation();
+    op.sqe.prep_openat_direct(
+        AT_FDCWD,
+        path.c_str(),
+        flags & ~O_CLOEXEC,
+        mode,
+        IORING_FILE_INDEX_ALLOC
+    );
+
+    i32 res = co_await submit_operation(op, 0);
+
+    if (res < 0) {
+        co_return make_error_code(res);
+    }
+
+    co_return File(res);
+}
+
+Task<std::variant<struct statx, std::error_code>>
+File::stat(std::string path, unsigned int mask) {
+    struct statx statxbuf {};
+    PreparedOperation op = prepare_operation();
+    op.sqe.prep_statx(AT_FDCWD, path.c_str(), 0, mask, &statxbuf);
+
+    i32 res = co_await submit_operation(op, 0);
+
+    if (res < 0) {
+        co_return make_error_code(res);
+    }
+
+    co_return statxbuf;
+}
+
+Task<std::variant<std::size_t, std::error_code>>
+File::read(std::span<char> buffer, u64 offset) const {
+    PreparedOperation op = prepare_operation();
+    op.sqe.prep_read(fixed_fd_, buffer.data(), buffer.size(), offset);
+    co_return make_size_result(co_await submit_operation(op, IOSQE_FIXED_FILE));
+}
+
+Task<std::variant<std::size_t, std::error_code>>
+File::read_fixed(std::span<char> buffer, u64 offset, int buffer_index) const {
+    PreparedOperation op = prepare_operation();
+    op.sqe.prep_read_fixed(
+        fixed_fd_,
+        buffer.data(),
+        buffer.size(),
+        offset,
+        buffer_index
+    );
+
+    co_return make_size_result(co_await submit_operation(op, IOSQE_FIXED_FILE));
+}
+
+Task<std::variant<std::size_t, std::error_code>>
+File::write(std::span<const char> data, u64 offset) const {
+    PreparedOperation op = prepare_operation();
+    op.sqe.prep_write(fixed_fd_, data.data(), data.size(), offset);
+    co_return make_size_result(co_await submit_operation(op, IOSQE_FIXED_FILE));
+}
+
+Task<std::variant<std::size_t, std::error_code>> File::write_fixed(
+    std::span<const char> data,
+    u64 offset,
+    int buffer_index
+) const {
+    PreparedOperation op = prepare_operation();
+    op.sqe.prep_write_fixed(
+        fixed_fd_,
+        data.data(),
+        data.size(),
+        offset,
+        buffer_index
+    );
+
+    co_return make_size_result(co_await submit_operation(op, IOSQE_FIXED_FILE));
+}
+
+Task<std::optional<std::error_code>> File::fsync(bool data_only) const {
+    PreparedOperation op = prepare_operation();
+    op.sqe.prep_fsync(fixed_fd_, data_only ? IORING_FSYNC_DATASYNC : 0);
+    co_return make_status_result(
+        co_await submit_operation(op, IOSQE_FIXED_FILE)
+    );
+}
+
+Task<std::optional<std::error_code>> File::close() {
+    PreparedOperation op = prepare_operation();
+    op.sqe.prep_close_direct(fixed_fd_);
+    fixed_fd_ = -1;
+    co_return make_status_result(co_await submit_operation(op, 0));
+}
+
+} // namespace co_http_uring
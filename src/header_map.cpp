@@ -0,0 +1,185 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/header_map.hpp"
+
+#include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace co_http_uring {
+
+std::size_t HeaderMap::NameHash::operator()(std::string_view name) const {
+    return hash_header_name(name);
+}
+
+bool HeaderMap::NameEqual::operator()(std::string_view a, std::string_view b)
+    const {
+    return http_utils::equals_ignore_case(a, b);
+}
+
+const HeaderMap::Field *HeaderMap::find_field(std::string_view name) const {
+    u32 index;
+
+    if (std::optional<Header> header = find_header(name)) {
+        index = known_[static_cast<std::size_t>(*header)];
+    } else if (auto it = unknown_.find(name); it != unknown_.cend()) {
+        index = it->second;
+    } else {
+        index = 0;
+    }
+
+    return index == 0 ? nullptr : &fields_[index - 1];
+}
+
+void HeaderMap::add(std::string_view name, std::string_view value) {
+    u32 *index;
+
+    // Well-known names are neither lowercased nor hashed again.
+    if (std::optional<Header> header = find_header(name)) {
+        index = &known_[static_cast<std::size_t>(*header)];
+
+        if (*index == 0) {
+            fields_.emplace_back(header_name(*header), Values{});
+        }
+    } else if (auto it = unknown_.find(name); it != unknown_.end()) {
+        index = &it->second;
+    } else {
+        std::pmr::string field_name{name, resource()};
+        std::transform(
+            field_name.cbegin(),
+            field_name.cend(),
+            field_name.begin(),
+            [](unsigned char c) { return std::tolower(c); }
+        );
+        fields_.emplace_back(field_name, Values{});
+        index = &unknown_.emplace(std::move(field_name), 0).first->second;
+    }
+
+    if (*index == 0) {
+        *index = static_cast<u32>(fields_.size());
+    }
+
+    fields_[*index - 1].second.emplace_back(
+        http_utils::trim_header_value(value)
+    );
+}
+
+void HeaderMap::erase_field(u32 index) {
+    if (index == 0) {
+        return;
+    }
+
+    fields_.erase(fields_.begin() + index - 1);
+
+    // The fields after it move down by one.
+    for (u32 &other : known_) {
+        other -= other > index ? 1 : 0;
+    }
+
+    for (auto &[name, other] : unknown_) {
+        other -= other > index ? 1 : 0;
+    }
+}
+
+bool HeaderMap::contains_token(Header header, std::string_view token) const {
+    const Values *values = find(header);
+
+    if (values == nullptr) {
+        return false;
+    }
+
+    return std::any_of(
+        values->cbegin(),
+        values->cend(),
+        [token](std::string_view value) {
+            return http_utils::contains_token(value, token);
+        }
+    );
+}
+
+void HeaderMap::erase(Header header) {
+    erase_field(std::exchange(known_[static_cast<std::size_t>(header)], 0));
+}
+
+void HeaderMap::erase(std::string_view name) {
+    if (std::optional<Header> header = find_header(name)) {
+        erase(*header);
+        return;
+    }
+
+    auto it = unknown_.find(name);
+
+    if (it != unknown_.end()) {
+        u32 index = it->second;
+        unknown_.erase(it);
+        erase_field(index);
+    }
+}
+
+void HeaderMap::clear() {
+    fields_.clear();
+    known_.fill(0);
+    unknown_.clear();
+}
+
+bool parse_header_line(HeaderMap &headers, std::string_view line) {
+    auto header_name_end = std::find(line.cbegin(), line.cend(), ':');
+
+    if (header_name_end == line.cend()) {
+        return false;
+    }
+
+    std::string_view header_name{line.cbegin(), header_name_end};
+    std::string_view header_value{header_name_end + 1, line.cend()};
+
+    if (!http_utils::is_token(header_name) ||
+        !http_utils::is_field_value(header_value)) {
+        return false;
+    }
+
+    headers.add(header_name, header_value);
+    return true;
+}
+
+bool parse_content_length(const HeaderMap &headers, u64 &content_length) {
+    const HeaderMap::Values *values = headers.find(Header::CONTENT_LENGTH);
+
+    if (values == nullptr) {
+        return true;
+    }
+
+    const std::pmr::string &value = values->front();
+
+    if (!http_utils::is_number(value)) {
+        return false;
+    }
+
+    const char *value_first = value.cbegin().base();
+    const char *value_last = value.cend().base();
+    auto result = std::from_chars(value_first, value_last, content_length);
+
+    if (result.ptr != value_last || result.ec != std::errc{0}) {
+        return false;
+    }
+
+    return std::all_of(
+        values->cbegin() + 1,
+        values->cend(),
+        [&value](std::string_view other) { return other == value; }
+    );
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,532 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/hpack.hpp"
+
+#include "co_http_uring/types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace co_http_uring {
+
+namespace {
+
+using StaticEntry = std::pair<std::string_view, std::string_view>;
+
+constexpr std::array<StaticEntry, 61> STATIC_TABLE{{
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+}};
+
+// Each entry also accounts for 32 bytes of overhead (RFC 7541, section 4.1).
+constexpr std::size_t ENTRY_OVERHEAD = 32;
+
+// Fields that differ from one response to the next, or that should not sit
+// in a table shared by all of a connection's responses.
+constexpr std::array<std::string_view, 4> UNINDEXED_NAMES{
+    "content-length",
+    "etag",
+    "last-modified",
+    "set-cookie",
+};
+
+// The Huffman code of RFC 7541, appendix B, is canonical, so the lengths of
+// its codes determine the codes themselves.
+constexpr std::size_t NUM_SYMBOLS = 257;
+constexpr u16 EOS = 256;
+constexpr std::size_t MAX_CODE_LENGTH = 30;
+
+constexpr std::array<u8, NUM_SYMBOLS> HUFFMAN_CODE_LENGTHS{
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6,  10, 10, 12, 13, 6,  8,  11, 10, 10, 8,  11, 8,  6,  6,  6,
+    5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8,  15, 6,  12, 10,
+    13, 6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+    7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8,  13, 19, 13, 14, 6,
+    15, 5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,
+    6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7,  15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+struct HuffmanTables {
+    std::array<u32, NUM_SYMBOLS> codes{};
+    // Codes of each length are consecutive, starting at first_codes.
+    std::array<u32, MAX_CODE_LENGTH + 1> first_codes{};
+    std::array<u16, MAX_CODE_LENGTH + 1> counts{};
+    std::array<u16, MAX_CODE_LENGTH + 1> first_indices{};
+    // Symbols ordered by code.
+    std::array<u16, NUM_SYMBOLS> symbols{};
+};
+
+consteval HuffmanTables make_huffman_tables() {
+    HuffmanTables tables;
+
+    for (u8 length : HUFFMAN_CODE_LENGTHS) {
+        tables.counts[length]++;
+    }
+
+    u32 code = 0;
+    u16 index = 0;
+
+    for (std::size_t length = 1; length <= MAX_CODE_LENGTH; length++) {
+        code = (code + tables.counts[length - 1]) << 1;
+        tables.first_codes[length] = code;
+        tables.first_indices[length] = index;
+        index += tables.counts[length];
+    }
+
+    std::array<u32, MAX_CODE_LENGTH + 1> next_codes = tables.first_codes;
+    std::array<u16, MAX_CODE_LENGTH + 1> next_indices = tables.first_indices;
+
+    for (u16 symbol = 0; symbol < NUM_SYMBOLS; symbol++) {
+        u8 length = HUFFMAN_CODE_LENGTHS[symbol];
+        tables.codes[symbol] = next_codes[length]++;
+        tables.symbols[next_indices[length]++] = symbol;
+    }
+
+    return tables;
+}
+
+constexpr HuffmanTables HUFFMAN = make_huffman_tables();
+
+bool huffman_decode(std::string_view src, std::string &dst) {
+    u32 code = 0;
+    std::size_t length = 0;
+
+    for (unsigned char byte : src) {
+        for (int bit = 7; bit >= 0; bit--) {
+            code = (code << 1) | ((byte >> bit) & 1);
+            length++;
+            u32 offset = code - HUFFMAN.first_codes[length];
+
+            if (offset < HUFFMAN.counts[length]) {
+                u16 symbol =
+                    HUFFMAN.symbols[HUFFMAN.first_indices[length] + offset];
+
+                if (symbol == EOS) {
+                    return false;
+                }
+
+                dst.push_back(static_cast<char>(symbol));
+                code = 0;
+                length = 0;
+            } else if (length == MAX_CODE_LENGTH) {
+                return false;
+            }
+        }
+    }
+
+    // Padding is the most significant bits of EOS, all ones.
+    return length < 8 && code == (u32{1} << length) - 1;
+}
+
+std::size_t huffman_encoded_size(std::string_view src) {
+    std::size_t num_bits = 0;
+
+    for (unsigned char c : src) {
+        num_bits += HUFFMAN_CODE_LENGTHS[c];
+    }
+
+    return (num_bits + 7) / 8;
+}
+
+void huffman_encode(std::string_view src, std::string &dst) {
+    u64 bits = 0;
+    std::size_t num_bits = 0;
+
+    for (unsigned char c : src) {
+        bits = (bits << HUFFMAN_CODE_LENGTHS[c]) | HUFFMAN.codes[c];
+        num_bits += HUFFMAN_CODE_LENGTHS[c];
+
+        while (num_bits >= 8) {
+            num_bits -= 8;
+            dst.push_back(static_cast<char>(bits >> num_bits));
+        }
+    }
+
+    if (num_bits > 0) {
+        dst.push_back(
+            static_cast<char>((bits << (8 - num_bits)) | (0xff >> num_bits))
+        );
+    }
+}
+
+void encode_integer(
+    u64 value,
+    unsigned int prefix_bits,
+    u8 flags,
+    std::string &dst
+) {
+    u64 max_prefix = (u64{1} << prefix_bits) - 1;
+
+    if (value < max_prefix) {
+        dst.push_back(static_cast<char>(flags | value));
+        return;
+    }
+
+    dst.push_back(static_cast<char>(flags | max_prefix));
+    value -= max_prefix;
+
+    while (value >= 128) {
+        dst.push_back(static_cast<char>(value % 128 + 128));
+        value /= 128;
+    }
+
+    dst.push_back(static_cast<char>(value));
+}
+
+std::optional<u64>
+decode_integer(std::string_view &src, unsigned int prefix_bits) {
+    if (src.empty()) {
+        return {};
+    }
+
+    u64 max_prefix = (u64{1} << prefix_bits) - 1;
+    u64 value = static_cast<u8>(src[0]) & max_prefix;
+    src.remove_prefix(1);
+
+    if (value < max_prefix) {
+        return value;
+    }
+
+    // Larger values than a few continuation bytes encode are of no use to
+    // anyone, and could overflow.
+    for (unsigned int shift = 0; shift <= 28 && !src.empty(); shift += 7) {
+        auto byte = static_cast<u8>(src[0]);
+        src.remove_prefix(1);
+        value += static_cast<u64>(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+
+    return {};
+}
+
+void encode_string(std::string_view str, std::string &dst) {
+    std::size_t huffman_size = huffman_encoded_size(str);
+
+    if (huffman_size < str.size()) {
+        encode_integer(huffman_size, 7, 0x80, dst);
+        huffman_encode(str, dst);
+    } else {
+        encode_integer(str.size(), 7, 0, dst);
+        dst += str;
+    }
+}
+
+std::optional<std::string> decode_string(std::string_view &src) {
+    if (src.empty()) {
+        return {};
+    }
+
+    bool huffman = (src[0] & 0x80) != 0;
+    std::optional<u64> size = decode_integer(src, 7);
+
+    if (!size || *size > src.size()) {
+        return {};
+    }
+
+    std::string_view data = src.substr(0, *size);
+    src.remove_prefix(*size);
+
+    if (!huffman) {
+        return std::string{data};
+    }
+
+    std::string str;
+    str.reserve(data.size() * 8 / 5);
+
+    if (!huffman_decode(data, str)) {
+        return {};
+    }
+
+    return str;
+}
+
+} // namespace
+
+void HpackTable::evict(std::size_t max_size) {
+    while (size_ > max_size) {
+        const auto &[name, value] = entries_.back();
+        size_ -= name.size() + value.size() + ENTRY_OVERHEAD;
+        entries_.pop_back();
+    }
+}
+
+void HpackTable::set_max_size(std::size_t max_size) {
+    max_size_ = max_size;
+    evict(max_size_);
+}
+
+void HpackTable::insert(std::string_view name, std::string_view value) {
+    std::size_t size = name.size() + value.size() + ENTRY_OVERHEAD;
+
+    // An entry larger than the table empties it (RFC 7541, section 4.4).
+    if (size > max_size_) {
+        entries_.clear();
+        size_ = 0;
+        return;
+    }
+
+    evict(max_size_ - size);
+    entries_.emplace_front(name, value);
+    size_ += size;
+}
+
+std::optional<std::pair<std::string_view, std::string_view>>
+HpackTable::get(std::size_t index) const {
+    if (index == 0) {
+        return {};
+    }
+
+    if (index <= STATIC_TABLE.size()) {
+        return STATIC_TABLE[index - 1];
+    }
+
+    index -= STATIC_TABLE.size() + 1;
+
+    if (index >= entries_.size()) {
+        return {};
+    }
+
+    return entries_[index];
+}
+
+i64 HpackTable::find(std::string_view name, std::string_view value) const {
+    i64 name_index = 0;
+
+    for (std::size_t i = 0; i < STATIC_TABLE.size(); i++) {
+        if (STATIC_TABLE[i].first != name) {
+            continue;
+        }
+
+        if (STATIC_TABLE[i].second == value) {
+            return static_cast<i64>(i + 1);
+        }
+
+        name_index = name_index != 0 ? name_index : static_cast<i64>(i + 1);
+    }
+
+    for (std::size_t i = 0; i < entries_.size(); i++) {
+        if (entries_[i].first != name) {
+            continue;
+        }
+
+        auto index = static_cast<i64>(STATIC_TABLE.size() + 1 + i);
+
+        if (entries_[i].second == value) {
+            return index;
+        }
+
+        name_index = name_index != 0 ? name_index : index;
+    }
+
+    return -name_index;
+}
+
+bool HpackDecoder::decode(
+    std::string_view block,
+    HeaderList &fields,
+    std::size_t max_list_size
+) {
+    bool fields_decoded = false;
+    std::size_t list_size = 0;
+
+    // Checked before a field is copied out, as a few bytes of indexed fields
+    // can reference a large table entry over and over.
+    auto fits = [&list_size, max_list_size](
+                    std::string_view name,
+                    std::string_view value
+                ) {
+        list_size += name.size() + value.size() + ENTRY_OVERHEAD;
+        return list_size <= max_list_size;
+    };
+
+    while (!block.empty()) {
+        auto first_byte = static_cast<u8>(block[0]);
+
+        // Indexed field.
+        if (first_byte & 0x80) {
+            std::optional<u64> index = decode_integer(block, 7);
+            std::optional<std::pair<std::string_view, std::string_view>> entry;
+
+            if (!index || !(entry = table_.get(*index)) ||
+                !fits(entry->first, entry->second)) {
+                return false;
+            }
+
+            fields.emplace_back(entry->first, entry->second);
+            fields_decoded = true;
+            continue;
+        }
+
+        // Dynamic table size update, only allowed before the first field.
+        if ((first_byte & 0xe0) == 0x20) {
+            std::optional<u64> size = decode_integer(block, 5);
+
+            if (fields_decoded || !size || *size > max_table_size_) {
+                return false;
+            }
+
+            table_.set_max_size(*size);
+            continue;
+        }
+
+        // Literal field, with incremental indexing or without (and maybe
+        // never) indexing.
+        bool indexing = (first_byte & 0x40) != 0;
+        std::optional<u64> index = decode_integer(block, indexing ? 6 : 4);
+
+        if (!index) {
+            return false;
+        }
+
+        std::optional<std::string> name;
+
+        if (*index == 0) {
+            name = decode_string(block);
+        } else if (auto entry = table_.get(*index)) {
+            name = std::string{entry->first};
+        }
+
+        std::optional<std::string> value;
+
+        if (!name || !(value = decode_string(block)) || !fits(*name, *value)) {
+            return false;
+        }
+
+        if (indexing) {
+            table_.insert(*name, *value);
+        }
+
+        fields.emplace_back(std::move(*name), std::move(*value));
+        fields_decoded = true;
+    }
+
+    return true;
+}
+
+void HpackEncoder::set_max_table_size(std::size_t max_table_size) {
+    // A larger table than the default is not worth its memory.
+    max_table_size = std::min(max_table_size, HpackTable::DEFAULT_MAX_SIZE);
+
+    if (max_table_size != table_.max_size()) {
+        table_.set_max_size(max_table_size);
+        pending_size_update_ = max_table_size;
+    }
+}
+
+void HpackEncoder::encode(const HeaderList &fields, std::string &block) {
+    if (pending_size_update_) {
+        encode_integer(*pending_size_update_, 5, 0x20, block);
+        pending_size_update_.reset();
+    }
+
+    for (const auto &[name, value] : fields) {
+        i64 index = table_.find(name, value);
+
+        if (index > 0) {
+            encode_integer(index, 7, 0x80, block);
+            continue;
+        }
+
+        bool indexing = std::find(
+                            UNINDEXED_NAMES.cbegin(),
+                            UNINDEXED_NAMES.cend(),
+                            name
+                        ) == UNINDEXED_NAMES.cend();
+
+        if (indexing) {
+            encode_integer(-index, 6, 0x40, block);
+        } else {
+            encode_integer(-index, 4, 0, block);
+        }
+
+        if (index == 0) {
+            encode_string(name, block);
+        }
+
+        encode_string(value, block);
+
+        if (indexing) {
+            table_.insert(name, value);
+        }
+    }
+}
+
+} // namespace co_http_uring
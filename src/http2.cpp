@@ -0,0 +1,1266 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/http2.hpp"
+
+#include "co_http_uring/compression.hpp"
+#include "co_http_uring/connection_reader.hpp"
+#include "co_http_uring/connection_writer.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/header_map.hpp"
+#include "co_http_uring/headers.hpp"
+#include "co_http_uring/hpack.hpp"
+#include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/probes.hpp"
+#include "co_http_uring/request.hpp"
+#include "co_http_uring/response_writer.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/status_code.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace co_http_uring {
+
+namespace {
+
+enum class FrameType : u8 {
+    DATA = 0x0,
+    HEADERS = 0x1,
+    PRIORITY = 0x2,
+    RST_STREAM = 0x3,
+    SETTINGS = 0x4,
+    PUSH_PROMISE = 0x5,
+    PING = 0x6,
+    GOAWAY = 0x7,
+    WINDOW_UPDATE = 0x8,
+    CONTINUATION = 0x9,
+};
+
+constexpr u8 FLAG_END_STREAM = 0x1;
+constexpr u8 FLAG_ACK = 0x1;
+constexpr u8 FLAG_END_HEADERS = 0x4;
+constexpr u8 FLAG_PADDED = 0x8;
+constexpr u8 FLAG_PRIORITY = 0x20;
+
+enum class Setting : u16 {
+    HEADER_TABLE_SIZE = 0x1,
+    ENABLE_PUSH = 0x2,
+    MAX_CONCURRENT_STREAMS = 0x3,
+    INITIAL_WINDOW_SIZE = 0x4,
+    MAX_FRAME_SIZE = 0x5,
+    MAX_HEADER_LIST_SIZE = 0x6,
+};
+
+constexpr std::string_view CLIENT_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+constexpr std::string_view SWITCHING_PROTOCOLS_RESPONSE =
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Connection: Upgrade\r\n"
+    "Upgrade: h2c\r\n"
+    "\r\n";
+
+constexpr std::string_view H2C = "h2c";
+
+constexpr std::size_t FRAME_HEADER_SIZE = 9;
+constexpr std::size_t SETTING_SIZE = 6;
+constexpr u32 DEFAULT_MAX_FRAME_SIZE = 16384;
+constexpr u32 MAX_MAX_FRAME_SIZE = (1 << 24) - 1;
+constexpr u32 DEFAULT_WINDOW_SIZE = 65535;
+constexpr i64 MAX_WINDOW_SIZE = 0x7fffffff;
+constexpr u32 MAX_CONCURRENT_STREAMS = 100;
+
+// The connection's receive window is replenished as DATA arrives, since each
+// stream's own window already bounds what is buffered for it.
+constexpr u32 CONNECTION_WINDOW_SIZE = 1024 * 1024;
+
+constexpr std::array<std::string_view, 5> CONNECTION_SPECIFIC_HEADERS{
+    headers::CONNECTION,
+    headers::KEEP_ALIVE,
+    headers::PROXY_CONNECTION,
+    headers::TRANSFER_ENCODING,
+    headers::UPGRADE,
+};
+
+struct Wait {
+    std::coroutine_handle<> &waiter;
+
+    [[nodiscard]] bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> coroutine) const {
+        waiter = coroutine;
+    }
+
+    void await_resume() const {}
+};
+
+u32 read_u32(std::string_view src) {
+    return static_cast<u32>(static_cast<u8>(src[0])) << 24 |
+        static_cast<u32>(static_cast<u8>(src[1])) << 16 |
+        static_cast<u32>(static_cast<u8>(src[2])) << 8 |
+        static_cast<u32>(static_cast<u8>(src[3]));
+}
+
+void append_u32(std::string &dst, u32 value) {
+    dst.push_back(static_cast<char>(value >> 24));
+    dst.push_back(static_cast<char>(value >> 16));
+    dst.push_back(static_cast<char>(value >> 8));
+    dst.push_back(static_cast<char>(value));
+}
+
+void append_setting(std::string &dst, Setting setting, u32 value) {
+    dst.push_back(static_cast<char>(static_cast<u16>(setting) >> 8));
+    dst.push_back(static_cast<char>(setting));
+    append_u32(dst, value);
+}
+
+bool is_connection_specific_header(std::string_view name) {
+    return std::find(
+               CONNECTION_SPECIFIC_HEADERS.cbegin(),
+               CONNECTION_SPECIFIC_HEADERS.cend(),
+               name
+           ) != CONNECTION_SPECIFIC_HEADERS.cend();
+}
+
+// Strips the padding of a DATA or HEADERS frame, if it has any.
+bool remove_padding(u8 flags, std::string_view &payload) {
+    if ((flags & FLAG_PADDED) == 0) {
+        return true;
+    }
+
+    if (payload.empty()) {
+        return false;
+    }
+
+    auto padding_size = static_cast<u8>(payload[0]);
+    payload.remove_prefix(1);
+
+    if (padding_size > payload.size()) {
+        return false;
+    }
+
+    payload.remove_suffix(padding_size);
+    return true;
+}
+
+std::optional<std::string> decode_base64url(std::string_view src) {
+    while (src.ends_with('=')) {
+        src.remove_suffix(1);
+    }
+
+    std::string dst;
+    u32 bits = 0;
+    int num_bits = 0;
+
+    for (char c : src) {
+        u32 value;
+
+        if (c >= 'A' && c <= 'Z') {
+            value = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            value = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            value = c - '0' + 52;
+        } else if (c == '-') {
+            value = 62;
+        } else if (c == '_') {
+            value = 63;
+        } else {
+            return {};
+        }
+
+        bits = (bits << 6) | value;
+        num_bits += 6;
+
+        if (num_bits >= 8) {
+            num_bits -= 8;
+            dst.push_back(static_cast<char>(bits >> num_bits));
+            bits &= (u32{1} << num_bits) - 1;
+        }
+    }
+
+    return dst;
+}
+
+} // namespace
+
+struct Http2Connection::WriteLock {
+    Http2Connection *connection;
+
+    [[nodiscard]] bool await_ready() const {
+        if (connection->writing_) {
+            return false;
+        }
+
+        connection->writing_ = true;
+        return true;
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine) const {
+        connection->write_waiters_.push_back(coroutine);
+    }
+
+    void await_resume() const {}
+};
+
+Http2Stream::Http2Stream(Http2Connection &connection, u32 id, i64 send_window) :
+    connection_{&connection},
+    id_{id},
+    body_{[this] { return receive(); }},
+    writer_{[this](std::string_view data) {
+        return connection_->send_data(*this, data, false);
+    }},
+    receive_window_{DEFAULT_WINDOW_SIZE},
+    send_window_{send_window} {
+}
+
+void Http2Stream::wake() {
+    if (waiter_) {
+        Server::thread_instance()->schedule(std::exchange(waiter_, nullptr));
+    }
+}
+
+Task<std::optional<Error>> Http2Stream::receive() {
+    while (received_.empty()) {
+        if (reset_ || connection_->input_closed_) {
+            co_return Error::READ_ERROR;
+        }
+
+        if (end_stream_received_) {
+            co_return Error::CONNECTION_CLOSED;
+        }
+
+        co_await Wait{waiter_};
+    }
+
+    std::size_t size = body_.feed(received_);
+    received_.erase(0, size);
+    consumed_size_ += size;
+    co_await connection_->update_receive_window(*this);
+    co_return {};
+}
+
+void Http2Stream::add_header(std::string_view name, std::string_view value) {
+    std::string header_name = http_utils::make_header_name(name);
+
+    if (!is_connection_specific_header(header_name)) {
+        headers_.emplace_back(std::move(header_name), value);
+    }
+}
+
+Http2Connection::Http2Connection(
+    ConnectionReader &reader,
+    ConnectionWriter &writer,
+    const RequestHandler &handler,
+    std::optional<CompressionOptions> compression,
+    std::size_t max_header_list_size
+) :
+    reader_{&reader},
+    writer_{&writer},
+    handler_{&handler},
+    compression_{compression},
+    max_header_list_size_{max_header_list_size},
+    peer_initial_window_size_{DEFAULT_WINDOW_SIZE},
+    peer_max_frame_size_{DEFAULT_MAX_FRAME_SIZE},
+    send_window_{DEFAULT_WINDOW_SIZE},
+    receive_window_{DEFAULT_WINDOW_SIZE} {
+    reader_->set_max_buffer_size(std::max<std::size_t>(
+        reader_->max_buffer_size(),
+        FRAME_HEADER_SIZE + DEFAULT_MAX_FRAME_SIZE
+    ));
+}
+
+Http2Connection::WriteLock Http2Connection::lock_writer() {
+    return {this};
+}
+
+Task<std::optional<Error>> Http2Connection::unlock_writer() {
+    std::optional<Error> error;
+
+    if (write_waiters_.empty() && !output_failed_ &&
+        (error = co_await writer_->flush())) {
+        output_failed_ = true;
+        wake_streams();
+    }
+
+    if (write_waiters_.empty()) {
+        writing_ = false;
+    } else {
+        Server::thread_instance()->schedule(write_waiters_.front());
+        write_waiters_.pop_front();
+    }
+
+    co_return error;
+}
+
+Task<std::optional<Error>> Http2Connection::write_frame(
+    u8 type,
+    u8 flags,
+    u32 stream_id,
+    std::string_view payload
+) {
+    if (output_failed_) {
+        co_return Error::WRITE_ERROR;
+    }
+
+    std::array<char, FRAME_HEADER_SIZE> header{
+        static_cast<char>(payload.size() >> 16),
+        static_cast<char>(payload.size() >> 8),
+        static_cast<char>(payload.size()),
+        static_cast<char>(type),
+        static_cast<char>(flags),
+        static_cast<char>(stream_id >> 24),
+        static_cast<char>(stream_id >> 16),
+        static_cast<char>(stream_id >> 8),
+        static_cast<char>(stream_id),
+    };
+
+    std::optional<Error> error =
+        co_await writer_->write({header.data(), header.size()});
+
+    if (error || (error = co_await writer_->write(payload))) {
+        output_failed_ = true;
+        wake_streams();
+    }
+
+    co_return error;
+}
+
+Task<std::optional<Error>> Http2Connection::send_frame(
+    u8 type,
+    u8 flags,
+    u32 stream_id,
+    std::string_view payload
+) {
+    co_await lock_writer();
+    std::optional<Error> error =
+        co_await write_frame(type, flags, stream_id, payload);
+    std::optional<Error> unlock_error = co_await unlock_writer();
+
+    if (error) {
+        co_return error;
+    }
+
+    co_return unlock_error;
+}
+
+Task<std::optional<Error>> Http2Connection::write_preface() {
+    std::string settings;
+    append_setting(
+        settings,
+        Setting::MAX_CONCURRENT_STREAMS,
+        MAX_CONCURRENT_STREAMS
+    );
+    append_setting(
+        settings,
+        Setting::MAX_HEADER_LIST_SIZE,
+        static_cast<u32>(std::min<std::size_t>(max_header_list_size_, ~u32{}))
+    );
+
+    std::string window_update;
+    append_u32(window_update, CONNECTION_WINDOW_SIZE - DEFAULT_WINDOW_SIZE);
+    receive_window_ = CONNECTION_WINDOW_SIZE;
+
+    std::optional<Error> error = co_await write_frame(
+        static_cast<u8>(FrameType::SETTINGS),
+        0,
+        0,
+        settings
+    );
+
+    if (!error) {
+        error = co_await write_frame(
+            static_cast<u8>(FrameType::WINDOW_UPDATE),
+            0,
+            0,
+            window_update
+        );
+    }
+
+    co_return error;
+}
+
+Task<std::optional<Error>>
+Http2Connection::write_headers(Http2Stream &stream, bool end_stream) {
+    HeaderList fields;
+    fields.reserve(stream.headers_.size() + 1);
+    fields.emplace_back(
+        ":status",
+        std::to_string(static_cast<int>(*stream.status_))
+    );
+    std::move(
+        stream.headers_.begin(),
+        stream.headers_.end(),
+        std::back_inserter(fields)
+    );
+    stream.headers_.clear();
+
+    // Encoded under the lock, as the peer decodes blocks in the order they
+    // are sent.
+    std::string block;
+    encoder_.encode(fields, block);
+
+    std::string_view remaining = block;
+    auto type = static_cast<u8>(FrameType::HEADERS);
+    u8 flags = end_stream ? FLAG_END_STREAM : 0;
+
+    while (true) {
+        std::string_view fragment = remaining.substr(0, peer_max_frame_size_);
+        remaining.remove_prefix(fragment.size());
+
+        if (remaining.empty()) {
+            flags |= FLAG_END_HEADERS;
+        }
+
+        std::optional<Error> error =
+            co_await write_frame(type, flags, stream.id_, fragment);
+
+        if (error || remaining.empty()) {
+            stream.headers_sent_ = true;
+            stream.end_stream_sent_ = end_stream;
+            co_return error;
+        }
+
+        type = static_cast<u8>(FrameType::CONTINUATION);
+        flags = 0;
+    }
+}
+
+Task<std::optional<Error>> Http2Connection::send_data(
+    Http2Stream &stream,
+    std::string_view data,
+    bool end_stream
+) {
+    while (true) {
+        if (stream.reset_ || output_failed_) {
+            co_return Error::WRITE_ERROR;
+        }
+
+        if (!data.empty() && (send_window_ <= 0 || stream.send_window_ <= 0)) {
+            // No WINDOW_UPDATE can arrive any more.
+            if (input_closed_) {
+                co_return Error::WRITE_ERROR;
+            }
+
+            co_await Wait{stream.waiter_};
+            continue;
+        }
+
+        co_await lock_writer();
+        std::optional<Error> error;
+
+        if (stream.reset_) {
+            error = Error::WRITE_ERROR;
+        } else if (!stream.headers_sent_) {
+            error = co_await write_headers(stream, end_stream && data.empty());
+        }
+
+        while (!error && !data.empty()) {
+            i64 size = std::min<i64>({
+                static_cast<i64>(data.size()),
+                send_window_,
+                stream.send_window_,
+                peer_max_frame_size_,
+            });
+
+            if (size <= 0) {
+                break;
+            }
+
+            bool last = end_stream && static_cast<std::size_t>(size) ==
+                data.size();
+            error = co_await write_frame(
+                static_cast<u8>(FrameType::DATA),
+                last ? FLAG_END_STREAM : 0,
+                stream.id_,
+                data.substr(0, size)
+            );
+            send_window_ -= size;
+            stream.send_window_ -= size;
+            stream.end_stream_sent_ = last;
+            data.remove_prefix(size);
+        }
+
+        if (!error && data.empty() && end_stream && !stream.end_stream_sent_) {
+            error = co_await write_frame(
+                static_cast<u8>(FrameType::DATA),
+                FLAG_END_STREAM,
+                stream.id_,
+                {}
+            );
+            stream.end_stream_sent_ = true;
+        }
+
+        std::optional<Error> unlock_error = co_await unlock_writer();
+
+        if (error) {
+            co_return error;
+        }
+
+        if (unlock_error) {
+            co_return unlock_error;
+        }
+
+        if (data.empty()) {
+            co_return {};
+        }
+    }
+}
+
+Task<> Http2Connection::send_window_update(u32 stream_id, u32 increment) {
+    std::string payload;
+    append_u32(payload, increment);
+    co_await send_frame(
+        static_cast<u8>(FrameType::WINDOW_UPDATE),
+        0,
+        stream_id,
+        payload
+    );
+}
+
+Task<> Http2Connection::send_rst_stream(u32 stream_id, Http2ErrorCode code) {
+    std::string payload;
+    append_u32(payload, static_cast<u32>(code));
+    co_await send_frame(
+        static_cast<u8>(FrameType::RST_STREAM),
+        0,
+        stream_id,
+        payload
+    );
+}
+
+Task<> Http2Connection::send_goaway(Http2ErrorCode code) {
+    std::string payload;
+    append_u32(payload, last_stream_id_);
+    append_u32(payload, static_cast<u32>(code));
+    co_await send_frame(static_cast<u8>(FrameType::GOAWAY), 0, 0, payload);
+}
+
+Task<> Http2Connection::update_receive_window(Http2Stream &stream) {
+    if (stream.consumed_size_ < DEFAULT_WINDOW_SIZE / 2 ||
+        stream.end_stream_received_ || stream.reset_) {
+        co_return;
+    }
+
+    u32 increment = std::exchange(stream.consumed_size_, 0);
+    stream.receive_window_ += increment;
+    co_await send_window_update(stream.id_, increment);
+}
+
+void Http2Connection::wake_streams() {
+    for (auto &[id, stream] : streams_) {
+        stream->wake();
+    }
+}
+
+Task<> Http2Connection::reset_stream(Http2Stream &stream, Http2ErrorCode code) {
+    u32 id = stream.id_;
+    stream.reset_ = true;
+    stream.wake();
+
+    if (!stream.started_) {
+        streams_.erase(id);
+    }
+
+    co_await send_rst_stream(id, code);
+}
+
+bool Http2Connection::make_request(Http2Stream &stream, HeaderList &&fields) {
+    Request &request = stream.request_;
+    std::pmr::string scheme;
+    std::pmr::string authority;
+    bool regular_fields = false;
+
+    for (auto &[name, value] : fields) {
+        if (name.starts_with(':')) {
+            std::pmr::string *pseudo_header = nullptr;
+
+            if (name == ":method") {
+                pseudo_header = &request.method_;
+            } else if (name == ":path") {
+                pseudo_header = &request.target_;
+            } else if (name == ":scheme") {
+                pseudo_header = &scheme;
+            } else if (name == ":authority") {
+                pseudo_header = &authority;
+            }
+
+            // Pseudo-header fields come first, once each.
+            if (regular_fields || pseudo_header == nullptr ||
+                !pseudo_header->empty() || value.empty()) {
+                return false;
+            }
+
+            *pseudo_header = std::move(value);
+            continue;
+        }
+
+        regular_fields = true;
+        bool lowercase = std::none_of(name.cbegin(), name.cend(), [](char c) {
+            return c >= 'A' && c <= 'Z';
+        });
+
+        if (!lowercase || !http_utils::is_token(name) ||
+            !http_utils::is_field_value(value) ||
+            is_connection_specific_header(name) ||
+            (name == headers::TE && value != "trailers")) {
+            return false;
+        }
+
+        request.headers_.add(name, value);
+    }
+
+    if (request.method_.empty() || request.target_.empty() || scheme.empty() ||
+        !http_utils::is_token(request.method_) ||
+        !parse_content_length(request.headers_, request.content_length_)) {
+        return false;
+    }
+
+    if (!authority.empty() && !request.contains_header(Header::HOST)) {
+        request.headers_.add(headers::HOST, authority);
+    }
+
+    if (auto accept_encoding = request.get_header(Header::ACCEPT_ENCODING)) {
+        request.accepted_encoding_ =
+            negotiate_content_encoding(*accept_encoding);
+    }
+
+    request.http_version_ = {2, 0};
+    request.keep_alive_ = true;
+    request.body_ = &stream.body_;
+    stream.body_.set_bytes_remaining(request.content_length_);
+    return true;
+}
+
+void Http2Connection::start_stream(Http2Stream &stream) {
+    stream.started_ = true;
+    running_streams_++;
+    run_stream(stream).detach();
+}
+
+Task<> Http2Connection::run_stream(Http2Stream &stream) {
+    const Request &req = stream.request_;
+    CO_HTTP_URING_PROBE5(
+        request,
+        reader_->fixed_fd(),
+        req.method().data(),
+        req.method().size(),
+        req.target().data(),
+        req.target().size()
+    );
+    ResponseWriter res{stream};
+
+    if (compression_) {
+        res.set_compression(req.accepted_encoding(), *compression_);
+    }
+
+    bool handler_threw = false;
+    CO_HTTP_URING_PROBE1(handler_start, reader_->fixed_fd());
+
+    try {
+        co_await (*handler_)(req, std::move(res));
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "request handler threw: {}\n", e.what());
+        handler_threw = true;
+    }
+
+    CO_HTTP_URING_PROBE1(handler_end, reader_->fixed_fd());
+
+    if (!stream.reset_ && (handler_threw || !stream.status_)) {
+        co_await send_rst_stream(stream.id_, Http2ErrorCode::INTERNAL_ERROR);
+    } else if (!stream.reset_) {
+        std::optional<Error> error =
+            co_await send_data(stream, stream.writer_.buffered(), true);
+        stream.writer_.clear();
+
+        // The response is complete, so the rest of the body is not needed.
+        if (!error && !stream.end_stream_received_) {
+            co_await send_rst_stream(stream.id_, Http2ErrorCode::NO_ERROR);
+        }
+    }
+
+    streams_.erase(stream.id_);
+
+    if (--running_streams_ == 0 && closing_waiter_) {
+        Server::thread_instance()->schedule(
+            std::exchange(closing_waiter_, nullptr)
+        );
+    }
+}
+
+std::optional<Http2ErrorCode>
+Http2Connection::apply_settings(std::string_view payload) {
+    for (; !payload.empty(); payload.remove_prefix(SETTING_SIZE)) {
+        auto setting = static_cast<Setting>(
+            static_cast<u8>(payload[0]) << 8 | static_cast<u8>(payload[1])
+        );
+        u32 value = read_u32(payload.substr(2));
+
+        switch (setting) {
+        case Setting::HEADER_TABLE_SIZE:
+            encoder_.set_max_table_size(value);
+            break;
+        case Setting::ENABLE_PUSH:
+            if (value > 1) {
+                return Http2ErrorCode::PROTOCOL_ERROR;
+            }
+
+            break;
+        case Setting::INITIAL_WINDOW_SIZE: {
+            if (value > MAX_WINDOW_SIZE) {
+                return Http2ErrorCode::FLOW_CONTROL_ERROR;
+            }
+
+            i64 delta = static_cast<i64>(value) - peer_initial_window_size_;
+            peer_initial_window_size_ = value;
+
+            for (auto &[id, stream] : streams_) {
+                stream->send_window_ += delta;
+                stream->wake();
+            }
+
+            break;
+        }
+        case Setting::MAX_FRAME_SIZE:
+            if (value < DEFAULT_MAX_FRAME_SIZE || value > MAX_MAX_FRAME_SIZE) {
+                return Http2ErrorCode::PROTOCOL_ERROR;
+            }
+
+            peer_max_frame_size_ = value;
+            break;
+        default: break;
+        }
+    }
+
+    return {};
+}
+
+Task<std::optional<Http2ErrorCode>>
+Http2Connection::handle_data(const Frame &frame, std::string_view payload) {
+    if (frame.stream_id == 0 || frame.length > receive_window_) {
+        co_return frame.stream_id == 0 ? Http2ErrorCode::PROTOCOL_ERROR
+                                       : Http2ErrorCode::FLOW_CONTROL_ERROR;
+    }
+
+    receive_window_ -= frame.length;
+
+    if (receive_window_ <= CONNECTION_WINDOW_SIZE / 2) {
+        auto increment = static_cast<u32>(
+            CONNECTION_WINDOW_SIZE - receive_window_
+        );
+        receive_window_ += increment;
+        co_await send_window_update(0, increment);
+    }
+
+    if (!remove_padding(frame.flags, payload)) {
+        co_return Http2ErrorCode::PROTOCOL_ERROR;
+    }
+
+    auto it = streams_.find(frame.stream_id);
+
+    // Frames of streams that were closed or reset may still be in flight.
+    if (it == streams_.end()) {
+        if (frame.stream_id > last_stream_id_) {
+            co_return Http2ErrorCode::PROTOCOL_ERROR;
+        }
+
+        co_return {};
+    }
+
+    Http2Stream &stream = *it->second;
+
+    if (stream.reset_) {
+        co_return {};
+    }
+
+    if (stream.end_stream_received_) {
+        co_await reset_stream(stream, Http2ErrorCode::STREAM_CLOSED);
+        co_return {};
+    }
+
+    if (frame.length > stream.receive_window_) {
+        co_await reset_stream(stream, Http2ErrorCode::FLOW_CONTROL_ERROR);
+        co_return {};
+    }
+
+    stream.receive_window_ -= frame.length;
+    stream.received_ += payload;
+    stream.received_size_ += payload.size();
+    // Padding is never read, so it is given back along with what is.
+    stream.consumed_size_ += frame.length - payload.size();
+    stream.end_stream_received_ = (frame.flags & FLAG_END_STREAM) != 0;
+
+    const Request &request = stream.request_;
+    bool has_content_length = request.contains_header(Header::CONTENT_LENGTH);
+
+    if (has_content_length &&
+        (stream.received_size_ > request.content_length() ||
+         (stream.end_stream_received_ &&
+          stream.received_size_ != request.content_length()))) {
+        co_await reset_stream(stream, Http2ErrorCode::PROTOCOL_ERROR);
+        co_return {};
+    }
+
+    if (stream.started_) {
+        stream.wake();
+        co_return {};
+    }
+
+    // The body is buffered whole before the handler starts.
+    if (stream.received_size_ > max_header_list_size_) {
+        co_await reset_stream(stream, Http2ErrorCode::CANCEL);
+        co_return {};
+    }
+
+    if (stream.end_stream_received_) {
+        stream.request_.content_length_ = stream.received_size_;
+        stream.body_.set_bytes_remaining(stream.received_size_);
+        start_stream(stream);
+        co_return {};
+    }
+
+    stream.consumed_size_ += payload.size();
+    co_await update_receive_window(stream);
+    co_return {};
+}
+
+Task<std::optional<Http2ErrorCode>>
+Http2Connection::handle_headers(const Frame &frame, std::string_view payload) {
+    if (frame.stream_id == 0 || frame.stream_id % 2 == 0 ||
+        !remove_padding(frame.flags, payload)) {
+        co_return Http2ErrorCode::PROTOCOL_ERROR;
+    }
+
+    // Priorities are ignored.
+    if (frame.flags & FLAG_PRIORITY) {
+        if (payload.size() < 5) {
+            co_return Http2ErrorCode::FRAME_SIZE_ERROR;
+        }
+
+        payload.remove_prefix(5);
+    }
+
+    header_block_ = payload;
+    header_block_stream_id_ = frame.stream_id;
+    header_block_end_stream_ = (frame.flags & FLAG_END_STREAM) != 0;
+
+    if (frame.flags & FLAG_END_HEADERS) {
+        co_return co_await handle_header_block();
+    }
+
+    if (header_block_.size() > max_header_list_size_) {
+        co_return Http2ErrorCode::ENHANCE_YOUR_CALM;
+    }
+
+    co_return {};
+}
+
+Task<std::optional<Http2ErrorCode>> Http2Connection::handle_continuation(
+    const Frame &frame,
+    std::string_view payload
+) {
+    if (header_block_stream_id_ == 0 ||
+        frame.stream_id != header_block_stream_id_) {
+        co_return Http2ErrorCode::PROTOCOL_ERROR;
+    }
+
+    header_block_ += payload;
+
+    if (header_block_.size() > max_header_list_size_) {
+        co_return Http2ErrorCode::ENHANCE_YOUR_CALM;
+    }
+
+    if (frame.flags & FLAG_END_HEADERS) {
+        co_return co_await handle_header_block();
+    }
+
+    co_return {};
+}
+
+Task<std::optional<Http2ErrorCode>> Http2Connection::handle_header_block() {
+    u32 stream_id = std::exchange(header_block_stream_id_, 0);
+    HeaderList fields;
+
+    // Blocks are decoded even for streams that are then ignored, to keep the
+    // decoder in sync with the peer's encoder. A block that decodes past the
+    // advertised SETTINGS_MAX_HEADER_LIST_SIZE leaves it out of sync.
+    if (!decoder_.decode(header_block_, fields, max_header_list_size_)) {
+        co_return Http2ErrorCode::COMPRESSION_ERROR;
+    }
+
+    header_block_.clear();
+
+    // Trailers, which are dropped.
+    if (auto it = streams_.find(stream_id); it != streams_.end()) {
+        Http2Stream &stream = *it->second;
+
+        if (stream.reset_) {
+            co_return {};
+        }
+
+        if (stream.end_stream_received_ || !header_block_end_stream_) {
+            co_await reset_stream(stream, Http2ErrorCode::PROTOCOL_ERROR);
+            co_return {};
+        }
+
+        stream.end_stream_received_ = true;
+
+        if (stream.started_) {
+            stream.wake();
+        } else {
+            stream.request_.content_length_ = stream.received_size_;
+            stream.body_.set_bytes_remaining(stream.received_size_);
+            start_stream(stream);
+        }
+
+        co_return {};
+    }
+
+    if (stream_id <= last_stream_id_) {
+        co_return {};
+    }
+
+    last_stream_id_ = stream_id;
+
+    if (streams_.size() >= MAX_CONCURRENT_STREAMS) {
+        co_await send_rst_stream(stream_id, Http2ErrorCode::REFUSED_STREAM);
+        co_return {};
+    }
+
+    auto stream = std::make_unique<Http2Stream>(
+        *this,
+        stream_id,
+        peer_initial_window_size_
+    );
+
+    if (!make_request(*stream, std::move(fields))) {
+        co_await send_rst_stream(stream_id, Http2ErrorCode::PROTOCOL_ERROR);
+        co_return {};
+    }
+
+    stream->end_stream_received_ = header_block_end_stream_;
+    Http2Stream &ref = *stream;
+    streams_.emplace(stream_id, std::move(stream));
+
+    // Without a Content-Length, the handler would not know the size of the
+    // body before reading all of it.
+    if (ref.end_stream_received_ ||
+        ref.request_.contains_header(Header::CONTENT_LENGTH)) {
+        start_stream(ref);
+    }
+
+    co_return {};
+}
+
+std::optional<Http2ErrorCode> Http2Connection::handle_rst_stream(
+    const Frame &frame,
+    std::string_view payload
+) {
+    if (payload.size() != 4) {
+        return Http2ErrorCode::FRAME_SIZE_ERROR;
+    }
+
+    if (frame.stream_id == 0 || frame.stream_id > last_stream_id_) {
+        return Http2ErrorCode::PROTOCOL_ERROR;
+    }
+
+    auto it = streams_.find(frame.stream_id);
+
+    if (it == streams_.end()) {
+        return {};
+    }
+
+    Http2Stream &stream = *it->second;
+    stream.reset_ = true;
+    stream.wake();
+
+    if (!stream.started_) {
+        streams_.erase(it);
+    }
+
+    return {};
+}
+
+Task<std::optional<Http2ErrorCode>>
+Http2Connection::handle_settings(const Frame &frame, std::string_view payload) {
+    if (frame.stream_id != 0) {
+        co_return Http2ErrorCode::PROTOCOL_ERROR;
+    }
+
+    if (frame.flags & FLAG_ACK) {
+        if (!payload.empty()) {
+            co_return Http2ErrorCode::FRAME_SIZE_ERROR;
+        }
+
+        co_return {};
+    }
+
+    if (payload.size() % SETTING_SIZE != 0) {
+        co_return Http2ErrorCode::FRAME_SIZE_ERROR;
+    }
+
+    if (std::optional<Http2ErrorCode> code = apply_settings(payload)) {
+        co_return code;
+    }
+
+    co_await send_frame(static_cast<u8>(FrameType::SETTINGS), FLAG_ACK, 0, {});
+    co_return {};
+}
+
+Task<std::optional<Http2ErrorCode>>
+Http2Connection::handle_ping(const Frame &frame, std::string_view payload) {
+    if (frame.stream_id != 0) {
+        co_return Http2ErrorCode::PROTOCOL_ERROR;
+    }
+
+    if (payload.size() != 8) {
+        co_return Http2ErrorCode::FRAME_SIZE_ERROR;
+    }
+
+    if ((frame.flags & FLAG_ACK) == 0) {
+        co_await send_frame(
+            static_cast<u8>(FrameType::PING),
+            FLAG_ACK,
+            0,
+            payload
+        );
+    }
+
+    co_return {};
+}
+
+Task<std::optional<Http2ErrorCode>> Http2Connection::handle_window_update(
+    const Frame &frame,
+    std::string_view payload
+) {
+    if (payload.size() != 4) {
+        co_return Http2ErrorCode::FRAME_SIZE_ERROR;
+    }
+
+    u32 increment = read_u32(payload) & 0x7fffffff;
+
+    if (frame.stream_id == 0) {
+        if (increment == 0) {
+            co_return Http2ErrorCode::PROTOCOL_ERROR;
+        }
+
+        send_window_ += increment;
+
+        if (send_window_ > MAX_WINDOW_SIZE) {
+            co_return Http2ErrorCode::FLOW_CONTROL_ERROR;
+        }
+
+        wake_streams();
+        co_return {};
+    }
+
+    auto it = streams_.find(frame.stream_id);
+
+    if (it == streams_.end()) {
+        co_return {};
+    }
+
+    Http2Stream &stream = *it->second;
+    stream.send_window_ += increment;
+
+    if (increment == 0 || stream.send_window_ > MAX_WINDOW_SIZE) {
+        co_await reset_stream(
+            stream,
+            increment == 0 ? Http2ErrorCode::PROTOCOL_ERROR
+                           : Http2ErrorCode::FLOW_CONTROL_ERROR
+        );
+        co_return {};
+    }
+
+    stream.wake();
+    co_return {};
+}
+
+Task<std::optional<Http2ErrorCode>>
+Http2Connection::handle_frame(const Frame &frame, std::string_view payload) {
+    auto type = static_cast<FrameType>(frame.type);
+
+    // A header block is only interrupted by its own CONTINUATION frames.
+    if (header_block_stream_id_ != 0 && type != FrameType::CONTINUATION) {
+        co_return Http2ErrorCode::PROTOCOL_ERROR;
+    }
+
+    switch (type) {
+    case FrameType::DATA: co_return co_await handle_data(frame, payload);
+    case FrameType::HEADERS: co_return co_await handle_headers(frame, payload);
+    case FrameType::PRIORITY:
+        co_return frame.stream_id == 0
+            ? std::optional{Http2ErrorCode::PROTOCOL_ERROR}
+            : std::nullopt;
+    case FrameType::RST_STREAM: co_return handle_rst_stream(frame, payload);
+    case FrameType::SETTINGS:
+        co_return co_await handle_settings(frame, payload);
+    case FrameType::PUSH_PROMISE: co_return Http2ErrorCode::PROTOCOL_ERROR;
+    case FrameType::PING: co_return co_await handle_ping(frame, payload);
+    case FrameType::GOAWAY:
+        // Streams the client has started are still served, until it closes
+        // the connection.
+        co_return frame.stream_id == 0
+            ? std::nullopt
+            : std::optional{Http2ErrorCode::PROTOCOL_ERROR};
+    case FrameType::WINDOW_UPDATE:
+        co_return co_await handle_window_update(frame, payload);
+    case FrameType::CONTINUATION:
+        co_return co_await handle_continuation(frame, payload);
+    }
+
+    // Frames of unknown types are ignored.
+    co_return {};
+}
+
+bool Http2Connection::is_upgrade_request(const Request &request) {
+    auto upgrade = request.get_header(Header::UPGRADE);
+    auto settings = request.get_header(Header::HTTP2_SETTINGS);
+
+    if (!upgrade || !settings || settings->get().size() != 1 ||
+        request.http_version().minor != 1 || request.content_length() > 0 ||
+        request.contains_header(Header::TRANSFER_ENCODING) ||
+        !request.header_contains_token(Header::UPGRADE, H2C)) {
+        return false;
+    }
+
+    std::optional<std::string> payload =
+        decode_base64url(settings->get().front());
+    return payload && payload->size() % SETTING_SIZE == 0;
+}
+
+Task<> Http2Connection::serve(std::optional<Request> upgrade_request) {
+    std::string_view preface = CLIENT_PREFACE;
+    std::optional<Http2ErrorCode> error_code;
+    reader_->set_bytes_remaining(std::numeric_limits<i64>::max());
+
+    co_await lock_writer();
+    std::optional<Error> error;
+
+    if (upgrade_request) {
+        error = co_await writer_->write(SWITCHING_PROTOCOLS_RESPONSE);
+        // Acknowledged by the 101 response itself.
+        error_code = apply_settings(*decode_base64url(
+            upgrade_request->get_header(Header::HTTP2_SETTINGS)->get().front()
+        ));
+    } else {
+        preface.remove_prefix(
+            http_utils::HTTP2_PREFACE_REQUEST_LINE.size() + 2
+        );
+    }
+
+    if (!error) {
+        error = co_await write_preface();
+    }
+
+    std::optional<Error> unlock_error = co_await unlock_writer();
+
+    if (error || unlock_error) {
+        co_return;
+    }
+
+    if (upgrade_request && !error_code) {
+        auto stream = std::make_unique<Http2Stream>(
+            *this,
+            1,
+            peer_initial_window_size_
+        );
+        Request &request = stream->request_;
+        request = std::move(*upgrade_request);
+        request.headers_.erase(Header::CONNECTION);
+        request.headers_.erase(Header::UPGRADE);
+        request.headers_.erase(Header::HTTP2_SETTINGS);
+        request.http_version_ = {2, 0};
+        request.body_ = &stream->body_;
+        stream->body_.set_bytes_remaining(0);
+        stream->end_stream_received_ = true;
+        last_stream_id_ = 1;
+
+        Http2Stream &ref = *stream;
+        streams_.emplace(1, std::move(stream));
+        start_stream(ref);
+    }
+
+    std::variant<std::string_view, Error> result =
+        co_await reader_->read_exact(preface.size());
+
+    if (std::holds_alternative<Error>(result)) {
+        error_code = Http2ErrorCode::NO_ERROR;
+    } else if (std::get<std::string_view>(result) != preface) {
+        error_code = Http2ErrorCode::PROTOCOL_ERROR;
+    }
+
+    while (!error_code && !output_failed_) {
+        // Idle connections hold no buffer, as between HTTP/1 requests.
+        reader_->release_buffer();
+        result = co_await reader_->read_exact(FRAME_HEADER_SIZE);
+
+        if (const auto *read_error = std::get_if<Error>(&result)) {
+            if (*read_error == Error::CONNECTION_TIMED_OUT) {
+                if (running_streams_ > 0) {
+                    continue;
+                }
+
+                error_code = Http2ErrorCode::NO_ERROR;
+            }
+
+            break;
+        }
+
+        std::string_view header = std::get<std::string_view>(result);
+        Frame frame{
+            .length = read_u32(header) >> 8,
+            .type = static_cast<u8>(header[3]),
+            .flags = static_cast<u8>(header[4]),
+            .stream_id = read_u32(header.substr(5)) & 0x7fffffff,
+        };
+
+        if (frame.length > DEFAULT_MAX_FRAME_SIZE) {
+            error_code = Http2ErrorCode::FRAME_SIZE_ERROR;
+            break;
+        }
+
+        result = co_await reader_->read_exact(frame.length);
+
+        if (std::holds_alternative<Error>(result)) {
+            break;
+        }
+
+        error_code =
+            co_await handle_frame(frame, std::get<std::string_view>(result));
+    }
+
+    if (error_code) {
+        co_await send_goaway(*error_code);
+    }
+
+    input_closed_ = true;
+
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        it->second->wake();
+        it = it->second->started_ ? std::next(it) : streams_.erase(it);
+    }
+
+    if (running_streams_ > 0) {
+        co_await Wait{closing_waiter_};
+    }
+}
+
+} // namespace co_http_uring
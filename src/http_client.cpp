@@ -0,0 +1,228 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/http_client.hpp"
+
+#include "co_http_uring/client_response.hpp"
+#include "co_http_uring/connection.hpp"
+#include "co_http_uring/connection_writer.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/headers.hpp"
+#include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/operation_future.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/socket_address.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <fmt/core.h>
+#include <liburing.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+extern "C" {
+#include <arpa/inet.h>
+#include <sys/socket.h>
+}
+
+using namespace std::literals::chrono_literals;
+
+namespace co_http_uring {
+
+namespace {
+
+constexpr std::chrono::seconds DEFAULT_CONNECT_TIMEOUT = 5s;
+constexpr std::size_t DEFAULT_MAX_IDLE_CONNECTIONS = 16;
+constexpr u64 DEFAULT_MAX_RESPONSE_BODY_SIZE = 64 * 1024 * 1024;
+
+std::string make_host(const Ipv4Address &address) {
+    in_addr addr{.s_addr = ::htonl(address.addr())};
+    char buffer[INET_ADDRSTRLEN];
+    ::inet_ntop(AF_INET, &addr, buffer, sizeof(buffer));
+    return fmt::format("{}:{}", buffer, address.port());
+}
+
+bool has_header(const ClientRequest &request, std::string_view name) {
+    return std::ranges::any_of(request.headers, [name](const auto &header) {
+        return http_utils::make_header_name(header.first) == name;
+    });
+}
+
+Task<> close_connection(std::unique_ptr<Connection> conn) {
+    co_await conn->close();
+}
+
+} // namespace
+
+HttpClient::HttpClient(const Ipv4Address &address) :
+    address_{address},
+    host_{make_host(address)},
+    connect_timeout_{DEFAULT_CONNECT_TIMEOUT},
+    max_idle_connections_{DEFAULT_MAX_IDLE_CONNECTIONS},
+    max_response_body_size_{DEFAULT_MAX_RESPONSE_BODY_SIZE} {
+}
+
+HttpClient &HttpClient::for_address(const Ipv4Address &address) {
+    thread_local std::map<std::pair<u32, u16>, HttpClient> clients;
+
+    auto key = std::make_pair(address.addr(), address.port());
+    auto it = clients.find(key);
+
+    if (it == clients.end()) {
+        it = clients.emplace(key, HttpClient(address)).first;
+    }
+
+    return it->second;
+}
+
+Task<std::variant<std::unique_ptr<Connection>, Error>> HttpClient::connect() {
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
+
+    i64 key = server->allocate_operation_key();
+    IoUringSqe sqe = ring.get_sqe();
+    sqe.prep_socket_direct_alloc(AF_INET, SOCK_STREAM, 0, 0);
+    sqe.set_data64(key);
+    ring.submit();
+
+    i32 fixed_fd = co_await OperationFuture(key);
+
+    if (fixed_fd < 0) {
+        fmt::print(stderr, "socket error: {}\n", std::strerror(-fixed_fd));
+        co_return Error::CONNECT_ERROR;
+    }
+
+    auto conn = std::make_unique<Connection>(fixed_fd);
+
+    key = server->allocate_operation_key();
+    sqe = ring.get_sqe();
+    sqe.prep_connect(fixed_fd, address_.sockaddr(), address_.sockaddr_size());
+    sqe.set_data64(key);
+    sqe.set_flags(IOSQE_FIXED_FILE | IOSQE_IO_LINK);
+
+    server->submit_linked_timeout(connect_timeout_);
+    i32 res = co_await OperationFuture(key);
+
+    if (res < 0) {
+        close_connection(std::move(conn)).detach();
+
+        if (res == -ECANCELED) {
+            co_return Error::CONNECTION_TIMED_OUT;
+        }
+
+        fmt::print(stderr, "connect error: {}\n", std::strerror(-res));
+        co_return Error::CONNECT_ERROR;
+    }
+
+    co_return std::move(conn);
+}
+
+Task<std::optional<Error>> HttpClient::write_request(
+    ConnectionWriter &writer,
+    const ClientRequest &request
+) {
+    std::string head =
+        fmt::format("{} {} HTTP/1.1\r\n", request.method, request.target);
+
+    if (!has_header(request, headers::HOST)) {
+        head += fmt::format("Host: {}\r\n", host_);
+    }
+
+    for (const auto &[name, value] : request.headers) {
+        head += fmt::format("{}: {}\r\n", name, value);
+    }
+
+    if (!request.body.empty() || request.method == "POST" ||
+        request.method == "PUT" || request.method == "PATCH") {
+        head += fmt::format("Content-Length: {}\r\n", request.body.size());
+    }
+
+    head += "\r\n";
+    std::optional<Error> error = co_await writer.write(head);
+
+    if (error || (error = co_await writer.write(request.body))) {
+        co_return error;
+    }
+
+    co_return co_await writer.flush();
+}
+
+std::unique_ptr<Connection> HttpClient::take_idle() {
+    if (idle_connections_.empty()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Connection> conn = std::move(idle_connections_.back());
+    idle_connections_.pop_back();
+    return conn;
+}
+
+void HttpClient::release(std::unique_ptr<Connection> conn, bool keep_alive) {
+    if (keep_alive && idle_connections_.size() < max_idle_connections_) {
+        conn->reader().release_buffer();
+        idle_connections_.push_back(std::move(conn));
+        return;
+    }
+
+    close_connection(std::move(conn)).detach();
+}
+
+Task<std::variant<ClientResponse, Error>>
+HttpClient::send(ClientRequest request) {
+    while (true) {
+        std::unique_ptr<Connection> conn = take_idle();
+        bool reused = conn != nullptr;
+
+        if (!reused) {
+            std::variant<std::unique_ptr<Connection>, Error> result =
+                co_await connect();
+
+            if (const auto *error = std::get_if<Error>(&result)) {
+                co_return *error;
+            }
+
+            conn = std::move(std::get<std::unique_ptr<Connection>>(result));
+        }
+
+        std::variant<ClientResponse, Error> result = Error::WRITE_ERROR;
+        std::optional<Error> error =
+            co_await write_request(conn->writer(), request);
+
+        if (!error) {
+            result = co_await ClientResponse::receive(
+                conn->reader(),
+                request.method,
+                max_response_body_size_
+            );
+        }
+
+        if (const auto *response = std::get_if<ClientResponse>(&result)) {
+            release(std::move(conn), response->keep_alive());
+            co_return result;
+        }
+
+        release(std::move(conn), false);
+        Error send_error = std::get<Error>(result);
+        bool stale = send_error == Error::WRITE_ERROR ||
+            send_error == Error::READ_ERROR ||
+            send_error == Error::CONNECTION_CLOSED;
+
+        if (!reused || !stale ||
+            !http_utils::is_idempotent_method(request.method)) {
+            co_return send_error;
+        }
+    }
+}
+
+} // namespace co_http_uring
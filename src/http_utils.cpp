@@ -88,7 +88,13 @@ std::string make_header_name(std::string_view name) {
     return owned_name;
 }
 
-std::string make_header_value(std::string_view value) {
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    return std::ranges::equal(a, b, [](unsigned char c, unsigned char d) {
+        return std::tolower(c) == std::tolower(d);
+    });
+}
+
+std::string_view trim_header_value(std::string_view value) {
     size_t non_whitespace_start = value.find_first_not_of(WHITESPACE_CHARS);
 
     if (non_whitespace_start != std::string_view::npos) {
@@ -98,7 +104,30 @@ std::string make_header_value(std::string_view value) {
         );
     }
 
-    return std::string{value};
+    return value;
+}
+
+std::string make_header_value(std::string_view value) {
+    return std::string{trim_header_value(value)};
+}
+
+bool contains_token(std::string_view list, std::string_view token) {
+    while (!list.empty()) {
+        std::size_t end = std::min(list.find(','), list.size());
+
+        if (equals_ignore_case(trim_header_value(list.substr(0, end)), token)) {
+            return true;
+        }
+
+        list.remove_prefix(std::min(end + 1, list.size()));
+    }
+
+    return false;
+}
+
+bool is_idempotent_method(std::string_view method) {
+    return method == "GET" || method == "HEAD" || method == "PUT" ||
+        method == "DELETE" || method == "OPTIONS" || method == "TRACE";
 }
 
 } // namespace co_http_uring::http_utils
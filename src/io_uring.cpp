@@ -5,6 +5,9 @@
 
 #include <liburing.h>
 
+#include <cerrno>
+#include <chrono>
+#include <optional>
 #include <stdexcept>
 #include <system_error>
 
@@ -32,6 +35,37 @@ void IoUring::register_files(const std::vector<int> &files) {
     }
 }
 
+void IoUring::register_buffers(const std::vector<iovec> &buffers) {
+    int ret = io_uring_register_buffers(&ring_, buffers.data(), buffers.size());
+
+    if (ret < 0) {
+        const char *what = "io_uring_register_buffers() failed";
+        throw std::system_error(-ret, std::generic_category(), what);
+    }
+}
+
+io_uring_buf_ring *
+IoUring::setup_buf_ring(unsigned int entries, u16 group_id) {
+    int ret{};
+    io_uring_buf_ring *buf_ring =
+        io_uring_setup_buf_ring(&ring_, entries, group_id, 0, &ret);
+
+    if (buf_ring == nullptr) {
+        const char *what = "io_uring_setup_buf_ring() failed";
+        throw std::system_error(-ret, std::generic_category(), what);
+    }
+
+    return buf_ring;
+}
+
+void IoUring::free_buf_ring(
+    io_uring_buf_ring *buf_ring,
+    unsigned int entries,
+    u16 group_id
+) {
+    io_uring_free_buf_ring(&ring_, buf_ring, entries, group_id);
+}
+
 IoUringSqe IoUring::get_sqe() {
     io_uring_sqe *sqe = io_uring_get_sqe(&ring_);
 
@@ -63,6 +97,22 @@ IoUringCqe IoUring::peek_cqe() {
     return IoUringCqe(cqe);
 }
 
+std::optional<IoUringCqe> IoUring::try_peek_cqe() {
+    io_uring_cqe *cqe;
+    int ret = io_uring_peek_cqe(&ring_, &cqe);
+
+    if (ret == -EAGAIN) {
+        return std::nullopt;
+    }
+
+    if (ret < 0) {
+        const char *what = "io_uring_peek_cqe() failed";
+        throw std::system_error(-ret, std::generic_category(), what);
+    }
+
+    return IoUringCqe(cqe);
+}
+
 IoUringCqe IoUring::wait_cqe() {
     io_uring_cqe *cqe;
     int ret = io_uring_wait_cqe(&ring_, &cqe);
@@ -75,4 +125,22 @@ IoUringCqe IoUring::wait_cqe() {
     return IoUringCqe(cqe);
 }
 
+void IoUring::wait_cqes(
+    unsigned int wait_nr,
+    std::chrono::microseconds timeout
+) {
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    __kernel_timespec ts{
+        .tv_sec = seconds.count(),
+        .tv_nsec = std::chrono::nanoseconds{timeout - seconds}.count(),
+    };
+    io_uring_cqe *cqe;
+    int ret = io_uring_wait_cqes(&ring_, &cqe, wait_nr, &ts, nullptr);
+
+    if (ret < 0 && ret != -ETIME) {
+        const char *what = "io_uring_wait_cqes() failed";
+        throw std::system_error(-ret, std::generic_category(), what);
+    }
+}
+
 } // namespace co_http_uring
@@ -0,0 +1,226 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/known_headers.hpp"
+
+#include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace co_http_uring {
+
+namespace {
+
+// In the order of Header, which is alphabetical.
+constexpr std::array<std::string_view, KNOWN_HEADER_COUNT> HEADER_NAMES{
+    "accept",
+    "accept-charset",
+    "accept-encoding",
+    "accept-language",
+    "accept-patch",
+    "accept-post",
+    "accept-ranges",
+    "access-control-allow-credentials",
+    "access-control-allow-headers",
+    "access-control-allow-methods",
+    "access-control-allow-origin",
+    "access-control-expose-headers",
+    "access-control-max-age",
+    "access-control-request-headers",
+    "access-control-request-method",
+    "age",
+    "allow",
+    "alt-svc",
+    "authorization",
+    "cache-control",
+    "cache-status",
+    "cdn-cache-control",
+    "clear-site-data",
+    "connection",
+    "content-disposition",
+    "content-encoding",
+    "content-language",
+    "content-length",
+    "content-location",
+    "content-range",
+    "content-security-policy",
+    "content-security-policy-report-only",
+    "content-type",
+    "cookie",
+    "cross-origin-embedder-policy",
+    "cross-origin-opener-policy",
+    "cross-origin-resource-policy",
+    "date",
+    "dnt",
+    "early-data",
+    "etag",
+    "expect",
+    "expires",
+    "forwarded",
+    "from",
+    "host",
+    "http2-settings",
+    "if-match",
+    "if-modified-since",
+    "if-none-match",
+    "if-range",
+    "if-unmodified-since",
+    "keep-alive",
+    "last-modified",
+    "link",
+    "location",
+    "max-forwards",
+    "origin",
+    "permissions-policy",
+    "pragma",
+    "priority",
+    "proxy-authenticate",
+    "proxy-authorization",
+    "proxy-connection",
+    "range",
+    "referer",
+    "referrer-policy",
+    "refresh",
+    "retry-after",
+    "sec-fetch-dest",
+    "sec-fetch-mode",
+    "sec-fetch-site",
+    "sec-fetch-user",
+    "sec-websocket-accept",
+    "sec-websocket-extensions",
+    "sec-websocket-key",
+    "sec-websocket-protocol",
+    "sec-websocket-version",
+    "server",
+    "server-timing",
+    "set-cookie",
+    "strict-transport-security",
+    "te",
+    "timing-allow-origin",
+    "trailer",
+    "transfer-encoding",
+    "upgrade",
+    "upgrade-insecure-requests",
+    "user-agent",
+    "vary",
+    "via",
+    "warning",
+    "www-authenticate",
+    "x-content-type-options",
+    "x-forwarded-for",
+    "x-forwarded-host",
+    "x-forwarded-proto",
+    "x-frame-options",
+    "x-request-id",
+    "x-requested-with",
+    "x-xss-protection",
+};
+
+static_assert(
+    std::is_sorted(HEADER_NAMES.cbegin(), HEADER_NAMES.cend()),
+    "HEADER_NAMES must follow the order of Header"
+);
+
+// Hash and displace: names are spread over buckets by their hash, and each
+// bucket gets a seed that sends all of its names to free slots.
+constexpr std::size_t BUCKET_COUNT = 64;
+constexpr std::size_t SLOT_COUNT = 256;
+
+struct PerfectHash {
+    std::array<u32, BUCKET_COUNT> seeds;
+    // One more than the Header in each slot, or 0.
+    std::array<u8, SLOT_COUNT> slots;
+};
+
+constexpr std::size_t get_slot(u32 hash, u32 seed) {
+    u32 x = hash ^ seed;
+    x ^= x >> 16;
+    x *= 0x85ebca6b;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35;
+    x ^= x >> 16;
+    return x % SLOT_COUNT;
+}
+
+consteval PerfectHash make_perfect_hash() {
+    PerfectHash perfect_hash{};
+    std::array<std::array<u8, KNOWN_HEADER_COUNT>, BUCKET_COUNT> buckets{};
+    std::array<std::size_t, BUCKET_COUNT> bucket_sizes{};
+
+    for (std::size_t i = 0; i < KNOWN_HEADER_COUNT; i++) {
+        std::size_t bucket = hash_header_name(HEADER_NAMES[i]) % BUCKET_COUNT;
+        buckets[bucket][bucket_sizes[bucket]++] = static_cast<u8>(i);
+    }
+
+    // The largest buckets are placed first, while most slots are free.
+    std::array<std::size_t, BUCKET_COUNT> order{};
+
+    for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+        order[i] = i;
+    }
+
+    std::sort(
+        order.begin(),
+        order.end(),
+        [&bucket_sizes](std::size_t a, std::size_t b) {
+            return bucket_sizes[a] > bucket_sizes[b] ||
+                (bucket_sizes[a] == bucket_sizes[b] && a < b);
+        }
+    );
+
+    for (std::size_t bucket : order) {
+        for (u32 seed = 1;; seed++) {
+            std::array<u8, SLOT_COUNT> slots = perfect_hash.slots;
+            bool placed = true;
+
+            for (std::size_t i = 0; i < bucket_sizes[bucket] && placed; i++) {
+                u8 header = buckets[bucket][i];
+                std::size_t slot =
+                    get_slot(hash_header_name(HEADER_NAMES[header]), seed);
+                placed = slots[slot] == 0;
+                slots[slot] = header + 1;
+            }
+
+            if (placed) {
+                perfect_hash.seeds[bucket] = seed;
+                perfect_hash.slots = slots;
+                break;
+            }
+
+            if (seed == 1 << 16) {
+                throw std::logic_error("no perfect hash for the header names");
+            }
+        }
+    }
+
+    return perfect_hash;
+}
+
+constexpr PerfectHash PERFECT_HASH = make_perfect_hash();
+
+} // namespace
+
+std::string_view header_name(Header header) {
+    return HEADER_NAMES[static_cast<std::size_t>(header)];
+}
+
+std::optional<Header> find_header(std::string_view name) {
+    u32 hash = hash_header_name(name);
+    u32 seed = PERFECT_HASH.seeds[hash % BUCKET_COUNT];
+    u8 slot = PERFECT_HASH.slots[get_slot(hash, seed)];
+
+    if (slot == 0 ||
+        !http_utils::equals_ignore_case(name, HEADER_NAMES[slot - 1])) {
+        return {};
+    }
+
+    return static_cast<Header>(slot - 1);
+}
+
+} // namespace co_http_uring
@@ -1,11 +1,13 @@
 // Copyright (C) 2022 OverMighty
 // SPDX-License-Identifier: Apache-2.0
 
-#include "co_http_uring/tcp_socket.hpp"
+#include "co_http_uring/listen_socket.hpp"
 
 #include "co_http_uring/socket_address.hpp"
+#include "co_http_uring/socket_options.hpp"
 
 #include <cerrno>
+#include <string>
 #include <system_error>
 
 extern "C" {
@@ -16,39 +18,59 @@ extern "C" {
 
 namespace co_http_uring {
 
-TcpSocket::TcpSocket() : fd_{::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)} {
+ListenSocket::ListenSocket(int family) :
+    fd_{::socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0)} {
     if (fd_ == -1) {
         const char *what = "socket() failed";
         throw std::system_error(errno, std::generic_category(), what);
     }
 }
 
-TcpSocket::~TcpSocket() {
+ListenSocket::~ListenSocket() {
+    if (fd_ == -1) {
+        return;
+    }
+
     ::close(fd_);
+
+    if (!unix_path_.empty()) {
+        ::unlink(unix_path_.c_str());
+    }
 }
 
-void TcpSocket::bind(const Ipv4Address &addr) const {
-    int reuse_port = 1;
+void ListenSocket::bind(const SocketAddress &address) {
+    if (address.family() != AF_UNIX) {
+        set_option({SOL_SOCKET, SO_REUSEPORT, 1});
+    }
+
+    if (address.family() == AF_INET6) {
+        set_option({IPPROTO_IPV6, IPV6_V6ONLY, !address.dual_stack()});
+    }
+
+    if (::bind(fd_, address.sockaddr(), address.sockaddr_size()) == -1) {
+        const char *what = "bind() failed";
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    unix_path_ = address.unix_path();
+}
+
+void ListenSocket::set_option(const SocketOption &option) const {
     int ret = ::setsockopt(
         fd_,
-        SOL_SOCKET,
-        SO_REUSEPORT,
-        &reuse_port,
-        sizeof(reuse_port)
+        option.level,
+        option.name,
+        &option.value,
+        sizeof(option.value)
     );
 
     if (ret == -1) {
         const char *what = "setsockopt() failed";
         throw std::system_error(errno, std::generic_category(), what);
     }
-
-    if (::bind(fd_, addr.sockaddr(), addr.sockaddr_size()) == -1) {
-        const char *what = "bind() failed";
-        throw std::system_error(errno, std::generic_category(), what);
-    }
 }
 
-void TcpSocket::listen(int max_pending_conns) const {
+void ListenSocket::listen(int max_pending_conns) const {
     if (::listen(fd_, max_pending_conns) == -1) {
         const char *what = "listen() failed";
         throw std::system_error(errno, std::generic_category(), what);
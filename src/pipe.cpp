@@ -0,0 +1,153 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/pipe.hpp"
+
+#include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/operation_future.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <liburing.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+}
+
+namespace co_http_uring {
+
+namespace {
+
+constexpr std::size_t MAX_IDLE_PIPES = 16;
+
+thread_local std::vector<std::unique_ptr<Pipe>> idle_pipes;
+
+// io_uring runs splices in its worker threads, where a splice blocked on a
+// socket is not interrupted by a linked timeout. A poll is, so sockets are
+// waited on with one first, after which the splice does not block.
+Task<i32> wait_ready(
+    int fixed_fd,
+    unsigned int poll_mask,
+    std::chrono::seconds timeout
+) {
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
+
+    i64 key = server->allocate_operation_key();
+    IoUringSqe sqe = ring.get_sqe();
+    sqe.prep_poll_add(fixed_fd, poll_mask);
+    sqe.set_data64(key);
+    sqe.set_flags(IOSQE_FIXED_FILE | IOSQE_IO_LINK);
+
+    server->submit_linked_timeout(timeout);
+    co_return co_await OperationFuture(key);
+}
+
+Task<i32> splice(
+    int fd_in,
+    i64 off_in,
+    bool fd_in_fixed,
+    int fd_out,
+    i64 off_out,
+    unsigned int size
+) {
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
+
+    i64 key = server->allocate_operation_key();
+    IoUringSqe sqe = ring.get_sqe();
+    sqe.prep_splice(
+        fd_in,
+        off_in,
+        fd_out,
+        off_out,
+        size,
+        fd_in_fixed ? SPLICE_F_FD_IN_FIXED : 0
+    );
+    sqe.set_data64(key);
+    sqe.set_flags(fd_in_fixed ? 0 : IOSQE_FIXED_FILE);
+    ring.submit();
+    co_return co_await OperationFuture(key);
+}
+
+} // namespace
+
+Pipe::Pipe() {
+    int fds[2];
+
+    if (::pipe2(fds, O_CLOEXEC) == -1) {
+        throw std::system_error(errno, std::generic_category(), "pipe2");
+    }
+
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+}
+
+Pipe::~Pipe() {
+    ::close(read_fd_);
+    ::close(write_fd_);
+}
+
+std::unique_ptr<Pipe> Pipe::acquire() {
+    if (idle_pipes.empty()) {
+        return std::make_unique<Pipe>();
+    }
+
+    std::unique_ptr<Pipe> pipe = std::move(idle_pipes.back());
+    idle_pipes.pop_back();
+    return pipe;
+}
+
+void Pipe::release(std::unique_ptr<Pipe> pipe) {
+    if (idle_pipes.size() < MAX_IDLE_PIPES) {
+        idle_pipes.push_back(std::move(pipe));
+    }
+}
+
+Task<i32> Pipe::fill_from(
+    int fixed_fd,
+    i64 offset,
+    unsigned int size,
+    std::optional<std::chrono::seconds> timeout
+) {
+    if (timeout) {
+        i32 res = co_await wait_ready(fixed_fd, POLLIN, *timeout);
+
+        if (res < 0) {
+            co_return res;
+        }
+    }
+
+    co_return co_await splice(fixed_fd, offset, true, write_fd_, -1, size);
+}
+
+Task<i32> Pipe::drain_to(
+    int fixed_fd,
+    i64 offset,
+    unsigned int size,
+    std::optional<std::chrono::seconds> timeout
+) {
+    if (timeout) {
+        i32 res = co_await wait_ready(fixed_fd, POLLOUT, *timeout);
+
+        if (res < 0) {
+            co_return res;
+        }
+    }
+
+    co_return co_await splice(read_fd_, -1, false, fixed_fd, offset, size);
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,80 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/pooled_buffer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace co_http_uring {
+
+namespace {
+
+constexpr std::size_t NUM_SIZE_CLASSES =
+    std::countr_zero(PooledBuffer::MAX_SIZE / PooledBuffer::MIN_SIZE) + 1;
+
+// Idle memory kept per size class, so that a burst of large heads does not
+// pin as much memory as a burst of small ones.
+constexpr std::size_t MAX_IDLE_BYTES_PER_CLASS = 8 * 1024 * 1024;
+
+struct Pool {
+    std::array<std::vector<std::unique_ptr<char[]>>, NUM_SIZE_CLASSES> idle;
+
+    ~Pool();
+};
+
+// Trivially destructible, so still readable while other thread-local objects
+// holding buffers are destroyed after the pool.
+thread_local bool pool_destroyed = false;
+
+thread_local Pool pool;
+
+Pool::~Pool() {
+    pool_destroyed = true;
+}
+
+std::size_t size_class(std::size_t size) {
+    return std::countr_zero(size / PooledBuffer::MIN_SIZE);
+}
+
+} // namespace
+
+PooledBuffer PooledBuffer::acquire(std::size_t min_size) {
+    std::size_t size = std::bit_ceil(std::max(min_size, MIN_SIZE));
+
+    if (size <= MAX_SIZE) {
+        auto &idle = pool.idle[size_class(size)];
+
+        if (!idle.empty()) {
+            std::unique_ptr<char[]> data = std::move(idle.back());
+            idle.pop_back();
+            return {std::move(data), size};
+        }
+    }
+
+    return {std::make_unique_for_overwrite<char[]>(size), size};
+}
+
+void PooledBuffer::release() {
+    if (!data_) {
+        return;
+    }
+
+    if (size_ <= MAX_SIZE && !pool_destroyed) {
+        auto &idle = pool.idle[size_class(size_)];
+
+        if ((idle.size() + 1) * size_ <= MAX_IDLE_BYTES_PER_CLASS) {
+            idle.push_back(std::move(data_));
+        }
+    }
+
+    data_.reset();
+    size_ = 0;
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,460 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/proxy_handler.hpp"
+
+#include "co_http_uring/client_response.hpp"
+#include "co_http_uring/connection.hpp"
+#include "co_http_uring/connection_reader.hpp"
+#include "co_http_uring/connection_writer.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/header_map.hpp"
+#include "co_http_uring/headers.hpp"
+#include "co_http_uring/http_client.hpp"
+#include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/pipe.hpp"
+#include "co_http_uring/request.hpp"
+#include "co_http_uring/response_writer.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/socket_address.hpp"
+#include "co_http_uring/status_code.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace co_http_uring {
+
+namespace {
+
+// Headers describing a single connection rather than the message (RFC 9110,
+// section 7.6.1), which must not be forwarded.
+constexpr std::array<std::string_view, 9> HOP_BY_HOP_HEADERS{
+    headers::CONNECTION,
+    headers::KEEP_ALIVE,
+    headers::PROXY_AUTHENTICATE,
+    headers::PROXY_AUTHORIZATION,
+    headers::PROXY_CONNECTION,
+    headers::TE,
+    headers::TRAILER,
+    headers::TRANSFER_ENCODING,
+    headers::UPGRADE,
+};
+
+// The Connection header of `headers` may name more hop-by-hop headers.
+bool is_hop_by_hop(std::string_view name, const HeaderMap &headers) {
+    return std::ranges::find(HOP_BY_HOP_HEADERS, name) !=
+        HOP_BY_HOP_HEADERS.cend() ||
+        headers.contains_token(Header::CONNECTION, name);
+}
+
+// Moves `length` bytes, or everything until the peer shuts down its side of
+// the connection if `length` is nothing, from one socket to another.
+Task<std::optional<Error>> splice_between(
+    int in_fixed_fd,
+    int out_fixed_fd,
+    std::optional<u64> length
+) {
+    std::unique_ptr<Pipe> pipe = Pipe::acquire();
+    Server *server = Server::thread_instance();
+    u64 remaining = length.value_or(std::numeric_limits<u64>::max());
+
+    while (remaining > 0) {
+        unsigned int size = std::min<u64>(remaining, Pipe::CAPACITY);
+        i32 res = co_await pipe->fill_from(
+            in_fixed_fd,
+            -1,
+            size,
+            server->read_timeout()
+        );
+
+        if (res == 0) {
+            if (!length) {
+                break;
+            }
+
+            co_return Error::CONNECTION_CLOSED;
+        }
+
+        if (res < 0) {
+            co_return res == -ECANCELED ? Error::CONNECTION_TIMED_OUT
+                                        : Error::READ_ERROR;
+        }
+
+        remaining -= res;
+
+        // A splice to a socket can be short, like a send.
+        while (res > 0) {
+            i32 written = co_await pipe->drain_to(
+                out_fixed_fd,
+                -1,
+                static_cast<unsigned int>(res),
+                server->write_timeout()
+            );
+
+            if (written == -ECANCELED) {
+                co_return Error::WRITE_TIMED_OUT;
+            }
+
+            if (written <= 0) {
+                co_return Error::WRITE_ERROR;
+            }
+
+            res -= written;
+        }
+    }
+
+    Pipe::release(std::move(pipe));
+    co_return {};
+}
+
+// Forwards a body whose beginning may already sit in `reader`'s buffer: the
+// buffered part is copied, and the rest is spliced.
+Task<std::optional<Error>> forward_body(
+    ConnectionReader &reader,
+    ConnectionWriter &writer,
+    std::optional<u64> length
+) {
+    u64 max_size = length.value_or(std::numeric_limits<u64>::max());
+    std::string_view buffered = reader.take_buffered(max_size);
+    std::optional<Error> error = co_await writer.write(buffered);
+
+    if (error || (length && *length == buffered.size())) {
+        co_return error;
+    }
+
+    if ((error = co_await writer.flush())) {
+        co_return error;
+    }
+
+    std::optional<u64> remaining;
+
+    if (length) {
+        remaining = *length - buffered.size();
+    }
+
+    co_return co_await splice_between(
+        reader.fixed_fd(),
+        writer.fixed_fd(),
+        remaining
+    );
+}
+
+// Forwards a chunked body chunk by chunk, keeping the chunked framing only
+// if the client understands it.
+Task<std::optional<Error>> forward_chunked_body(
+    ConnectionReader &reader,
+    ConnectionWriter &writer,
+    bool keep_framing
+) {
+    while (true) {
+        std::variant<std::string_view, Error> result =
+            co_await reader.read_line();
+
+        if (const auto *error = std::get_if<Error>(&result)) {
+            co_return *error;
+        }
+
+        auto line = std::get<std::string_view>(result);
+        std::string_view size_str = line.substr(0, line.find(';'));
+        const char *size_end = size_str.data() + size_str.size();
+        u64 chunk_size{};
+        auto [ptr, ec] =
+            std::from_chars(size_str.data(), size_end, chunk_size, 16);
+
+        if (ec != std::errc{} || ptr == size_str.data()) {
+            co_return Error::INVALID_RESPONSE;
+        }
+
+        std::optional<Error> error;
+
+        if (keep_framing && (error = co_await writer.write_line(line))) {
+            co_return error;
+        }
+
+        if (chunk_size == 0) {
+            break;
+        }
+
+        if ((error = co_await forward_body(reader, writer, chunk_size))) {
+            co_return error;
+        }
+
+        result = co_await reader.read_line();
+
+        if (const auto *error = std::get_if<Error>(&result)) {
+            co_return *error;
+        }
+
+        if (!std::get<std::string_view>(result).empty()) {
+            co_return Error::INVALID_RESPONSE;
+        }
+
+        if (keep_framing && (error = co_await writer.write_line())) {
+            co_return error;
+        }
+    }
+
+    // Trailer fields, up to the final empty line.
+    while (true) {
+        std::variant<std::string_view, Error> result =
+            co_await reader.read_line();
+
+        if (const auto *error = std::get_if<Error>(&result)) {
+            co_return *error;
+        }
+
+        auto line = std::get<std::string_view>(result);
+
+        if (keep_framing) {
+            if (std::optional<Error> error = co_await writer.write_line(line)) {
+                co_return error;
+            }
+        }
+
+        if (line.empty()) {
+            co_return {};
+        }
+    }
+}
+
+std::string make_request_head(const Request &req, const HttpClient &client) {
+    std::string head =
+        fmt::format("{} {} HTTP/1.1\r\n", req.method(), req.target());
+
+    if (!req.contains_header(Header::HOST)) {
+        head += fmt::format("host: {}\r\n", client.host());
+    }
+
+    for (const auto &[name, values] : req.headers()) {
+        if (is_hop_by_hop(name, req.headers())) {
+            continue;
+        }
+
+        for (std::string_view value : values) {
+            head += fmt::format("{}: {}\r\n", name, value);
+        }
+    }
+
+    head += "\r\n";
+    return head;
+}
+
+Task<> respond_with_error(ResponseWriter &res, StatusCode code) {
+    res.disable_compression();
+    co_await res.write_status(code);
+    co_await res.write_body("");
+    co_await res.send();
+}
+
+} // namespace
+
+ProxyHandler::ProxyHandler(const Ipv4Address &upstream) :
+    upstream_{upstream} {
+}
+
+Task<> ProxyHandler::operator()(const Request &req, ResponseWriter res) const {
+    // Bodies are spliced between sockets, which HTTP/2 streams do not have.
+    if (req.http_version().major == 2) {
+        co_await respond_with_error(
+            res,
+            StatusCode::HTTP_VERSION_NOT_SUPPORTED
+        );
+        co_return;
+    }
+
+    // The server does not decode chunked request bodies.
+    if (req.contains_header(Header::TRANSFER_ENCODING)) {
+        co_await respond_with_error(res, StatusCode::NOT_IMPLEMENTED);
+        res.close_connection();
+        co_return;
+    }
+
+    HttpClient &client = HttpClient::for_address(upstream_);
+    std::string head = make_request_head(req, client);
+
+    // What the server already read of the body is kept so that the request
+    // can be sent again on another connection. The rest is only spliced once.
+    ConnectionReader &body = req.body();
+    std::string buffered_body{body.take_buffered(req.content_length())};
+    u64 unread_body_size = req.content_length() - buffered_body.size();
+    bool replayable = unread_body_size == 0;
+
+    std::unique_ptr<Connection> upstream;
+    std::variant<ClientResponse, Error> result = Error::WRITE_ERROR;
+
+    while (true) {
+        upstream = client.take_idle();
+        bool reused = upstream != nullptr;
+
+        if (!reused) {
+            std::variant<std::unique_ptr<Connection>, Error> conn =
+                co_await client.connect();
+
+            if (const auto *error = std::get_if<Error>(&conn)) {
+                co_await respond_with_error(
+                    res,
+                    *error == Error::CONNECTION_TIMED_OUT
+                        ? StatusCode::GATEWAY_TIMEOUT
+                        : StatusCode::BAD_GATEWAY
+                );
+                co_return;
+            }
+
+            upstream = std::move(std::get<std::unique_ptr<Connection>>(conn));
+        }
+
+        ConnectionWriter &writer = upstream->writer();
+        std::optional<Error> error = co_await writer.write(head);
+
+        if (!error && !(error = co_await writer.write(buffered_body))) {
+            error = co_await writer.flush();
+        }
+
+        if (!error && unread_body_size > 0) {
+            if (!(error = co_await body.send_pending_continue())) {
+                error = co_await splice_between(
+                    body.fixed_fd(),
+                    writer.fixed_fd(),
+                    unread_body_size
+                );
+            }
+
+            // The client went away or stalled before the end of its body,
+            // which cannot be received again.
+            if (error && *error != Error::WRITE_ERROR) {
+                client.release(std::move(upstream), false);
+                res.close_connection();
+                co_return;
+            }
+        }
+
+        if (!error) {
+            result = co_await ClientResponse::receive_head(upstream->reader());
+
+            if (std::holds_alternative<ClientResponse>(result)) {
+                break;
+            }
+
+            error = std::get<Error>(result);
+        }
+
+        client.release(std::move(upstream), false);
+        bool stale = *error == Error::WRITE_ERROR ||
+            *error == Error::READ_ERROR || *error == Error::CONNECTION_CLOSED;
+
+        if (!reused || !stale || !replayable ||
+            !http_utils::is_idempotent_method(req.method())) {
+            co_await respond_with_error(
+                res,
+                *error == Error::CONNECTION_TIMED_OUT
+                    ? StatusCode::GATEWAY_TIMEOUT
+                    : StatusCode::BAD_GATEWAY
+            );
+            res.close_connection();
+            co_return;
+        }
+    }
+
+    const auto &response = std::get<ClientResponse>(result);
+    std::optional<ClientResponse::BodyFraming> framing{
+        ClientResponse::BodyFraming{ClientResponse::BodyFraming::CONTENT_LENGTH}
+    };
+
+    if (response.has_body(req.method()) &&
+        !(framing = response.body_framing())) {
+        client.release(std::move(upstream), false);
+        co_await respond_with_error(res, StatusCode::BAD_GATEWAY);
+        co_return;
+    }
+
+    // HTTP/1.0 clients get the decoded body, delimited by closing the
+    // connection.
+    bool chunked = framing->kind == ClientResponse::BodyFraming::CHUNKED;
+    bool keep_framing = chunked && req.http_version().minor >= 1;
+    bool close_after = framing->kind ==
+            ClientResponse::BodyFraming::UNTIL_CLOSE ||
+        (chunked && !keep_framing);
+
+    if (close_after) {
+        res.close_connection();
+    }
+
+    res.disable_compression();
+    std::optional<Error> error = co_await res.write_status(
+        static_cast<StatusCode>(response.status_code())
+    );
+
+    for (const auto &[name, values] : response.headers()) {
+        if (error || is_hop_by_hop(name, req.headers())) {
+            continue;
+        }
+
+        for (std::string_view value : values) {
+            if (!error) {
+                error = co_await res.write_header(name, value);
+            }
+        }
+    }
+
+    if (!error && keep_framing) {
+        error =
+            co_await res.write_header(headers::TRANSFER_ENCODING, "chunked");
+    }
+
+    if (!error && close_after) {
+        error = co_await res.write_header(headers::CONNECTION, "close");
+    }
+
+    if (!error) {
+        error = co_await res.end_headers();
+    }
+
+    ConnectionReader &reader = upstream->reader();
+    ConnectionWriter &writer = res.connection_writer();
+
+    if (!error) {
+        switch (framing->kind) {
+        case ClientResponse::BodyFraming::CONTENT_LENGTH:
+            error = co_await forward_body(reader, writer, framing->length);
+            break;
+        case ClientResponse::BodyFraming::CHUNKED:
+            error = co_await forward_chunked_body(reader, writer, keep_framing);
+            break;
+        case ClientResponse::BodyFraming::UNTIL_CLOSE:
+            error = co_await forward_body(reader, writer, std::nullopt);
+            break;
+        }
+    }
+
+    if (!error) {
+        error = co_await res.send();
+    }
+
+    bool reusable = !error && response.keep_alive() &&
+        framing->kind != ClientResponse::BodyFraming::UNTIL_CLOSE;
+    client.release(std::move(upstream), reusable);
+
+    // The head may already be on its way, so the client can only tell that
+    // the response is incomplete by the connection closing.
+    if (error) {
+        res.close_connection();
+    }
+}
+
+} // namespace co_http_uring
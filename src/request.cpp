@@ -3,18 +3,18 @@
 
 #include "co_http_uring/request.hpp"
 
+#include "co_http_uring/compression.hpp"
 #include "co_http_uring/connection_reader.hpp"
 #include "co_http_uring/error.hpp"
-#include "co_http_uring/headers.hpp"
+#include "co_http_uring/header_map.hpp"
 #include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/known_headers.hpp"
 #include "co_http_uring/task.hpp"
 #include "co_http_uring/types.hpp"
 
 #include <algorithm>
-#include <charconv>
-#include <compare>
 #include <coroutine>
-#include <system_error>
+#include <memory_resource>
 
 namespace co_http_uring {
 
@@ -48,12 +48,6 @@ std::optional<RequestLine> split_request_line(std::string_view line) {
 
 } // namespace
 
-void Request::add_header(std::string_view name, std::string_view value) {
-    headers_
-        .emplace(http_utils::make_header_name(name), std::vector<std::string>())
-        .first->second.emplace_back(http_utils::make_header_value(value));
-}
-
 Task<std::optional<Error>> Request::read_request_line(ConnectionReader &reader
 ) {
     std::variant<std::string_view, Error> line = co_await reader.read_line();
@@ -62,6 +56,11 @@ Task<std::optional<Error>> Request::read_request_line(ConnectionReader &reader
         co_return *error;
     }
 
+    if (std::get<std::string_view>(line) ==
+        http_utils::HTTP2_PREFACE_REQUEST_LINE) {
+        co_return Error::HTTP2_PREFACE;
+    }
+
     std::optional<RequestLine> opt_request_line =
         split_request_line(std::get<std::string_view>(line));
 
@@ -97,25 +96,6 @@ Task<std::optional<Error>> Request::read_request_line(ConnectionReader &reader
     co_return {};
 }
 
-bool Request::parse_header_line(std::string_view line) {
-    auto header_name_end = std::find(line.cbegin(), line.cend(), ':');
-
-    if (header_name_end == line.cend()) {
-        return false;
-    }
-
-    std::string_view header_name{line.cbegin(), header_name_end};
-    std::string_view header_value{header_name_end + 1, line.cend()};
-
-    if (!http_utils::is_token(header_name) ||
-        !http_utils::is_field_value(header_value)) {
-        return false;
-    }
-
-    add_header(header_name, {header_name_end + 1, line.cend()});
-    return true;
-}
-
 Task<std::optional<Error>> Request::read_headers(ConnectionReader &reader) {
     std::variant<std::string_view, Error> result = co_await reader.read_line();
 
@@ -126,7 +106,7 @@ Task<std::optional<Error>> Request::read_headers(ConnectionReader &reader) {
     auto line = std::get<std::string_view>(result);
 
     while (!line.empty()) {
-        if (!parse_header_line(line)) {
+        if (!parse_header_line(headers_, line)) {
             co_return Error::INVALID_REQUEST;
         }
 
@@ -139,56 +119,41 @@ Task<std::optional<Error>> Request::read_headers(ConnectionReader &reader) {
         line = std::get<std::string_view>(result);
     }
 
-    if (http_version_.minor >= 1 && !contains_header(headers::HOST)) {
+    if (http_version_.minor >= 1 && !contains_header(Header::HOST)) {
         co_return Error::INVALID_REQUEST;
     }
 
     co_return {};
 }
 
-bool Request::parse_content_length() {
-    auto opt_values = get_header(headers::CONTENT_LENGTH);
-
-    if (!opt_values) {
-        return true;
-    }
-
-    const std::vector<std::string> &values = *opt_values;
-    const std::string &value = values[0];
-
-    if (!http_utils::is_number(value)) {
-        return false;
-    }
-
-    const char *value_first = value.cbegin().base();
-    const char *value_last = value.cend().base();
-    auto result = std::from_chars(value_first, value_last, content_length_);
-
-    if (result.ptr != value_last || result.ec != std::errc{0}) {
-        return false;
-    }
-
-    for (auto it = values.cbegin() + 1; it < values.cend(); it++) {
-        if (*it != value) {
-            return false;
-        }
-    }
-
-    return true;
-}
-
-Task<std::variant<Request, Error>> Request::receive(ConnectionReader &reader) {
-    Request request;
+Task<std::variant<Request, Error>> Request::receive(
+    ConnectionReader &reader,
+    std::pmr::memory_resource *resource
+) {
+    Request request{resource};
     std::optional<Error> error = co_await request.read_request_line(reader);
 
     if (error || (error = co_await request.read_headers(reader))) {
         co_return *error;
     }
 
-    if (!request.parse_content_length()) {
+    if (!parse_content_length(request.headers_, request.content_length_)) {
         co_return Error::INVALID_REQUEST;
     }
 
+    if (auto accept_encoding = request.get_header(Header::ACCEPT_ENCODING)) {
+        request.accepted_encoding_ =
+            negotiate_content_encoding(*accept_encoding);
+    }
+
+    if (auto expect = request.get_header(Header::EXPECT)) {
+        request.expects_continue_ = request.http_version_.minor >= 1 &&
+            request.content_length_ > 0 &&
+            std::ranges::any_of(expect->get(), [](std::string_view value) {
+                return http_utils::equals_ignore_case(value, "100-continue");
+            });
+    }
+
     request.body_ = &reader;
     request.keep_alive_ = request.http_version_.minor >= 1;
     co_return request;
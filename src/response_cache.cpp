@@ -0,0 +1,202 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/response_cache.hpp"
+
+#include "co_http_uring/compression.hpp"
+#include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/request.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace co_http_uring {
+
+namespace {
+
+// Rough per-entry bookkeeping cost of the map node, LRU node and shared
+// response string.
+constexpr std::size_t ENTRY_OVERHEAD = 160;
+
+std::size_t entry_size(std::string_view key, std::string_view response) {
+    return key.size() + response.size() + ENTRY_OVERHEAD;
+}
+
+} // namespace
+
+void ResponseCache::Shard::erase(EntryMap::iterator it) {
+    size_ -= entry_size(it->first, *it->second.response);
+    lru_.erase(it->second.lru_it);
+    entries_.erase(it);
+}
+
+std::shared_ptr<const std::string>
+ResponseCache::Shard::find(std::string_view key) {
+    std::lock_guard lock{mutex_};
+    auto it = entries_.find(key);
+
+    if (it == entries_.end()) {
+        stats_.misses++;
+        return {};
+    }
+
+    if (it->second.expiry <= Clock::now()) {
+        erase(it);
+        stats_.expirations++;
+        stats_.misses++;
+        return {};
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    stats_.hits++;
+    return it->second.response;
+}
+
+void ResponseCache::Shard::insert(
+    std::string_view key,
+    std::string_view response,
+    Clock::duration ttl
+) {
+    std::size_t size = entry_size(key, response);
+
+    if (size > capacity_) {
+        return;
+    }
+
+    std::lock_guard lock{mutex_};
+
+    if (auto it = entries_.find(key); it != entries_.end()) {
+        erase(it);
+    }
+
+    while (size_ + size > capacity_) {
+        erase(lru_.back());
+        stats_.evictions++;
+    }
+
+    auto it = entries_
+                  .emplace(
+                      key,
+                      Entry{
+                          .response =
+                              std::make_shared<const std::string>(response),
+                          .expiry = Clock::now() + ttl,
+                          .lru_it = {},
+                      }
+                  )
+                  .first;
+    lru_.push_front(it);
+    it->second.lru_it = lru_.begin();
+    size_ += size;
+    stats_.insertions++;
+}
+
+ResponseCache::ResponseCache(
+    std::size_t shard_capacity,
+    std::vector<std::string> key_headers
+) :
+    shard_capacity_{shard_capacity},
+    key_headers_{std::move(key_headers)} {
+    std::transform(
+        key_headers_.cbegin(),
+        key_headers_.cend(),
+        key_headers_.begin(),
+        http_utils::make_header_name
+    );
+}
+
+ResponseCache::Shard &ResponseCache::add_shard() {
+    std::lock_guard lock{shards_mutex_};
+    return shards_.emplace_back(shard_capacity_);
+}
+
+void ResponseCache::remove_shard(Shard &shard) {
+    std::lock_guard lock{shards_mutex_};
+    shards_.remove_if([&shard](const Shard &other) {
+        return &other == &shard;
+    });
+}
+
+bool ResponseCache::is_cacheable(const Request &req) const {
+    // Upgrades, such as WebSocket handshakes, always reach the handler.
+    return (req.method() == "GET" || req.method() == "HEAD") &&
+        req.content_length() == 0 && !req.contains_header(Header::UPGRADE);
+}
+
+std::string ResponseCache::make_key(const Request &req) const {
+    std::string key{req.method()};
+    key += ' ';
+    key += req.target();
+    key += " HTTP/1.";
+    key += static_cast<char>('0' + req.http_version().minor);
+    key += ' ';
+    key += content_encoding_name(req.accepted_encoding());
+
+    for (const std::string &name : key_headers_) {
+        key += "\r\n";
+        key += name;
+        key += ':';
+
+        if (auto values = req.get_header(name)) {
+            for (std::string_view value : values->get()) {
+                key += ' ';
+                key += value;
+            }
+        }
+    }
+
+    return key;
+}
+
+std::size_t ResponseCache::invalidate_prefix(std::string_view prefix) {
+    std::lock_guard shards_lock{shards_mutex_};
+    std::size_t count = 0;
+
+    for (Shard &shard : shards_) {
+        std::lock_guard lock{shard.mutex_};
+        auto it = shard.entries_.lower_bound(prefix);
+
+        while (it != shard.entries_.end() && it->first.starts_with(prefix)) {
+            shard.erase(it++);
+            shard.stats_.invalidations++;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+std::size_t ResponseCache::invalidate_target_prefix(std::string_view prefix) {
+    std::size_t count = 0;
+
+    // The only methods that is_cacheable() accepts.
+    for (std::string_view method : {"GET ", "HEAD "}) {
+        std::string key_prefix{method};
+        key_prefix += prefix;
+        count += invalidate_prefix(key_prefix);
+    }
+
+    return count;
+}
+
+ResponseCache::Stats ResponseCache::stats() {
+    std::lock_guard shards_lock{shards_mutex_};
+    Stats total{};
+
+    for (Shard &shard : shards_) {
+        std::lock_guard lock{shard.mutex_};
+        total.hits += shard.stats_.hits;
+        total.misses += shard.stats_.misses;
+        total.insertions += shard.stats_.insertions;
+        total.evictions += shard.stats_.evictions;
+        total.expirations += shard.stats_.expirations;
+        total.invalidations += shard.stats_.invalidations;
+    }
+
+    return total;
+}
+
+} // namespace co_http_uring
@@ -3,18 +3,94 @@
 
 #include "co_http_uring/response_writer.hpp"
 
+#include "co_http_uring/compression.hpp"
 #include "co_http_uring/connection_writer.hpp"
 #include "co_http_uring/error.hpp"
 #include "co_http_uring/headers.hpp"
+#include "co_http_uring/http2.hpp"
 #include "co_http_uring/http_utils.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/request.hpp"
+#include "co_http_uring/response_cache.hpp"
 #include "co_http_uring/status_code.hpp"
 #include "co_http_uring/task.hpp"
+#include "co_http_uring/websocket.hpp"
 
+#include <algorithm>
 #include <coroutine>
+#include <span>
 #include <string>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace co_http_uring {
 
+namespace {
+
+// Chunk sizes are written as four zero-padded hex digits, which is enough for
+// any chunk that fits in the connection writer's buffer.
+constexpr std::size_t CHUNK_SIZE_DIGITS = 4;
+constexpr std::string_view CHUNK_SEPARATOR = "\r\n";
+constexpr std::size_t CHUNK_OVERHEAD =
+    CHUNK_SIZE_DIGITS + 2 * CHUNK_SEPARATOR.size();
+constexpr std::size_t MIN_CHUNK_SIZE = 256;
+constexpr std::string_view LAST_CHUNK = "0\r\n\r\n";
+constexpr std::string_view CHUNKED = "chunked";
+
+constexpr std::string_view WEBSOCKET_HANDSHAKE_HEAD =
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Accept: ";
+
+constexpr std::size_t MAX_POOLED_DEFLATERS = 16;
+
+thread_local std::vector<Deflater> deflater_pool;
+
+Deflater acquire_deflater(ContentEncoding encoding, int level) {
+    auto it = std::find_if(
+        deflater_pool.begin(),
+        deflater_pool.end(),
+        [&](const Deflater &deflater) {
+            return deflater.encoding() == encoding && deflater.level() == level;
+        }
+    );
+
+    if (it == deflater_pool.end()) {
+        return {encoding, level};
+    }
+
+    Deflater deflater = std::move(*it);
+    *it = std::move(deflater_pool.back());
+    deflater_pool.pop_back();
+    return deflater;
+}
+
+void release_deflater(Deflater &&deflater) {
+    if (deflater_pool.size() < MAX_POOLED_DEFLATERS) {
+        deflater.reset();
+        deflater_pool.push_back(std::move(deflater));
+    }
+}
+
+void write_chunk_size(std::span<u8> dst, std::size_t size) {
+    constexpr std::string_view HEX_DIGITS = "0123456789abcdef";
+
+    for (std::size_t i = CHUNK_SIZE_DIGITS; i > 0; i--) {
+        dst[i - 1] = HEX_DIGITS[size & 0xf];
+        size >>= 4;
+    }
+
+    std::copy(
+        CHUNK_SEPARATOR.cbegin(),
+        CHUNK_SEPARATOR.cend(),
+        dst.begin() + CHUNK_SIZE_DIGITS
+    );
+}
+
+} // namespace
+
 ResponseWriter::ResponseWriter(
     ConnectionWriter &writer,
     int http_minor_version
@@ -24,11 +100,133 @@ ResponseWriter::ResponseWriter(
     state_{State::STATUS_LINE} {
 }
 
+ResponseWriter::ResponseWriter(Http2Stream &stream) :
+    writer_{&stream.writer()},
+    stream_{&stream},
+    http_minor_version_{1},
+    state_{State::STATUS_LINE} {
+}
+
+void ResponseWriter::insert_into_cache() {
+    // Only responses that were serialized in one piece into the writer's
+    // buffer can be cached.
+    if (!cache_shard_ || !cache_ttl_ ||
+        writer_->flush_count() != cache_flush_count_) {
+        return;
+    }
+
+    std::string_view response = writer_->buffered().substr(cache_begin_);
+    cache_shard_->insert(cache_key_, response, *cache_ttl_);
+}
+
+Task<std::optional<Error>> ResponseWriter::end_header_section() {
+    // An HTTP/2 stream sends its header section along with the first part
+    // of its body.
+    if (stream_) {
+        co_return {};
+    }
+
+    co_return co_await writer_->write_line();
+}
+
+Task<std::optional<Error>>
+ResponseWriter::write_content_encoding_headers(ContentEncoding encoding) {
+    if (encoding != ContentEncoding::IDENTITY) {
+        std::optional<Error> error = co_await write_header(
+            headers::CONTENT_ENCODING,
+            content_encoding_name(encoding)
+        );
+
+        if (error) {
+            co_return error;
+        }
+    }
+
+    if (!compression_options_ && encoding == ContentEncoding::IDENTITY) {
+        co_return {};
+    }
+
+    co_return co_await write_header(headers::VARY, headers::ACCEPT_ENCODING);
+}
+
+Task<std::optional<Error>>
+ResponseWriter::write_streamed_compressed_body(std::string_view body) {
+    bool chunked = stream_ == nullptr;
+    std::size_t chunk_overhead = chunked ? CHUNK_OVERHEAD : 0;
+    std::optional<Error> error =
+        co_await write_content_encoding_headers(content_encoding_);
+
+    if (error ||
+        (chunked && (error = co_await write_header(
+                         headers::TRANSFER_ENCODING,
+                         CHUNKED
+                     ))) ||
+        (error = co_await end_header_section())) {
+        co_return error;
+    }
+
+    Deflater deflater =
+        acquire_deflater(content_encoding_, compression_options_->level);
+    deflater.set_input(body);
+    bool finished = false;
+
+    while (!finished) {
+        std::span<u8> space = writer_->spare_capacity();
+
+        if (space.size() >= chunk_overhead + MIN_CHUNK_SIZE) {
+            std::span<u8> chunk = space.subspan(
+                chunked ? CHUNK_SIZE_DIGITS + CHUNK_SEPARATOR.size() : 0,
+                space.size() - chunk_overhead
+            );
+            auto [bytes_written, done] = deflater.deflate(chunk, true);
+            finished = done;
+
+            if (bytes_written > 0) {
+                if (chunked) {
+                    write_chunk_size(space, bytes_written);
+                    std::copy(
+                        CHUNK_SEPARATOR.cbegin(),
+                        CHUNK_SEPARATOR.cend(),
+                        chunk.begin() + bytes_written
+                    );
+                }
+
+                writer_->commit(bytes_written + chunk_overhead);
+                continue;
+            }
+        }
+
+        if (!finished && (error = co_await writer_->flush())) {
+            co_return error;
+        }
+    }
+
+    release_deflater(std::move(deflater));
+
+    if (chunked && (error = co_await writer_->write(LAST_CHUNK))) {
+        co_return error;
+    }
+
+    insert_into_cache();
+    state_ = State::STATUS_LINE;
+    body_written_ = true;
+    co_return {};
+}
+
 Task<std::optional<Error>> ResponseWriter::write_status(StatusCode code) {
     if (state_ != State::STATUS_LINE) {
         co_return Error::UNEXPECTED_RESPONSE_STATE;
     }
 
+    if (stream_) {
+        stream_->set_status(code);
+        state_ = State::HEADERS;
+        co_return {};
+    }
+
+    cache_begin_ = writer_->buffered().size();
+    cache_flush_count_ = writer_->flush_count();
+
     std::string base_status_line{http_utils::HTTP_1_VERSION_PREFIX};
     base_status_line += static_cast<char>(http_minor_version_ + '0');
     base_status_line += " ";
@@ -52,6 +250,11 @@ ResponseWriter::write_header(std::string_view name, std::string_view value) {
         co_return Error::UNEXPECTED_RESPONSE_STATE;
     }
 
+    if (stream_) {
+        stream_->add_header(name, value);
+        co_return {};
+    }
+
     std::optional<Error> error = co_await writer_->write(name);
 
     if (error || (error = co_await writer_->write(": "))) {
@@ -66,21 +269,103 @@ Task<std::optional<Error>> ResponseWriter::write_body(std::string_view body) {
         co_return Error::UNEXPECTED_RESPONSE_STATE;
     }
 
-    std::optional<Error> error = co_await write_header(
-        headers::CONTENT_LENGTH,
-        std::to_string(body.size())
-    );
+    if (content_encoding_ == ContentEncoding::IDENTITY ||
+        body.size() < compression_options_->min_size) {
+        co_return co_await write_encoded_body(body, ContentEncoding::IDENTITY);
+    }
+
+    if (http_minor_version_ == 0) {
+        // HTTP/1.0 has no chunked transfer coding, so the compressed body has
+        // to be complete before its length can be sent.
+        std::string compressed =
+            compress(body, content_encoding_, compression_options_->level);
+        co_return co_await write_encoded_body(compressed, content_encoding_);
+    }
+
+    co_return co_await write_streamed_compressed_body(body);
+}
+
+Task<std::optional<Error>> ResponseWriter::write_encoded_body(
+    std::string_view body,
+    ContentEncoding encoding
+) {
+    if (state_ != State::HEADERS) {
+        co_return Error::UNEXPECTED_RESPONSE_STATE;
+    }
+
+    std::optional<Error> error =
+        co_await write_content_encoding_headers(encoding);
+
+    if (error || (error = co_await write_header(
+                      headers::CONTENT_LENGTH,
+                      std::to_string(body.size())
+                  ))) {
+        co_return error;
+    }
 
-    if (error || (error = co_await writer_->write_line()) ||
+    if ((error = co_await end_header_section()) ||
         (error = co_await writer_->write(body))) {
-        co_return *error;
+        co_return error;
     }
 
+    insert_into_cache();
     state_ = State::STATUS_LINE;
+    body_written_ = true;
     co_return {};
 }
 
+Task<std::optional<Error>> ResponseWriter::end_headers() {
+    if (state_ != State::HEADERS) {
+        co_return Error::UNEXPECTED_RESPONSE_STATE;
+    }
+
+    std::optional<Error> error = co_await end_header_section();
+
+    if (!error) {
+        state_ = State::STATUS_LINE;
+    }
+
+    co_return error;
+}
+
+Task<std::variant<WebSocket, Error>> ResponseWriter::accept_websocket(
+    const Request &request,
+    std::size_t max_message_size
+) {
+    if (state_ != State::STATUS_LINE || stream_ != nullptr) {
+        co_return Error::UNEXPECTED_RESPONSE_STATE;
+    }
+
+    if (!WebSocket::is_upgrade_request(request)) {
+        co_return Error::INVALID_REQUEST;
+    }
+
+    std::string accept_key = WebSocket::make_accept_key(
+        request.get_header(Header::SEC_WEBSOCKET_KEY)->get().front()
+    );
+    std::optional<Error> error;
+
+    if ((error = co_await writer_->write(WEBSOCKET_HANDSHAKE_HEAD)) ||
+        (error = co_await writer_->write_line(accept_key)) ||
+        (error = co_await writer_->write_line("")) ||
+        (error = co_await writer_->flush())) {
+        co_return *error;
+    }
+
+    // The connection outlives the response, so only the write timeout and
+    // the minimum send rate bound it from here.
+    writer_->finish_response();
+    writer_->request_close();
+    co_return WebSocket{request.body(), *writer_, max_message_size};
+}
+
 Task<std::optional<Error>> ResponseWriter::send() {
+    // A complete response is sent along with the end of its stream once the
+    // handler returns.
+    if (stream_ != nullptr && body_written_) {
+        co_return {};
+    }
+
     co_return co_await writer_->flush();
 }
 
@@ -3,31 +3,51 @@
 
 #include "co_http_uring/server.hpp"
 
+#include "co_http_uring/admission_controller.hpp"
+#include "co_http_uring/buffer_ring.hpp"
 #include "co_http_uring/connection.hpp"
+#include "co_http_uring/connection_balancer.hpp"
 #include "co_http_uring/connection_reader.hpp"
 #include "co_http_uring/connection_writer.hpp"
 #include "co_http_uring/error.hpp"
 #include "co_http_uring/eventfd.hpp"
+#include "co_http_uring/http2.hpp"
 #include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/listen_socket.hpp"
+#include "co_http_uring/operation_future.hpp"
+#include "co_http_uring/probes.hpp"
 #include "co_http_uring/request.hpp"
+#include "co_http_uring/response_cache.hpp"
 #include "co_http_uring/response_writer.hpp"
 #include "co_http_uring/socket_address.hpp"
+#include "co_http_uring/socket_options.hpp"
 #include "co_http_uring/task.hpp"
-#include "co_http_uring/tcp_socket.hpp"
+#include "co_http_uring/trace.hpp"
 #include "co_http_uring/types.hpp"
 
 #include <fmt/core.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 #include <system_error>
 #include <utility>
 #include <variant>
+#include <vector>
 
 extern "C" {
+#include <linux/time_types.h>
 #include <sys/eventfd.h>
 }
 
@@ -38,10 +58,20 @@ namespace co_http_uring {
 namespace {
 
 constexpr std::chrono::seconds DEFAULT_READ_TIMEOUT = 30s;
+constexpr std::chrono::seconds DEFAULT_WRITE_TIMEOUT = 30s;
 constexpr u64 DEFAULT_MAX_REQUEST_PRE_BODY_SIZE = 1024 * 1024;
+constexpr unsigned int DEFAULT_RUN_BUDGET = 64;
+constexpr std::chrono::milliseconds HANDOFF_DRAIN_INTERVAL = 1ms;
 
 constexpr i64 SQE_DATA_STOP = -1;
-constexpr i64 SQE_DATA_ACCEPT = -2;
+constexpr i64 SQE_DATA_WAKE = -2;
+constexpr i64 SQE_DATA_HANDOFF = -3;
+constexpr i64 SQE_DATA_SOCKET_OPTION = -4;
+constexpr i64 SQE_DATA_CANCEL = -5;
+
+// Accept CQEs of the listener at index `i` are tagged SQE_DATA_ACCEPT - i.
+constexpr i64 SQE_DATA_ACCEPT = -16;
+constexpr std::size_t MAX_LISTENERS = 64;
 
 constexpr std::string_view INVALID_REQUEST_RESPONSE =
     "HTTP/1.1 400 Bad Request\r\n"
@@ -54,30 +84,130 @@ thread_local Server *Server::thread_instance_ = nullptr;
 
 Server::Server(RequestHandler handler, unsigned int sq_entries) :
     read_timeout_{DEFAULT_READ_TIMEOUT},
+    write_timeout_{DEFAULT_WRITE_TIMEOUT},
     max_request_pre_body_size_{DEFAULT_MAX_REQUEST_PRE_BODY_SIZE},
+    run_budget_{DEFAULT_RUN_BUDGET},
     handler_{std::move(handler)},
     ring_{sq_entries},
-    stop_eventfd_{0, EFD_CLOEXEC} {
+    stop_eventfd_{0, EFD_CLOEXEC},
+    wake_eventfd_{0, EFD_CLOEXEC},
+    remote_ready_{std::make_unique<RemoteReadyQueue>()} {
+}
+
+Server::~Server() {
+    // A moved-from server has no cache, while the server it was moved to
+    // now owns the shard.
+    if (response_cache_ && response_cache_shard_) {
+        response_cache_->remove_shard(*response_cache_shard_);
+    }
 }
 
-void Server::submit_accept() {
+void Server::submit_accept(std::size_t listener) {
     IoUringSqe sqe = ring_.get_sqe();
-    socket_.prep_multishot_accept_direct(sqe);
-    sqe.set_data64(SQE_DATA_ACCEPT);
+    listeners_[listener].socket.prep_multishot_accept_direct(sqe);
+    sqe.set_data64(SQE_DATA_ACCEPT - static_cast<i64>(listener));
     ring_.submit();
+    listeners_[listener].accepting = true;
+}
+
+void Server::update_accepting() {
+    bool paused = !admission_controller_->update_accepting(tasks_.size());
+
+    if (paused == accept_paused_) {
+        return;
+    }
+
+    accept_paused_ = paused;
+
+    for (std::size_t i = 0; i < listeners_.size(); ++i) {
+        // A cancelled accept is submitted again once it has completed, if the
+        // server resumed accepting meanwhile.
+        if (paused && listeners_[i].accepting) {
+            cancel_operation(SQE_DATA_ACCEPT - static_cast<i64>(i));
+        } else if (!paused && !listeners_[i].accepting) {
+            submit_accept(i);
+        }
+    }
+}
+
+void Server::submit_wake_read() {
+    IoUringSqe sqe = ring_.get_sqe();
+    wake_eventfd_.prep_read(sqe, &wake_eventfd_value_);
+    sqe.set_data64(SQE_DATA_WAKE);
+    ring_.submit();
+}
+
+void Server::submit_connection_options(std::size_t listener, int fixed_fd) {
+    if (!ring_socket_options_) {
+        return;
+    }
+
+    // Submitted along with the connection's first SQE, which the kernel
+    // issues after these. The options outlive the SQEs in the listener.
+    for (SocketOption &option : listeners_[listener].connection_options) {
+        IoUringSqe sqe = ring_.get_sqe();
+        sqe.prep_cmd_sock(
+            SOCKET_URING_OP_SETSOCKOPT,
+            fixed_fd,
+            option.level,
+            option.name,
+            &option.value,
+            sizeof(option.value)
+        );
+        sqe.set_data64(SQE_DATA_SOCKET_OPTION);
+        sqe.set_flags(IOSQE_FIXED_FILE);
+    }
+}
+
+Task<bool>
+Server::serve_cached(std::string_view key, ConnectionWriter &writer) {
+    std::shared_ptr<const std::string> response =
+        response_cache_shard_->find(key);
+
+    if (!response) {
+        co_return false;
+    }
+
+    std::optional<Error> error = co_await writer.write(*response);
+
+    if (!error) {
+        co_await writer.flush();
+    }
+
+    co_return true;
 }
 
 Task<> Server::serve_connection(Connection conn) {
     ConnectionReader &reader = conn.reader();
     ConnectionWriter &writer = conn.writer();
     bool keep_alive = true;
+    reader.set_max_buffer_size(max_request_pre_body_size_);
 
     while (keep_alive) {
+        // Between requests, the connection holds no buffer unless the client
+        // has pipelined the next one, and whatever the last request allocated
+        // is freed at once.
+        reader.release_buffer();
         reader.set_bytes_remaining(max_request_pre_body_size_);
-        std::variant<Request, Error> result = co_await Request::receive(reader);
+        conn.release_arena();
+        std::variant<Request, Error> result =
+            co_await Request::receive(reader, &conn.arena());
 
         if (const auto *error = std::get_if<Error>(&result)) {
-            if (*error == Error::INVALID_REQUEST) {
+            if (*error == Error::HTTP2_PREFACE && h2c_) {
+                co_await Http2Connection{
+                    reader,
+                    writer,
+                    handler_,
+                    compression_,
+                    max_request_pre_body_size_,
+                }
+                    .serve({});
+                break;
+            }
+
+            if (*error == Error::INVALID_REQUEST ||
+                *error == Error::HTTP2_PREFACE) {
                 co_await writer.write(INVALID_REQUEST_RESPONSE);
                 co_await writer.flush();
             }
@@ -85,13 +215,157 @@ Task<> Server::serve_connection(Connection conn) {
             break;
         }
 
-        const auto &req = std::get<Request>(result);
+        auto &req = std::get<Request>(result);
+        trace::record(trace::Event::PARSE_DONE, conn.fixed_fd());
+        CO_HTTP_URING_PROBE5(
+            request,
+            conn.fixed_fd(),
+            req.method().data(),
+            req.method().size(),
+            req.target().data(),
+            req.target().size()
+        );
+
+        if (h2c_ && Http2Connection::is_upgrade_request(req)) {
+            co_await Http2Connection{
+                reader,
+                writer,
+                handler_,
+                compression_,
+                max_request_pre_body_size_,
+            }
+                .serve(std::move(req));
+            break;
+        }
+
+        // Shedding closes the connection, so that the body need not be read.
+        if (admission_controller_ && admission_controller_->shed_request()) {
+            trace::record(trace::Event::REQUEST_SHED, conn.fixed_fd());
+            co_await writer.write(admission_controller_->shed_response());
+            co_await writer.flush();
+            break;
+        }
+
         reader.set_bytes_remaining(req.content_length());
         keep_alive = req.keep_alive();
-        co_await handler_(req, {writer, std::min(req.http_version().minor, 1)});
+
+        if (req.expects_continue()) {
+            reader.expect_continue(writer);
+        }
+
+        writer.start_response();
+        ResponseWriter res{writer, std::min(req.http_version().minor, 1)};
+
+        if (compression_) {
+            res.set_compression(req.accepted_encoding(), *compression_);
+        }
+
+        trace::record(trace::Event::HANDLER_START, conn.fixed_fd());
+        CO_HTTP_URING_PROBE1(handler_start, conn.fixed_fd());
+        std::chrono::steady_clock::time_point handler_start;
+
+        if (admission_controller_) {
+            handler_start = std::chrono::steady_clock::now();
+        }
+
+        // A handler that throws may have sent part of its response, so the
+        // connection is closed after it.
+        try {
+            if (!response_cache_shard_ ||
+                !response_cache_->is_cacheable(req)) {
+                co_await handler_(req, std::move(res));
+            } else {
+                std::string cache_key = response_cache_->make_key(req);
+
+                if (!co_await serve_cached(cache_key, writer)) {
+                    res.set_cache(*response_cache_shard_, std::move(cache_key));
+                    co_await handler_(req, std::move(res));
+                }
+            }
+        } catch (const std::exception &e) {
+            fmt::print(stderr, "request handler threw: {}\n", e.what());
+            keep_alive = false;
+        }
+
+        trace::record(trace::Event::HANDLER_END, conn.fixed_fd());
+        CO_HTTP_URING_PROBE1(handler_end, conn.fixed_fd());
+
+        if (admission_controller_) {
+            admission_controller_->record_handler(
+                std::chrono::steady_clock::now() - handler_start
+            );
+        }
+
+        keep_alive = keep_alive && !writer.close_requested();
+
+        // The handler answered without asking for the body. The client may
+        // still send it, so the connection is closed rather than drained.
+        if (reader.continue_pending()) {
+            reader.cancel_continue();
+            keep_alive = false;
+        }
     }
 
+    conn.release_arena();
+    trace::record(trace::Event::CLOSE, conn.fixed_fd());
     co_await conn.close();
+    closed_conns_.push_back(conn.fixed_fd());
+}
+
+void Server::start_connection(int fixed_fd) {
+    files_[fixed_fd] = fixed_fd;
+    tasks_.emplace(fixed_fd, serve_connection(Connection(fixed_fd)));
+}
+
+Task<> Server::hand_off_connection(
+    int fixed_fd,
+    ConnectionBalancer::Member &target
+) {
+    // The target may have left since it was picked.
+    int target_ring_fd = target.ring_fd.load();
+    i64 key = allocate_operation_key();
+    i32 res = -EBADF;
+
+    if (target_ring_fd != -1) {
+        IoUringSqe sqe = ring_.get_sqe();
+        sqe.prep_msg_ring_fd(
+            target_ring_fd,
+            fixed_fd,
+            IORING_FILE_INDEX_ALLOC,
+            SQE_DATA_HANDOFF,
+            0
+        );
+        sqe.set_data64(key);
+        ring_.submit();
+        res = co_await OperationFuture(key);
+    }
+
+    connection_balancer_->finish_handoff(target);
+
+    if (res < 0) {
+        if (target_ring_fd != -1) {
+            const char *error = std::strerror(-res);
+            fmt::print(stderr, "conn handoff failed: {}\n", error);
+        }
+
+        target.connections.fetch_sub(1, std::memory_order_relaxed);
+        balancer_member_->connections.fetch_add(1, std::memory_order_relaxed);
+        start_connection(fixed_fd);
+        co_return;
+    }
+
+    // The target ring now has its own reference to the socket.
+    key = allocate_operation_key();
+    IoUringSqe sqe = ring_.get_sqe();
+    sqe.prep_close_direct(fixed_fd);
+    sqe.set_data64(key);
+    ring_.submit();
+
+    res = co_await OperationFuture(key);
+
+    if (res < 0) {
+        fmt::print(stderr, "handoff close failed: {}\n", std::strerror(-res));
+    }
 }
 
 void Server::handle_stop_cqe(const IoUringCqe &&cqe) {
@@ -104,72 +378,442 @@ void Server::handle_stop_cqe(const IoUringCqe &&cqe) {
     }
 }
 
-void Server::handle_accept_cqe(const IoUringCqe &&cqe) {
+void Server::handle_accept_cqe(
+    std::size_t listener,
+    const IoUringCqe &&cqe
+) {
     i32 res = cqe.res();
     u32 flags = cqe.flags();
     ring_.seen_cqe(cqe);
 
     if ((flags & IORING_CQE_F_MORE) == 0) {
-        submit_accept();
+        listeners_[listener].accepting = false;
+
+        if (!accept_paused_) {
+            submit_accept(listener);
+        }
+    }
+
+    if (res < 0) {
+        if (res != -ECANCELED) {
+            fmt::print(stderr, "accept CQE failed: {}\n", std::strerror(-res));
+        }
+
+        return;
+    }
+
+    trace::record(trace::Event::ACCEPT, res);
+    CO_HTTP_URING_PROBE1(accept, res);
+    submit_connection_options(listener, res);
+
+    if (balancer_member_) {
+        ConnectionBalancer::Member *target =
+            connection_balancer_->pick_target(*balancer_member_);
+
+        if (target) {
+            hand_off_connection(res, *target).detach();
+            return;
+        }
+
+        balancer_member_->connections.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    start_connection(res);
+
+    // Connections accepted before the cancellation takes effect are still
+    // served.
+    if (admission_controller_) {
+        update_accepting();
     }
+}
+
+void Server::handle_wake_cqe(const IoUringCqe &&cqe) {
+    i32 res = cqe.res();
+    ring_.seen_cqe(cqe);
 
     if (res < 0) {
-        fmt::print(stderr, "accept CQE failed: {}\n", std::strerror(-res));
+        const char *what = "wake CQE failed";
+        throw std::system_error(-res, std::generic_category(), what);
+    }
+
+    std::vector<std::coroutine_handle<>> coroutines;
+
+    {
+        std::lock_guard lock{remote_ready_->mutex};
+        coroutines.swap(remote_ready_->coroutines);
+    }
+
+    ready_.insert(ready_.end(), coroutines.begin(), coroutines.end());
+    submit_wake_read();
+}
+
+void Server::handle_handoff_cqe(const IoUringCqe &&cqe) {
+    i32 res = cqe.res();
+    ring_.seen_cqe(cqe);
+
+    // The sending server already counted the connection against this one.
+    if (res < 0) {
+        const char *error = std::strerror(-res);
+        fmt::print(stderr, "conn handoff CQE failed: {}\n", error);
+        balancer_member_->connections.fetch_sub(1, std::memory_order_relaxed);
         return;
     }
 
-    files_[res] = res;
-    tasks_.emplace(res, serve_connection(Connection(res)));
+    start_connection(res);
 }
 
-void Server::handle_coroutine_cqe(const IoUringCqe &&cqe) {
+void Server::handle_socket_option_cqe(const IoUringCqe &&cqe) {
     i32 res = cqe.res();
+    ring_.seen_cqe(cqe);
+
+    if (res >= 0) {
+        return;
+    }
+
+    if (res != -EOPNOTSUPP || !ring_socket_options_) {
+        fmt::print(stderr, "setsockopt CQE failed: {}\n", std::strerror(-res));
+        return;
+    }
+
+    // Kernels before 6.7 cannot set socket options through the ring. Linux
+    // copies these from the listening socket to the sockets it accepts.
+    ring_socket_options_ = false;
+
+    for (const Listener &listener : listeners_) {
+        for (const SocketOption &option : listener.connection_options) {
+            try {
+                listener.socket.set_option(option);
+            } catch (const std::system_error &e) {
+                fmt::print(stderr, "{}\n", e.what());
+            }
+        }
+    }
+}
+
+void Server::handle_cancel_cqe(const IoUringCqe &&cqe) {
+    // The operation may have completed before it could be cancelled, which
+    // fails the cancellation with -ENOENT or -EALREADY. Either way, it
+    // completes on its own.
+    ring_.seen_cqe(cqe);
+}
+
+void Server::handle_coroutine_cqe(const IoUringCqe &&cqe) {
+    auto key = static_cast<i64>(cqe.get_data64());
+    auto it = coroutines_.find(key);
+
+    // Completions of disarmed deadlines and of linked timeouts have no
+    // coroutine to resume. Neither should anything keyed by a fixed fd, except
+    // an operation that was cancelled after its coroutine stopped awaiting it.
+    if (it == coroutines_.end()) {
+        if (key >= 0 && cqe.res() != -ECANCELED) {
+            fmt::print(stderr, "no coroutine awaits the CQE of fd {}\n", key);
+        }
 
-    if (res == -ECANCELED) {
         ring_.seen_cqe(cqe);
         return;
     }
 
-    int client_fixed_fd = static_cast<int>(cqe.get_data64());
-    std::coroutine_handle<> coroutine = coroutines_.at(client_fixed_fd);
-    coroutine.resume();
+    it->second.resume();
+    reap_closed_conns();
+}
+
+void Server::reap_closed_conns() {
+    for (int fixed_fd : closed_conns_) {
+        files_[fixed_fd] = -1;
+        tasks_.erase(fixed_fd);
+    }
+
+    if (balancer_member_ && !closed_conns_.empty()) {
+        balancer_member_->connections.fetch_sub(
+            closed_conns_.size(),
+            std::memory_order_relaxed
+        );
+    }
+
+    closed_conns_.clear();
+}
+
+void Server::handle_cqe(IoUringCqe &&cqe) {
+    i64 data = static_cast<i64>(cqe.get_data64());
+
+    if (data <= SQE_DATA_ACCEPT &&
+        data > SQE_DATA_ACCEPT - static_cast<i64>(MAX_LISTENERS)) {
+        handle_accept_cqe(SQE_DATA_ACCEPT - data, std::move(cqe));
+        return;
+    }
+
+    switch (data) {
+    case SQE_DATA_STOP: handle_stop_cqe(std::move(cqe)); break;
+    case SQE_DATA_WAKE: handle_wake_cqe(std::move(cqe)); break;
+    case SQE_DATA_HANDOFF: handle_handoff_cqe(std::move(cqe)); break;
+    case SQE_DATA_SOCKET_OPTION:
+        handle_socket_option_cqe(std::move(cqe));
+        break;
+    case SQE_DATA_CANCEL: handle_cancel_cqe(std::move(cqe)); break;
+    default: handle_coroutine_cqe(std::move(cqe)); break;
+    }
+}
+
+std::optional<IoUringCqe>
+Server::spin_for_cqe(std::chrono::nanoseconds duration) {
+    auto deadline = std::chrono::steady_clock::now() + duration;
+
+    do {
+        if (std::optional<IoUringCqe> cqe = ring_.try_peek_cqe()) {
+            return cqe;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+
+    return std::nullopt;
+}
+
+IoUringCqe Server::wait_for_cqe() {
+    switch (wait_policy_.mode) {
+    case WaitPolicy::Mode::BLOCK: break;
+    case WaitPolicy::Mode::BATCH: {
+        IoUringCqe cqe = ring_.wait_cqe();
+
+        // The first completion stays at the head of the queue meanwhile.
+        if (ring_.cq_ready() < wait_policy_.min_completions) {
+            ring_.wait_cqes(
+                wait_policy_.min_completions,
+                wait_policy_.max_wait
+            );
+        }
+
+        return cqe;
+    }
+    case WaitPolicy::Mode::SPIN:
+        if (auto cqe = spin_for_cqe(wait_policy_.spin_duration)) {
+            return std::move(*cqe);
+        }
+
+        break;
+    case WaitPolicy::Mode::ADAPTIVE: {
+        std::optional<IoUringCqe> cqe;
+
+        if (average_wakeup_gap_ <= wait_policy_.spin_duration) {
+            cqe = spin_for_cqe(wait_policy_.spin_duration);
+        }
+
+        if (!cqe) {
+            cqe = ring_.wait_cqe();
+        }
+
+        // An exponential moving average of the time between wakeups, with a
+        // weight of 1/8 for the latest gap.
+        auto now = std::chrono::steady_clock::now();
+        average_wakeup_gap_ += (now - last_wakeup_ - average_wakeup_gap_) / 8;
+        last_wakeup_ = now;
+        return std::move(*cqe);
+    }
+    }
+
+    return ring_.wait_cqe();
+}
+
+unsigned int Server::handle_cqes() {
+    unsigned int handled = 0;
+    std::optional<IoUringCqe> first_cqe;
+
+    // Only wait when there is nothing else to do.
+    if (ready_.empty()) {
+        first_cqe = wait_for_cqe();
+    }
+
+    if (admission_controller_) {
+        busy_since_ = std::chrono::steady_clock::now();
+    }
+
+    if (first_cqe) {
+        handle_cqe(std::move(*first_cqe));
+        ++handled;
+    }
+
+    for (; handled < run_budget_; ++handled) {
+        std::optional<IoUringCqe> cqe = ring_.try_peek_cqe();
+
+        if (!cqe) {
+            break;
+        }
+
+        handle_cqe(std::move(*cqe));
+    }
+
+    return handled;
+}
+
+void Server::run_ready() {
+    // Coroutines that yield again while this runs wait for the next iteration.
+    std::size_t count = std::min<std::size_t>(ready_.size(), run_budget_);
 
-    if (!coroutines_.contains(client_fixed_fd)) {
-        files_[client_fixed_fd] = -1;
-        tasks_.erase(client_fixed_fd);
+    for (; count > 0; --count) {
+        std::coroutine_handle<> coroutine = ready_.front();
+        ready_.pop_front();
+        coroutine.resume();
+        reap_closed_conns();
     }
 }
 
-void Server::run(const Ipv4Address &address, int max_pending_conns) {
+void Server::listen(
+    const SocketAddress &address,
+    int max_pending_conns,
+    const SocketOptions &options
+) {
+    if (listeners_.size() == MAX_LISTENERS) {
+        throw std::length_error("too many listeners");
+    }
+
+    int family = address.family();
+    ListenSocket socket{family};
+
+    for (const auto &option : listener_socket_options(options, family)) {
+        socket.set_option(option);
+    }
+
+    socket.bind(address);
+    socket.listen(max_pending_conns);
+    listeners_.push_back({
+        std::move(socket),
+        max_pending_conns,
+        connection_socket_options(options, family),
+    });
+}
+
+void Server::run() {
+    if (listeners_.empty()) {
+        throw std::logic_error("no listeners");
+    }
+
     thread_instance_ = this;
+    last_wakeup_ = std::chrono::steady_clock::now();
 
-    socket_.bind(address);
-    socket_.listen(max_pending_conns);
+    if constexpr (trace::ENABLED) {
+        trace::start_thread();
+    }
+
+    if (response_cache_ && !response_cache_shard_) {
+        response_cache_shard_ = &response_cache_->add_shard();
+    }
+
+    if (connection_balancer_ && !balancer_member_) {
+        balancer_member_ = &connection_balancer_->join(ring_.fd());
+    }
+
+    int max_pending_conns = 0;
+
+    for (const Listener &listener : listeners_) {
+        max_pending_conns += listener.max_pending_conns;
+    }
 
     files_.resize(2 * max_pending_conns, -1);
     ring_.register_files(files_);
 
+    if (!buffer_ring_) {
+        buffer_ring_ = std::make_unique<BufferRing>(ring_, 0);
+    }
+
     IoUringSqe sqe = ring_.get_sqe();
     u64 stop_eventfd_value{};
     stop_eventfd_.prep_read(sqe, &stop_eventfd_value);
     sqe.set_data64(SQE_DATA_STOP);
 
-    submit_accept();
+    submit_wake_read();
 
-    while (stop_eventfd_value == 0) {
-        IoUringCqe cqe = ring_.wait_cqe();
-        i64 data = static_cast<i64>(cqe.get_data64());
+    for (std::size_t i = 0; i < listeners_.size(); ++i) {
+        submit_accept(i);
+    }
 
-        switch (data) {
-        case SQE_DATA_STOP: handle_stop_cqe(std::move(cqe)); break;
-        case SQE_DATA_ACCEPT: handle_accept_cqe(std::move(cqe)); break;
-        default: handle_coroutine_cqe(std::move(cqe)); break;
+    while (stop_eventfd_value == 0) {
+        unsigned int handled = handle_cqes();
+        run_ready();
+
+        if (admission_controller_) {
+            admission_controller_->record_loop(
+                handled,
+                std::chrono::steady_clock::now() - busy_since_
+            );
+            update_accepting();
         }
     }
 
+    if (balancer_member_) {
+        connection_balancer_->leave(*balancer_member_);
+        drain_handoffs();
+        balancer_member_ = nullptr;
+    }
+
     thread_instance_ = nullptr;
 }
 
+void Server::drain_handoffs() {
+    while (true) {
+        // Senders finish a handoff only once its CQE has been posted here.
+        bool sending = balancer_member_->handoffs.load() > 0;
+
+        while (std::optional<IoUringCqe> cqe = ring_.try_peek_cqe()) {
+            if (static_cast<i64>(cqe->get_data64()) != SQE_DATA_HANDOFF) {
+                handle_cqe(std::move(*cqe));
+                continue;
+            }
+
+            i32 res = cqe->res();
+            ring_.seen_cqe(*cqe);
+
+            // Nothing waits on the close, so the server drops its CQE.
+            if (res >= 0) {
+                IoUringSqe sqe = ring_.get_sqe();
+                sqe.prep_close_direct(res);
+                sqe.set_data64(allocate_operation_key());
+                ring_.submit();
+            }
+        }
+
+        if (!sending) {
+            return;
+        }
+
+        ring_.wait_cqes(1, HANDOFF_DRAIN_INTERVAL);
+    }
+}
+
+void Server::cancel_operation(i64 key) {
+    IoUringSqe sqe = ring_.get_sqe();
+    sqe.prep_cancel(key);
+    sqe.set_data64(SQE_DATA_CANCEL);
+    ring_.submit();
+}
+
+void Server::submit_linked_timeout(std::chrono::nanoseconds timeout) {
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    __kernel_timespec ts{
+        .tv_sec = seconds.count(),
+        .tv_nsec = (timeout - seconds).count(),
+    };
+
+    // Nothing waits on the timeout's own CQE, so the server drops it. The
+    // kernel copies `ts` on submission.
+    IoUringSqe sqe = ring_.get_sqe();
+    sqe.prep_link_timeout(&ts);
+    sqe.set_data64(allocate_operation_key());
+    ring_.submit();
+}
+
+void Server::schedule_remote(std::coroutine_handle<> coroutine) {
+    bool was_empty;
+
+    {
+        std::lock_guard lock{remote_ready_->mutex};
+        was_empty = remote_ready_->coroutines.empty();
+        remote_ready_->coroutines.push_back(coroutine);
+    }
+
+    // A non-empty queue already has a wakeup in flight.
+    if (was_empty) {
+        wake_eventfd_.write(1);
+    }
+}
+
 void Server::stop() {
     stop_eventfd_.write(Eventfd::MAX_VALUE);
 }
@@ -0,0 +1,77 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/socket_options.hpp"
+
+#include <optional>
+#include <vector>
+
+extern "C" {
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+}
+
+namespace co_http_uring {
+
+namespace {
+
+template <typename T>
+void add_option(
+    std::vector<SocketOption> &result,
+    int level,
+    int name,
+    const std::optional<T> &value
+) {
+    if (value) {
+        result.push_back({level, name, static_cast<int>(*value)});
+    }
+}
+
+} // namespace
+
+std::vector<SocketOption>
+listener_socket_options(const SocketOptions &options, int family) {
+    std::vector<SocketOption> result;
+
+    if (family != AF_UNIX) {
+        add_option(result, IPPROTO_TCP, TCP_DEFER_ACCEPT, options.defer_accept);
+        add_option(
+            result,
+            IPPROTO_TCP,
+            TCP_FASTOPEN,
+            options.fastopen_queue_length
+        );
+        add_option(result, SOL_SOCKET, SO_INCOMING_CPU, options.incoming_cpu);
+    }
+
+    add_option(result, SOL_SOCKET, SO_RCVBUF, options.receive_buffer_size);
+    add_option(result, SOL_SOCKET, SO_SNDBUF, options.send_buffer_size);
+    return result;
+}
+
+std::vector<SocketOption>
+connection_socket_options(const SocketOptions &options, int family) {
+    std::vector<SocketOption> result;
+
+    if (family != AF_UNIX) {
+        add_option(result, IPPROTO_TCP, TCP_NODELAY, options.no_delay);
+        add_option(
+            result,
+            IPPROTO_TCP,
+            TCP_NOTSENT_LOWAT,
+            options.not_sent_low_watermark
+        );
+        add_option(result, SOL_SOCKET, SO_BUSY_POLL, options.busy_poll);
+        add_option(
+            result,
+            SOL_SOCKET,
+            SO_PREFER_BUSY_POLL,
+            options.prefer_busy_poll
+        );
+    }
+
+    return result;
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,85 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/task.hpp"
+
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/types.hpp"
+#include "co_http_uring/when.hpp"
+
+#include <coroutine>
+
+namespace co_http_uring {
+
+void TaskPromiseBase::cancel_operation() {
+    Server *server = Server::thread_instance();
+
+    if (server == nullptr || !operation_coroutine_) {
+        return;
+    }
+
+    // The coroutine may have moved on to something that is not a ring
+    // operation since it last awaited one.
+    auto it = server->coroutines().find(operation_key_);
+
+    if (it != server->coroutines().end() &&
+        it->second == operation_coroutine_) {
+        server->cancel_operation(operation_key_);
+    }
+}
+
+void TaskPromiseBase::await_child(TaskPromiseBase &child) {
+    child_ = &child;
+    child.parent_ = this;
+
+    if (cancel_requested_) {
+        child.cancel();
+    }
+}
+
+void TaskPromiseBase::leave_parent() {
+    if (parent_ != nullptr && parent_->child_ == this) {
+        parent_->child_ = nullptr;
+    }
+
+    parent_ = nullptr;
+}
+
+void TaskPromiseBase::join_group(TaskGroup &group) {
+    group_ = &group;
+
+    if (cancel_requested_) {
+        group.cancel();
+    }
+}
+
+void TaskPromiseBase::await_operation(
+    i64 key,
+    std::coroutine_handle<> coroutine
+) {
+    operation_key_ = key;
+    operation_coroutine_ = coroutine;
+
+    if (cancel_requested_) {
+        cancel_operation();
+    }
+}
+
+void TaskPromiseBase::cancel() {
+    // Whatever the task awaits from now on is cancelled as it starts.
+    if (cancel_requested_) {
+        return;
+    }
+
+    cancel_requested_ = true;
+
+    if (child_ != nullptr) {
+        child_->cancel();
+    } else if (group_ != nullptr) {
+        group_->cancel();
+    } else {
+        cancel_operation();
+    }
+}
+
+} // namespace co_http_uring
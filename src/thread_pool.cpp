@@ -0,0 +1,108 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace co_http_uring {
+
+thread_local ThreadPool *ThreadPool::current_pool_ = nullptr;
+thread_local std::size_t ThreadPool::current_index_ = 0;
+
+ThreadPool::ThreadPool(std::size_t thread_count) {
+    thread_count = std::max<std::size_t>(thread_count, 1);
+    workers_.reserve(thread_count);
+    threads_.reserve(thread_count);
+
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, i](std::stop_token stop_token) {
+            work(stop_token, i);
+        });
+    }
+}
+
+ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool{std::thread::hardware_concurrency()};
+    return pool;
+}
+
+bool ThreadPool::try_run(std::size_t index) {
+    Job job;
+
+    for (std::size_t i = 0; i < workers_.size() && !job; ++i) {
+        Worker &worker = *workers_[(index + i) % workers_.size()];
+        std::lock_guard lock{worker.mutex};
+
+        if (worker.jobs.empty()) {
+            continue;
+        }
+
+        if (i == 0) {
+            job = std::move(worker.jobs.back());
+            worker.jobs.pop_back();
+        } else {
+            job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+        }
+    }
+
+    if (!job) {
+        return false;
+    }
+
+    pending_jobs_.fetch_sub(1, std::memory_order_relaxed);
+    job();
+    return true;
+}
+
+void ThreadPool::work(std::stop_token stop_token, std::size_t index) {
+    current_pool_ = this;
+    current_index_ = index;
+
+    while (!stop_token.stop_requested()) {
+        if (try_run(index)) {
+            continue;
+        }
+
+        std::unique_lock lock{sleep_mutex_};
+        wake_.wait(lock, stop_token, [this] {
+            return pending_jobs_.load(std::memory_order_relaxed) > 0;
+        });
+    }
+}
+
+void ThreadPool::submit(Job job) {
+    // Jobs submitted from a worker stay on its deque, where they are likely
+    // to run next and find warm caches.
+    std::size_t index = current_pool_ == this
+        ? current_index_
+        : next_index_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+    {
+        Worker &worker = *workers_[index];
+        std::lock_guard lock{worker.mutex};
+        worker.jobs.push_back(std::move(job));
+    }
+
+    {
+        // Incrementing under the sleep mutex means that a worker cannot check
+        // the count and then miss the notification.
+        std::lock_guard lock{sleep_mutex_};
+        pending_jobs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    wake_.notify_one();
+}
+
+} // namespace co_http_uring
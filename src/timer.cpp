@@ -0,0 +1,109 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/timer.hpp"
+
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/io_uring.hpp"
+#include "co_http_uring/operation_future.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <optional>
+
+extern "C" {
+#include <linux/time_types.h>
+}
+
+namespace co_http_uring {
+
+namespace {
+
+__kernel_timespec to_kernel_timespec(std::chrono::nanoseconds duration) {
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
+
+    return {
+        .tv_sec = seconds.count(),
+        .tv_nsec = (duration - seconds).count(),
+    };
+}
+
+} // namespace
+
+Task<> sleep_for(std::chrono::nanoseconds duration) {
+    __kernel_timespec ts = to_kernel_timespec(duration);
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
+    i64 key = server->allocate_operation_key();
+
+    IoUringSqe sqe = ring.get_sqe();
+    sqe.prep_timeout(&ts, 0, 0);
+    sqe.set_data64(key);
+    ring.submit();
+
+    // The timeout completes with -ETIME when it expires, which is the only
+    // expected outcome.
+    co_await OperationFuture(key);
+}
+
+Deadline::Deadline(std::chrono::nanoseconds timeout) :
+    ts_{to_kernel_timespec(timeout)} {
+}
+
+void Deadline::arm(std::coroutine_handle<> coroutine) {
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
+    key_ = server->allocate_operation_key();
+
+    IoUringSqe sqe = ring.get_sqe();
+    sqe.prep_timeout(&ts_, 0, 0);
+    sqe.set_data64(key_);
+    ring.submit();
+
+    server->coroutines().emplace(key_, coroutine);
+    armed_ = true;
+}
+
+bool Deadline::settle(bool task_done) {
+    if (!armed_) {
+        return true;
+    }
+
+    Server *server = Server::thread_instance();
+    IoUring &ring = server->ring();
+    server->coroutines().erase(key_);
+    armed_ = false;
+
+    if (!task_done) {
+        // Resumed by the timeout's own CQE.
+        IoUringCqe cqe = ring.peek_cqe();
+        ring.seen_cqe(cqe);
+        return false;
+    }
+
+    // The server drops the completions of both SQEs, as no coroutine waits on
+    // their key anymore.
+    IoUringSqe sqe = ring.get_sqe();
+    sqe.prep_timeout_remove(key_, 0);
+    sqe.set_data64(key_);
+    ring.submit();
+    return true;
+}
+
+Task<std::optional<Error>>
+with_deadline(std::chrono::nanoseconds timeout, Task<> task) {
+    Deadline deadline{timeout};
+
+    if (!co_await deadline.race(task)) {
+        task.cancel();
+        co_await task;
+        co_return Error::DEADLINE_EXCEEDED;
+    }
+
+    co_return std::nullopt;
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,208 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/trace.hpp"
+
+#include "co_http_uring/types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+extern "C" {
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+}
+
+namespace co_http_uring::trace {
+
+namespace {
+
+constexpr std::array<const char *, EVENT_COUNT> EVENT_NAMES{
+    "accept",
+    "recv_submit",
+    "recv_complete",
+    "parse_done",
+    "handler_start",
+    "handler_end",
+    "send_submit",
+    "send_complete",
+    "close",
+    "read_timeout",
+    "write_timeout",
+    "request_shed",
+};
+
+std::array<std::atomic<Ring *>, MAX_THREADS> rings{};
+std::atomic<u32> ring_count{0};
+std::once_flag start_flag;
+u64 start_timestamp;
+u64 start_ns;
+
+char signal_path[PATH_MAX];
+
+bool write_all(int fd, const void *data, std::size_t size) {
+    const auto *bytes = static_cast<const char *>(data);
+
+    while (size > 0) {
+        ssize_t res = ::write(fd, bytes, size);
+
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        bytes += res;
+        size -= res;
+    }
+
+    return true;
+}
+
+bool dump_ring(int fd, const Ring &ring) {
+    u64 next = ring.next.load(std::memory_order_acquire);
+    u64 capacity = ring.mask + 1;
+    u64 count = std::min(next, capacity);
+    ThreadHeader header{
+        .thread = ring.thread,
+        .reserved = 0,
+        .record_count = count,
+    };
+
+    if (!write_all(fd, &header, sizeof(header))) {
+        return false;
+    }
+
+    // The oldest record may sit anywhere in the ring, which is written in up
+    // to two contiguous parts.
+    u64 first = (next - count) & ring.mask;
+    u64 head_count = std::min(count, capacity - first);
+    return write_all(fd, &ring.records[first], head_count * sizeof(Record)) &&
+        write_all(fd, &ring.records[0], (count - head_count) * sizeof(Record));
+}
+
+void handle_signal(int) {
+    int saved_errno = errno;
+    dump(signal_path);
+    errno = saved_errno;
+}
+
+} // namespace
+
+thread_local Ring *thread_ring = nullptr;
+
+Ring::Ring(std::size_t capacity, u32 thread) :
+    records{std::make_unique<Record[]>(capacity)},
+    mask{capacity - 1},
+    thread{thread} {
+}
+
+const char *event_name(Event event) {
+    return EVENT_NAMES[static_cast<std::size_t>(event)];
+}
+
+u64 read_monotonic_ns() {
+    timespec ts{};
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<u64>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+void start_thread(std::size_t capacity) {
+    if (thread_ring != nullptr) {
+        return;
+    }
+
+    std::call_once(start_flag, [] {
+        start_timestamp = read_timestamp();
+        start_ns = read_monotonic_ns();
+    });
+
+    u32 thread = ring_count.load(std::memory_order_relaxed);
+
+    do {
+        if (thread == MAX_THREADS) {
+            throw std::length_error("too many traced threads");
+        }
+    } while (!ring_count.compare_exchange_weak(
+        thread,
+        thread + 1,
+        std::memory_order_relaxed
+    ));
+
+    auto *ring = new Ring{std::bit_ceil(std::max<std::size_t>(capacity, 1)),
+                          thread};
+    rings[thread].store(ring, std::memory_order_release);
+    thread_ring = ring;
+}
+
+bool dump(const char *path) {
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd == -1) {
+        return false;
+    }
+
+    // Threads that are still publishing their ring are left out.
+    std::array<const Ring *, MAX_THREADS> snapshot{};
+    u32 count = ring_count.load(std::memory_order_acquire);
+    u32 thread_count = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        if (const Ring *ring = rings[i].load(std::memory_order_acquire)) {
+            snapshot[thread_count++] = ring;
+        }
+    }
+
+    FileHeader header{
+        .magic = FileHeader::MAGIC,
+        .thread_count = thread_count,
+        .reserved = 0,
+        .start_timestamp = start_timestamp,
+        .start_ns = start_ns,
+        .dump_timestamp = read_timestamp(),
+        .dump_ns = read_monotonic_ns(),
+    };
+    bool ok = write_all(fd, &header, sizeof(header));
+
+    for (u32 i = 0; i < thread_count && ok; i++) {
+        ok = dump_ring(fd, *snapshot[i]);
+    }
+
+    return ::close(fd) == 0 && ok;
+}
+
+void dump_on_signal(int signal, const char *path) {
+    std::string_view path_view = path;
+
+    if (path_view.size() >= sizeof(signal_path)) {
+        throw std::length_error("trace dump path too long");
+    }
+
+    std::copy(path_view.cbegin(), path_view.cend(), signal_path);
+    signal_path[path_view.size()] = '\0';
+
+    struct sigaction action {};
+    action.sa_handler = handle_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (::sigaction(signal, &action, nullptr) == -1) {
+        throw std::system_error(errno, std::generic_category(), "sigaction");
+    }
+}
+
+} // namespace co_http_uring::trace
@@ -0,0 +1,582 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/websocket.hpp"
+
+#include "co_http_uring/connection_reader.hpp"
+#include "co_http_uring/connection_writer.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/request.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace co_http_uring {
+
+namespace {
+
+constexpr std::string_view WEBSOCKET = "websocket";
+constexpr std::string_view UPGRADE = "upgrade";
+constexpr std::string_view WEBSOCKET_VERSION = "13";
+constexpr std::string_view ACCEPT_KEY_GUID =
+    "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+constexpr std::string_view BASE64_ALPHABET =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// A Sec-WebSocket-Key is 16 bytes encoded in base64.
+constexpr std::size_t KEY_SIZE = 24;
+
+constexpr u8 FIN = 0x80;
+constexpr u8 RSV_BITS = 0x70;
+constexpr u8 CONTROL_BIT = 0x8;
+constexpr u8 OPCODE_BITS = 0xf;
+constexpr u8 MASK_BIT = 0x80;
+constexpr u8 LENGTH_BITS = 0x7f;
+constexpr u8 LENGTH_16 = 126;
+constexpr u8 LENGTH_64 = 127;
+constexpr std::size_t MASK_SIZE = 4;
+constexpr std::size_t MAX_HEADER_SIZE = 2 + 8 + MASK_SIZE;
+constexpr std::size_t MAX_CONTROL_PAYLOAD_SIZE = 125;
+
+std::array<u8, 20> sha1(std::string_view data) {
+    std::array<u32, 5> state{
+        0x67452301,
+        0xefcdab89,
+        0x98badcfe,
+        0x10325476,
+        0xc3d2e1f0,
+    };
+
+    std::string message{data};
+    message.push_back('\x80');
+    message.resize((message.size() + 8 + 63) / 64 * 64);
+    u64 bit_length = u64{data.size()} * 8;
+
+    for (std::size_t i = 0; i < 8; i++) {
+        message[message.size() - 1 - i] =
+            static_cast<char>(bit_length >> 8 * i);
+    }
+
+    for (std::size_t block = 0; block < message.size(); block += 64) {
+        std::array<u32, 80> w{};
+
+        for (std::size_t i = 0; i < 16; i++) {
+            const auto *bytes =
+                reinterpret_cast<const u8 *>(message.data() + block + 4 * i);
+            w[i] = u32{bytes[0]} << 24 | u32{bytes[1]} << 16 |
+                u32{bytes[2]} << 8 | u32{bytes[3]};
+        }
+
+        for (std::size_t i = 16; i < 80; i++) {
+            w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        auto [a, b, c, d, e] = state;
+
+        for (std::size_t i = 0; i < 80; i++) {
+            u32 f;
+            u32 k;
+
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+
+            u32 temp = std::rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = std::rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+
+    std::array<u8, 20> digest{};
+
+    for (std::size_t i = 0; i < digest.size(); i++) {
+        digest[i] = static_cast<u8>(state[i / 4] >> (24 - 8 * (i % 4)));
+    }
+
+    return digest;
+}
+
+std::string encode_base64(std::span<const u8> src) {
+    std::string dst;
+
+    for (std::size_t i = 0; i < src.size(); i += 3) {
+        u32 bits = u32{src[i]} << 16;
+
+        if (i + 1 < src.size()) {
+            bits |= u32{src[i + 1]} << 8;
+        }
+
+        if (i + 2 < src.size()) {
+            bits |= src[i + 2];
+        }
+
+        // Padding stands for the sextets past the end of the input.
+        for (std::size_t j = 0; j < 4; j++) {
+            std::size_t sextet = bits >> (18 - 6 * j) & 63;
+            dst.push_back(i + j <= src.size() ? BASE64_ALPHABET[sextet] : '=');
+        }
+    }
+
+    return dst;
+}
+
+bool is_valid_key(std::string_view key) {
+    return key.size() == KEY_SIZE && key.ends_with("==") &&
+        std::all_of(key.cbegin(), key.cend() - 2, [](char c) {
+               return BASE64_ALPHABET.find(c) != std::string_view::npos;
+           });
+}
+
+bool is_valid_close_code(u16 code) {
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011) ||
+        (code >= 3000 && code <= 4999);
+}
+
+bool is_valid_utf8(std::string_view str) {
+    const auto *data = reinterpret_cast<const u8 *>(str.data());
+    std::size_t size = str.size();
+    std::size_t i = 0;
+
+    while (i < size) {
+        // ASCII is skipped a word at a time.
+        if (i + 8 <= size) {
+            u64 word;
+            std::memcpy(&word, data + i, sizeof(word));
+
+            if ((word & 0x8080808080808080) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+
+        u8 c = data[i];
+        std::size_t length;
+        u32 code_point;
+        u32 min_code_point;
+
+        if (c < 0x80) {
+            i++;
+            continue;
+        } else if ((c & 0xe0) == 0xc0) {
+            length = 2;
+            code_point = c & 0x1f;
+            min_code_point = 0x80;
+        } else if ((c & 0xf0) == 0xe0) {
+            length = 3;
+            code_point = c & 0x0f;
+            min_code_point = 0x800;
+        } else if ((c & 0xf8) == 0xf0) {
+            length = 4;
+            code_point = c & 0x07;
+            min_code_point = 0x10000;
+        } else {
+            return false;
+        }
+
+        if (length > size - i) {
+            return false;
+        }
+
+        for (std::size_t j = 1; j < length; j++) {
+            if ((data[i + j] & 0xc0) != 0x80) {
+                return false;
+            }
+
+            code_point = code_point << 6 | (data[i + j] & 0x3f);
+        }
+
+        if (code_point < min_code_point || code_point > 0x10ffff ||
+            (code_point >= 0xd800 && code_point <= 0xdfff)) {
+            return false;
+        }
+
+        i += length;
+    }
+
+    return true;
+}
+
+// XORs `size` bytes of `src` with the masking key into `dst`, which may be
+// `src` itself or any address before it, including the key's.
+void unmask(char *dst, const char *src, std::size_t size, const char *key) {
+    std::size_t i = 0;
+    std::array<char, MASK_SIZE> key_bytes;
+    std::copy_n(key, MASK_SIZE, key_bytes.begin());
+    u32 key32;
+    std::memcpy(&key32, key_bytes.data(), sizeof(key32));
+
+#ifdef __SSE2__
+    __m128i key128 = _mm_set1_epi32(static_cast<int>(key32));
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i data =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i *>(dst + i),
+            _mm_xor_si128(data, key128)
+        );
+    }
+#endif
+
+    u64 key64 = u64{key32} << 32 | key32;
+
+    for (; i + 8 <= size; i += 8) {
+        u64 data;
+        std::memcpy(&data, src + i, sizeof(data));
+        data ^= key64;
+        std::memcpy(dst + i, &data, sizeof(data));
+    }
+
+    for (; i < size; i++) {
+        dst[i] = static_cast<char>(src[i] ^ key_bytes[i % MASK_SIZE]);
+    }
+}
+
+} // namespace
+
+struct WebSocket::SendLock {
+    WebSocket *web_socket;
+
+    [[nodiscard]] bool await_ready() const {
+        if (web_socket->sending_) {
+            return false;
+        }
+
+        web_socket->sending_ = true;
+        return true;
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine) const {
+        web_socket->send_waiters_.push_back(coroutine);
+    }
+
+    void await_resume() const {}
+};
+
+WebSocket::WebSocket(
+    ConnectionReader &reader,
+    ConnectionWriter &writer,
+    std::size_t max_message_size
+) :
+    reader_{&reader},
+    writer_{&writer},
+    max_message_size_{max_message_size} {
+    reader_->set_bytes_remaining(std::numeric_limits<u64>::max());
+    // Leaves room for the headers of a message's fragments, and for control
+    // frames between them.
+    reader_->set_max_buffer_size(max_message_size + PooledBuffer::MIN_SIZE);
+}
+
+WebSocket::WebSocket(WebSocket &&other) {
+    *this = std::move(other);
+}
+
+WebSocket &WebSocket::operator=(WebSocket &&other) {
+    if (sending_ || other.sending_) {
+        throw std::logic_error("WebSocket moved while sending");
+    }
+
+    reader_ = std::exchange(other.reader_, nullptr);
+    writer_ = std::exchange(other.writer_, nullptr);
+    max_message_size_ = other.max_message_size_;
+    idle_timeout_ = other.idle_timeout_;
+    consumed_size_ = std::exchange(other.consumed_size_, 0);
+    close_received_ = other.close_received_;
+    close_sent_ = other.close_sent_;
+    return *this;
+}
+
+WebSocket::SendLock WebSocket::lock_sender() {
+    return {this};
+}
+
+void WebSocket::unlock_sender() {
+    if (send_waiters_.empty()) {
+        sending_ = false;
+    } else {
+        Server::thread_instance()->schedule(send_waiters_.front());
+        send_waiters_.pop_front();
+    }
+}
+
+Task<std::optional<Error>>
+WebSocket::send_frame(WebSocketOpcode opcode, std::string_view payload) {
+    co_await lock_sender();
+    std::optional<Error> error;
+
+    if (close_sent_) {
+        error = Error::CONNECTION_CLOSED;
+    } else {
+        std::array<char, MAX_HEADER_SIZE> header{
+            static_cast<char>(FIN | static_cast<u8>(opcode)),
+        };
+        std::size_t header_size = 2;
+
+        if (payload.size() < LENGTH_16) {
+            header[1] = static_cast<char>(payload.size());
+        } else {
+            std::size_t length_size =
+                payload.size() <= std::numeric_limits<u16>::max() ? 2 : 8;
+            header[1] = static_cast<char>(length_size == 2 ? LENGTH_16
+                                                           : LENGTH_64);
+
+            for (std::size_t i = 0; i < length_size; i++) {
+                header[header_size++] = static_cast<char>(
+                    u64{payload.size()} >> 8 * (length_size - 1 - i)
+                );
+            }
+        }
+
+        close_sent_ = opcode == WebSocketOpcode::CLOSE;
+        error = co_await writer_->write({header.data(), header_size});
+
+        if (!error) {
+            error = co_await writer_->write(payload);
+        }
+    }
+
+    // Frames queued behind this one are flushed along with it.
+    if (send_waiters_.empty()) {
+        std::optional<Error> flush_error = co_await writer_->flush();
+        error = error ? error : flush_error;
+    }
+
+    unlock_sender();
+    co_return error;
+}
+
+Task<Error> WebSocket::fail(u16 code) {
+    if (!close_sent_) {
+        co_await close(code);
+    }
+
+    co_return Error::INVALID_REQUEST;
+}
+
+bool WebSocket::is_upgrade_request(const Request &request) {
+    auto key = request.get_header(Header::SEC_WEBSOCKET_KEY);
+    auto version = request.get_header(Header::SEC_WEBSOCKET_VERSION);
+
+    return request.method() == "GET" && request.http_version().major == 1 &&
+        request.http_version().minor == 1 && request.content_length() == 0 &&
+        !request.contains_header(Header::TRANSFER_ENCODING) &&
+        request.header_contains_token(Header::CONNECTION, UPGRADE) &&
+        request.header_contains_token(Header::UPGRADE, WEBSOCKET) && key &&
+        key->get().size() == 1 && is_valid_key(key->get().front()) &&
+        version && version->get().size() == 1 &&
+        version->get().front() == WEBSOCKET_VERSION;
+}
+
+std::string WebSocket::make_accept_key(std::string_view key) {
+    std::string input{key};
+    input += ACCEPT_KEY_GUID;
+    return encode_base64(sha1(input));
+}
+
+Task<std::variant<WebSocketMessage, Error>> WebSocket::receive() {
+    reader_->consume(std::exchange(consumed_size_, 0));
+    std::optional<WebSocketOpcode> message_opcode;
+    std::size_t message_size = 0;
+    // Bytes of headers and control frames between the start of the message
+    // and the next frame, which the message's fragments are moved over.
+    std::size_t gap = 0;
+
+    while (!close_received_) {
+        std::size_t offset = message_size + gap;
+
+        // Idle WebSockets hold no buffer, like idle HTTP connections, and
+        // wait for the next message for as long as the idle timeout allows.
+        if (offset == 0) {
+            reader_->release_buffer();
+            reader_->set_read_timeout(idle_timeout_);
+        }
+
+        std::optional<Error> error = co_await reader_->fill_to(offset + 2);
+        reader_->reset_read_timeout();
+
+        if (error) {
+            co_return *error;
+        }
+
+        auto first_byte = static_cast<u8>(reader_->buffered()[offset]);
+        auto second_byte = static_cast<u8>(reader_->buffered()[offset + 1]);
+        bool fin = (first_byte & FIN) != 0;
+        auto opcode = static_cast<WebSocketOpcode>(first_byte & OPCODE_BITS);
+        bool control = (first_byte & CONTROL_BIT) != 0;
+        u64 length = second_byte & LENGTH_BITS;
+        std::size_t length_size = length == LENGTH_16 ? 2
+            : length == LENGTH_64                     ? 8
+                                                      : 0;
+        std::size_t header_size = 2 + length_size + MASK_SIZE;
+
+        // Clients must mask their frames.
+        if ((first_byte & RSV_BITS) != 0 || (second_byte & MASK_BIT) == 0 ||
+            (control && (!fin || length > MAX_CONTROL_PAYLOAD_SIZE))) {
+            co_return co_await fail(PROTOCOL_ERROR);
+        }
+
+        if ((error = co_await reader_->fill_to(offset + header_size))) {
+            co_return *error;
+        }
+
+        if (length_size > 0) {
+            length = 0;
+
+            for (std::size_t i = 0; i < length_size; i++) {
+                length = length << 8 |
+                    static_cast<u8>(reader_->buffered()[offset + 2 + i]);
+            }
+        }
+
+        if (length > max_message_size_ - message_size) {
+            co_return co_await fail(MESSAGE_TOO_BIG);
+        }
+
+        error = co_await reader_->fill_to(offset + header_size + length);
+
+        if (error == Error::BUFFER_FULL) {
+            co_return co_await fail(MESSAGE_TOO_BIG);
+        }
+
+        if (error) {
+            co_return *error;
+        }
+
+        char *message = reader_->buffered().data();
+        char *payload = message + offset + header_size;
+        const char *key = payload - MASK_SIZE;
+
+        if (control) {
+            unmask(payload, payload, length, key);
+            gap += header_size + length;
+            std::string_view data{payload, length};
+
+            if (opcode == WebSocketOpcode::PING && !close_sent_) {
+                co_await send_frame(WebSocketOpcode::PONG, data);
+            } else if (opcode == WebSocketOpcode::CLOSE) {
+                if (data.size() == 1) {
+                    co_return co_await fail(PROTOCOL_ERROR);
+                }
+
+                u16 code = NORMAL_CLOSURE;
+
+                if (data.size() >= 2) {
+                    code = static_cast<u16>(
+                        static_cast<u8>(data[0]) << 8 | static_cast<u8>(data[1])
+                    );
+
+                    if (!is_valid_close_code(code)) {
+                        co_return co_await fail(PROTOCOL_ERROR);
+                    }
+
+                    if (!is_valid_utf8(data.substr(2))) {
+                        co_return co_await fail(INVALID_PAYLOAD);
+                    }
+                }
+
+                close_received_ = true;
+
+                if (!close_sent_) {
+                    co_await close(code);
+                }
+            } else if (opcode != WebSocketOpcode::PING &&
+                       opcode != WebSocketOpcode::PONG) {
+                co_return co_await fail(PROTOCOL_ERROR);
+            }
+
+            continue;
+        }
+
+        // Continuation frames carry the rest of a fragmented message, and
+        // only them.
+        if (opcode > WebSocketOpcode::BINARY ||
+            (opcode == WebSocketOpcode::CONTINUATION) !=
+                message_opcode.has_value()) {
+            co_return co_await fail(PROTOCOL_ERROR);
+        }
+
+        if (!message_opcode) {
+            message_opcode = opcode;
+        }
+
+        // Unmasking moves the fragment right after the previous one.
+        unmask(message + message_size, payload, length, key);
+        message_size += length;
+        gap += header_size;
+
+        if (fin) {
+            std::string_view data{message, message_size};
+
+            if (*message_opcode == WebSocketOpcode::TEXT &&
+                !is_valid_utf8(data)) {
+                co_return co_await fail(INVALID_PAYLOAD);
+            }
+
+            consumed_size_ = message_size + gap;
+            co_return WebSocketMessage{*message_opcode, data};
+        }
+    }
+
+    co_return Error::CONNECTION_CLOSED;
+}
+
+Task<std::optional<Error>>
+WebSocket::send(std::string_view data, WebSocketOpcode opcode) {
+    co_return co_await send_frame(opcode, data);
+}
+
+Task<std::optional<Error>> WebSocket::ping(std::string_view data) {
+    co_return co_await send_frame(WebSocketOpcode::PING, data);
+}
+
+Task<std::optional<Error>>
+WebSocket::close(u16 code, std::string_view reason) {
+    std::string payload{
+        static_cast<char>(code >> 8),
+        static_cast<char>(code),
+    };
+    payload += reason.substr(0, MAX_CONTROL_PAYLOAD_SIZE - 2);
+    co_return co_await send_frame(WebSocketOpcode::CLOSE, payload);
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,36 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/when.hpp"
+
+#include <coroutine>
+#include <cstddef>
+
+namespace co_http_uring {
+
+std::coroutine_handle<> TaskGroup::finish(std::size_t index) {
+    if (!winner_) {
+        winner_ = index;
+
+        if (cancel_losers_) {
+            cancel();
+        }
+    }
+
+    running_--;
+
+    if (running_ == 0 && joiner_) {
+        return joiner_;
+    }
+
+    return std::noop_coroutine();
+}
+
+void TaskGroup::cancel() {
+    // Members that have finished have nothing left to cancel.
+    for (const Member &member : members_) {
+        member.cancel();
+    }
+}
+
+} // namespace co_http_uring
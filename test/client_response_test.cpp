@@ -0,0 +1,183 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memory_connection.hpp"
+#include "sync_await.hpp"
+
+#include "co_http_uring/client_response.hpp"
+
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/header_map.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/types.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace co_http_uring {
+
+namespace {
+
+using test::sync_await;
+
+std::vector<std::string> values(const HeaderMap::Values *values) {
+    if (values == nullptr) {
+        return {};
+    }
+
+    return {values->cbegin(), values->cend()};
+}
+
+} // namespace
+
+// Responses received from a connection that delivers `connection_.input`.
+class ClientResponseTest : public testing::Test {
+protected:
+    test::MemoryConnection connection_;
+
+    std::variant<ClientResponse, Error>
+    receive(std::string_view request_method = "GET", u64 max_body_size = 64) {
+        return sync_await(ClientResponse::receive(
+            connection_.reader,
+            request_method,
+            max_body_size
+        ));
+    }
+};
+
+TEST_F(ClientResponseTest, ReadsContentLengthBodies) {
+    connection_.input.push_back(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 11\r\n"
+        "\r\n"
+        "hello"
+    );
+    connection_.input.push_back(" world");
+
+    std::variant<ClientResponse, Error> result = receive();
+    ASSERT_TRUE(std::holds_alternative<ClientResponse>(result));
+    const auto &response = std::get<ClientResponse>(result);
+    EXPECT_EQ(response.status_code(), 200);
+    EXPECT_EQ(response.body(), "hello world");
+    EXPECT_TRUE(response.keep_alive());
+}
+
+TEST_F(ClientResponseTest, ReadsChunkedBodiesAndTrailers) {
+    connection_.input.push_back(
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5;name=value\r\nhello\r\n"
+        "6\r\n wo"
+    );
+    connection_.input.push_back(
+        "rld\r\n"
+        "0\r\n"
+        "Checksum: abc\r\n"
+        "\r\n"
+    );
+
+    std::variant<ClientResponse, Error> result = receive();
+    ASSERT_TRUE(std::holds_alternative<ClientResponse>(result));
+    const auto &response = std::get<ClientResponse>(result);
+    EXPECT_EQ(response.body(), "hello world");
+    EXPECT_EQ(
+        values(response.headers().find("checksum")),
+        std::vector<std::string>{"abc"}
+    );
+    EXPECT_TRUE(response.keep_alive());
+}
+
+TEST_F(ClientResponseTest, RejectsMalformedChunks) {
+    connection_.input.push_back(
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "zz\r\n"
+    );
+    EXPECT_EQ(std::get<Error>(receive()), Error::INVALID_RESPONSE);
+
+    connection_.input.push_back(
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "2\r\nabc\r\n"
+    );
+    EXPECT_EQ(std::get<Error>(receive()), Error::INVALID_RESPONSE);
+}
+
+TEST_F(ClientResponseTest, SkipsInterimResponses) {
+    connection_.input.push_back(
+        "HTTP/1.1 100 Continue\r\n"
+        "\r\n"
+        "HTTP/1.1 103 Early Hints\r\n"
+        "Link: </style.css>; rel=preload\r\n"
+        "\r\n"
+        "HTTP/1.1 204 No Content\r\n"
+        "\r\n"
+    );
+
+    std::variant<ClientResponse, Error> result = receive();
+    ASSERT_TRUE(std::holds_alternative<ClientResponse>(result));
+    const auto &response = std::get<ClientResponse>(result);
+    EXPECT_EQ(response.status_code(), 204);
+    EXPECT_FALSE(response.headers().contains(Header::LINK));
+    EXPECT_TRUE(response.body().empty());
+}
+
+TEST_F(ClientResponseTest, ReadsUntilCloseWithoutFraming) {
+    connection_.input.push_back("HTTP/1.0 200 OK\r\n\r\nhello");
+    connection_.input.push_back(" world");
+
+    std::variant<ClientResponse, Error> result = receive();
+    ASSERT_TRUE(std::holds_alternative<ClientResponse>(result));
+    const auto &response = std::get<ClientResponse>(result);
+    EXPECT_EQ(response.body(), "hello world");
+    EXPECT_FALSE(response.keep_alive());
+}
+
+TEST_F(ClientResponseTest, ReadsNoBodyForHead) {
+    connection_.input.push_back(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 11\r\n"
+        "\r\n"
+    );
+
+    std::variant<ClientResponse, Error> result = receive("HEAD");
+    ASSERT_TRUE(std::holds_alternative<ClientResponse>(result));
+    EXPECT_TRUE(std::get<ClientResponse>(result).body().empty());
+}
+
+TEST_F(ClientResponseTest, LimitsBodySize) {
+    connection_.input.push_back(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 65\r\n"
+        "\r\n"
+    );
+    EXPECT_EQ(std::get<Error>(receive()), Error::READ_LIMIT_REACHED);
+}
+
+TEST_F(ClientResponseTest, LimitsChunkedBodySize) {
+    // The second chunk would wrap the body size around if added to it.
+    connection_.input.push_back(
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "1\r\na\r\n"
+        "ffffffffffffffff\r\n"
+    );
+    EXPECT_EQ(std::get<Error>(receive()), Error::READ_LIMIT_REACHED);
+}
+
+TEST_F(ClientResponseTest, LimitsBodySizeUntilClose) {
+    connection_.input.push_back("HTTP/1.1 200 OK\r\n\r\n");
+    connection_.input.emplace_back(64, 'a');
+    connection_.input.emplace_back(1, 'a');
+    EXPECT_EQ(std::get<Error>(receive()), Error::READ_LIMIT_REACHED);
+}
+
+} // namespace co_http_uring
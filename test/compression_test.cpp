@@ -0,0 +1,171 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memory_connection.hpp"
+#include "sync_await.hpp"
+
+#include "co_http_uring/compression.hpp"
+
+#include "co_http_uring/client_response.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/known_headers.hpp"
+#include "co_http_uring/response_writer.hpp"
+#include "co_http_uring/status_code.hpp"
+
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace co_http_uring {
+
+namespace {
+
+using test::sync_await;
+
+ContentEncoding negotiate(std::initializer_list<const char *> values) {
+    std::pmr::vector<std::pmr::string> accept_encoding{
+        values.begin(),
+        values.end(),
+    };
+    return negotiate_content_encoding(accept_encoding);
+}
+
+std::string decompress(std::string_view data) {
+    z_stream stream{};
+    EXPECT_EQ(inflateInit(&stream), Z_OK);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    std::string result;
+    int status = Z_OK;
+
+    while (status == Z_OK) {
+        char buffer[4096];
+        stream.next_out = reinterpret_cast<Bytef *>(buffer);
+        stream.avail_out = sizeof(buffer);
+        status = inflate(&stream, Z_NO_FLUSH);
+        result.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+
+    EXPECT_EQ(status, Z_STREAM_END);
+    EXPECT_EQ(stream.avail_in, 0U);
+    inflateEnd(&stream);
+    return result;
+}
+
+// Incompressible, so that the compressed body spans several chunks.
+std::string random_text(std::size_t size) {
+    std::minstd_rand engine;
+    std::uniform_int_distribution<int> letter{'a', 'z'};
+    std::string text(size, '\0');
+
+    for (char &c : text) {
+        c = static_cast<char>(letter(engine));
+    }
+
+    return text;
+}
+
+ClientResponse
+write_response(std::string_view body, int http_minor_version) {
+    test::MemoryConnection connection;
+    ResponseWriter res{connection.writer, http_minor_version};
+    res.set_compression(ContentEncoding::DEFLATE, {.level = 6, .min_size = 16});
+
+    EXPECT_EQ(sync_await(res.write_status(StatusCode::OK)), std::nullopt);
+    EXPECT_EQ(sync_await(res.write_body(body)), std::nullopt);
+    EXPECT_EQ(sync_await(res.send()), std::nullopt);
+
+    connection.input.push_back(connection.output);
+    std::variant<ClientResponse, Error> response = sync_await(
+        ClientResponse::receive(connection.reader, "GET", 1 << 20)
+    );
+
+    if (!std::holds_alternative<ClientResponse>(response)) {
+        ADD_FAILURE() << "invalid response";
+        return {};
+    }
+
+    return std::move(std::get<ClientResponse>(response));
+}
+
+} // namespace
+
+TEST(CompressionTest, NegotiatesByWeight) {
+    EXPECT_EQ(negotiate({}), ContentEncoding::IDENTITY);
+    EXPECT_EQ(negotiate({"br"}), ContentEncoding::IDENTITY);
+    EXPECT_EQ(negotiate({"deflate"}), ContentEncoding::DEFLATE);
+    EXPECT_EQ(negotiate({"x-gzip"}), ContentEncoding::GZIP);
+    EXPECT_EQ(negotiate({"deflate, GZIP"}), ContentEncoding::GZIP);
+    EXPECT_EQ(negotiate({"gzip;q=0.5", "deflate"}), ContentEncoding::DEFLATE);
+    EXPECT_EQ(
+        negotiate({"gzip ; Q=0.8, deflate;q=0.9"}),
+        ContentEncoding::DEFLATE
+    );
+    // Gzip wins ties.
+    EXPECT_EQ(negotiate({"deflate;q=0.5, gzip;q=0.5"}), ContentEncoding::GZIP);
+}
+
+TEST(CompressionTest, RefusesCodingsWithZeroWeight) {
+    EXPECT_EQ(negotiate({"gzip;q=0"}), ContentEncoding::IDENTITY);
+    EXPECT_EQ(negotiate({"gzip;q=0, deflate"}), ContentEncoding::DEFLATE);
+    EXPECT_EQ(negotiate({"gzip;q=abc"}), ContentEncoding::IDENTITY);
+    EXPECT_EQ(negotiate({"*;q=0"}), ContentEncoding::IDENTITY);
+}
+
+TEST(CompressionTest, AppliesWildcardToUnlistedCodings) {
+    EXPECT_EQ(negotiate({"*"}), ContentEncoding::GZIP);
+    EXPECT_EQ(negotiate({"gzip;q=0, *"}), ContentEncoding::DEFLATE);
+    EXPECT_EQ(negotiate({"*;q=0.2, deflate;q=0.3"}), ContentEncoding::DEFLATE);
+}
+
+TEST(CompressionTest, StreamsChunkedDeflateBody) {
+    std::string body = random_text(256 * 1024);
+    ClientResponse response = write_response(body, 1);
+
+    EXPECT_TRUE(response.headers().contains_token(
+        Header::TRANSFER_ENCODING,
+        "chunked"
+    ));
+    EXPECT_FALSE(response.headers().contains(Header::CONTENT_LENGTH));
+    EXPECT_TRUE(
+        response.headers().contains_token(Header::CONTENT_ENCODING, "deflate")
+    );
+    EXPECT_TRUE(
+        response.headers().contains_token(Header::VARY, "accept-encoding")
+    );
+    EXPECT_EQ(decompress(response.body()), body);
+}
+
+TEST(CompressionTest, SendsWholeDeflateBodyOverHttp10) {
+    std::string body = random_text(4096);
+    ClientResponse response = write_response(body, 0);
+
+    EXPECT_FALSE(response.headers().contains(Header::TRANSFER_ENCODING));
+    EXPECT_TRUE(response.headers().contains(Header::CONTENT_LENGTH));
+    EXPECT_EQ(decompress(response.body()), body);
+}
+
+TEST(CompressionTest, SendsSmallBodiesUncompressed) {
+    ClientResponse response = write_response("tiny", 1);
+
+    EXPECT_FALSE(response.headers().contains(Header::CONTENT_ENCODING));
+    EXPECT_EQ(response.body(), "tiny");
+}
+
+TEST(CompressionTest, CompressesRoundTrip) {
+    std::string text = random_text(10000);
+    EXPECT_EQ(decompress(compress(text, ContentEncoding::DEFLATE, 9)), text);
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,175 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/header_map.hpp"
+#include "co_http_uring/known_headers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace co_http_uring {
+
+namespace {
+
+std::vector<std::string> names(const HeaderMap &headers) {
+    std::vector<std::string> result;
+
+    for (const auto &[name, values] : headers) {
+        result.emplace_back(name);
+    }
+
+    return result;
+}
+
+std::vector<std::string> values(const HeaderMap::Values *values) {
+    if (values == nullptr) {
+        return {};
+    }
+
+    return {values->cbegin(), values->cend()};
+}
+
+} // namespace
+
+TEST(KnownHeadersTest, EveryNameRoundTrips) {
+    for (std::size_t i = 0; i < KNOWN_HEADER_COUNT; i++) {
+        auto header = static_cast<Header>(i);
+        std::string name{header_name(header)};
+        EXPECT_EQ(find_header(name), header) << name;
+
+        std::transform(
+            name.cbegin(),
+            name.cend(),
+            name.begin(),
+            [](unsigned char c) { return std::toupper(c); }
+        );
+        EXPECT_EQ(find_header(name), header) << name;
+    }
+}
+
+TEST(KnownHeadersTest, RejectsUnknownNames) {
+    EXPECT_EQ(find_header(""), std::nullopt);
+    EXPECT_EQ(find_header("x-custom"), std::nullopt);
+    // Near misses of known names.
+    EXPECT_EQ(find_header("hos"), std::nullopt);
+    EXPECT_EQ(find_header("hosts"), std::nullopt);
+    EXPECT_EQ(find_header("content-lengths"), std::nullopt);
+    EXPECT_EQ(find_header("content_length"), std::nullopt);
+}
+
+TEST(HeaderMapTest, FindsFieldsByIdAndName) {
+    HeaderMap headers;
+    headers.add("Host", " example.com ");
+    headers.add("X-Custom", "a");
+    headers.add("x-custom", "b");
+
+    EXPECT_EQ(values(headers.find(Header::HOST)), (std::vector<std::string>{
+        "example.com",
+    }));
+    EXPECT_EQ(values(headers.find("HOST")), values(headers.find(Header::HOST)));
+    EXPECT_EQ(values(headers.find("X-CUSTOM")), (std::vector<std::string>{
+        "a",
+        "b",
+    }));
+    EXPECT_TRUE(headers.contains(Header::HOST));
+    EXPECT_TRUE(headers.contains("x-Custom"));
+    EXPECT_FALSE(headers.contains(Header::ACCEPT));
+    EXPECT_FALSE(headers.contains("x-other"));
+    EXPECT_EQ(headers.find(Header::ACCEPT), nullptr);
+    EXPECT_EQ(headers.find("x-other"), nullptr);
+}
+
+TEST(HeaderMapTest, KeepsOrderOfFirstAppearance) {
+    HeaderMap headers;
+    headers.add("X-B", "1");
+    headers.add("Accept", "*/*");
+    headers.add("x-a", "2");
+    headers.add("x-b", "3");
+
+    EXPECT_EQ(names(headers), (std::vector<std::string>{
+        "x-b",
+        "accept",
+        "x-a",
+    }));
+    EXPECT_EQ(headers.size(), 3U);
+}
+
+TEST(HeaderMapTest, ReindexesFieldsAfterErase) {
+    HeaderMap headers;
+    headers.add("host", "example.com");
+    headers.add("x-a", "1");
+    headers.add("accept", "*/*");
+    headers.add("x-b", "2");
+    headers.add("user-agent", "test");
+
+    headers.erase(Header::HOST);
+    EXPECT_FALSE(headers.contains(Header::HOST));
+    EXPECT_EQ(values(headers.find("x-a")), (std::vector<std::string>{"1"}));
+    EXPECT_EQ(values(headers.find(Header::ACCEPT)), (std::vector<std::string>{
+        "*/*",
+    }));
+
+    headers.erase("X-A");
+    EXPECT_FALSE(headers.contains("x-a"));
+    EXPECT_EQ(values(headers.find(Header::ACCEPT)), (std::vector<std::string>{
+        "*/*",
+    }));
+    EXPECT_EQ(values(headers.find("x-b")), (std::vector<std::string>{"2"}));
+    EXPECT_EQ(
+        values(headers.find(Header::USER_AGENT)),
+        (std::vector<std::string>{"test"})
+    );
+
+    // Known names erase by ID.
+    headers.erase("Accept");
+    EXPECT_EQ(names(headers), (std::vector<std::string>{"x-b", "user-agent"}));
+
+    // Absent fields are ignored.
+    headers.erase("x-a");
+    headers.erase(Header::HOST);
+    EXPECT_EQ(headers.size(), 2U);
+
+    headers.add("x-a", "3");
+    EXPECT_EQ(values(headers.find("x-a")), (std::vector<std::string>{"3"}));
+    EXPECT_EQ(values(headers.find("x-b")), (std::vector<std::string>{"2"}));
+}
+
+TEST(HeaderMapTest, Clears) {
+    HeaderMap headers;
+    headers.add("host", "example.com");
+    headers.add("x-a", "1");
+    headers.clear();
+
+    EXPECT_TRUE(headers.empty());
+    EXPECT_FALSE(headers.contains(Header::HOST));
+    EXPECT_FALSE(headers.contains("x-a"));
+
+    headers.add("x-a", "2");
+    EXPECT_EQ(values(headers.find("x-a")), (std::vector<std::string>{"2"}));
+}
+
+TEST(HeaderMapTest, ParsesContentLength) {
+    HeaderMap headers;
+    u64 content_length = 7;
+    EXPECT_TRUE(parse_content_length(headers, content_length));
+    EXPECT_EQ(content_length, 7U);
+
+    ASSERT_TRUE(parse_header_line(headers, "Content-Length: 42"));
+    ASSERT_TRUE(parse_header_line(headers, "content-length:42"));
+    EXPECT_TRUE(parse_content_length(headers, content_length));
+    EXPECT_EQ(content_length, 42U);
+
+    ASSERT_TRUE(parse_header_line(headers, "Content-Length: 43"));
+    EXPECT_FALSE(parse_content_length(headers, content_length));
+    EXPECT_FALSE(parse_header_line(headers, "no colon"));
+    EXPECT_FALSE(parse_header_line(headers, "bad name: value"));
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,308 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "co_http_uring/hpack.hpp"
+
+#include <gtest/gtest.h>
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace co_http_uring {
+
+namespace {
+
+// Header blocks are written as in RFC 7541, in hexadecimal with spaces.
+std::string from_hex(std::string_view hex) {
+    std::string bytes;
+
+    for (std::size_t i = 0; i < hex.size(); i++) {
+        if (hex[i] == ' ') {
+            continue;
+        }
+
+        unsigned int byte{};
+        std::from_chars(hex.data() + i, hex.data() + i + 2, byte, 16);
+        bytes.push_back(static_cast<char>(byte));
+        i++;
+    }
+
+    return bytes;
+}
+
+HeaderList decode(HpackDecoder &decoder, std::string_view hex) {
+    HeaderList fields;
+    EXPECT_TRUE(decoder.decode(from_hex(hex), fields));
+    return fields;
+}
+
+const HeaderList FIRST_REQUEST{
+    {":method", "GET"},
+    {":scheme", "http"},
+    {":path", "/"},
+    {":authority", "www.example.com"},
+};
+
+const HeaderList SECOND_REQUEST{
+    {":method", "GET"},
+    {":scheme", "http"},
+    {":path", "/"},
+    {":authority", "www.example.com"},
+    {"cache-control", "no-cache"},
+};
+
+const HeaderList THIRD_REQUEST{
+    {":method", "GET"},
+    {":scheme", "https"},
+    {":path", "/index.html"},
+    {":authority", "www.example.com"},
+    {"custom-key", "custom-value"},
+};
+
+const HeaderList FIRST_RESPONSE{
+    {":status", "302"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+    {"location", "https://www.example.com"},
+};
+
+const HeaderList SECOND_RESPONSE{
+    {":status", "307"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+    {"location", "https://www.example.com"},
+};
+
+const HeaderList THIRD_RESPONSE{
+    {":status", "200"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:22 GMT"},
+    {"location", "https://www.example.com"},
+    {"content-encoding", "gzip"},
+    {"set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"},
+};
+
+} // namespace
+
+// RFC 7541, appendix C.2.
+TEST(HpackTest, DecodesFieldRepresentations) {
+    HpackDecoder decoder;
+
+    EXPECT_EQ(
+        decode(
+            decoder,
+            "400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572"
+        ),
+        (HeaderList{{"custom-key", "custom-header"}})
+    );
+    EXPECT_EQ(
+        decode(decoder, "040c 2f73 616d 706c 652f 7061 7468"),
+        (HeaderList{{":path", "/sample/path"}})
+    );
+    EXPECT_EQ(
+        decode(decoder, "1008 7061 7373 776f 7264 0673 6563 7265 74"),
+        (HeaderList{{"password", "secret"}})
+    );
+    EXPECT_EQ(decode(decoder, "82"), (HeaderList{{":method", "GET"}}));
+    // Only the first field was indexed.
+    EXPECT_EQ(
+        decode(decoder, "be"),
+        (HeaderList{{"custom-key", "custom-header"}})
+    );
+}
+
+// RFC 7541, appendix C.3.
+TEST(HpackTest, DecodesRequestsWithoutHuffmanCoding) {
+    HpackDecoder decoder;
+
+    EXPECT_EQ(
+        decode(decoder, "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"),
+        FIRST_REQUEST
+    );
+    EXPECT_EQ(
+        decode(decoder, "8286 84be 5808 6e6f 2d63 6163 6865"),
+        SECOND_REQUEST
+    );
+    EXPECT_EQ(
+        decode(
+            decoder,
+            "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 "
+            "6c75 65"
+        ),
+        THIRD_REQUEST
+    );
+}
+
+// RFC 7541, appendix C.4.
+TEST(HpackTest, DecodesRequestsWithHuffmanCoding) {
+    HpackDecoder decoder;
+
+    EXPECT_EQ(
+        decode(decoder, "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"),
+        FIRST_REQUEST
+    );
+    EXPECT_EQ(decode(decoder, "8286 84be 5886 a8eb 1064 9cbf"), SECOND_REQUEST);
+    EXPECT_EQ(
+        decode(
+            decoder,
+            "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"
+        ),
+        THIRD_REQUEST
+    );
+}
+
+// RFC 7541, appendix C.5, where the dynamic table of 256 bytes evicts
+// entries.
+TEST(HpackTest, DecodesResponsesWithoutHuffmanCoding) {
+    HpackDecoder decoder{256};
+
+    EXPECT_EQ(
+        decode(
+            decoder,
+            "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 "
+            "7420 3230 3133 2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 "
+            "3a2f 2f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"
+        ),
+        FIRST_RESPONSE
+    );
+    EXPECT_EQ(decode(decoder, "4803 3330 37c1 c0bf"), SECOND_RESPONSE);
+    EXPECT_EQ(
+        decode(
+            decoder,
+            "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 "
+            "3a32 3220 474d 54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 "
+            "514b 425a 584f 5157 454f 5049 5541 5851 5745 4f49 553b 206d 6178 "
+            "2d61 6765 3d33 3630 303b 2076 6572 7369 6f6e 3d31"
+        ),
+        THIRD_RESPONSE
+    );
+}
+
+// RFC 7541, appendix C.6.
+TEST(HpackTest, DecodesResponsesWithHuffmanCoding) {
+    HpackDecoder decoder{256};
+
+    EXPECT_EQ(
+        decode(
+            decoder,
+            "4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 9504 "
+            "0b81 66e0 82a6 2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 e9ae 82ae "
+            "43d3"
+        ),
+        FIRST_RESPONSE
+    );
+    EXPECT_EQ(decode(decoder, "4883 640e ffc1 c0bf"), SECOND_RESPONSE);
+    EXPECT_EQ(
+        decode(
+            decoder,
+            "88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff "
+            "c05a 839b d9ab 77ad 94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af "
+            "2708 7f36 72c1 ab27 0fb5 291f 9587 3160 65c0 03ed 4ee5 b106 3d50 "
+            "07"
+        ),
+        THIRD_RESPONSE
+    );
+}
+
+TEST(HpackTest, RejectsMalformedBlocks) {
+    HeaderList fields;
+
+    // An index past the end of both tables.
+    EXPECT_FALSE(HpackDecoder{}.decode(from_hex("ff00"), fields));
+    // A string longer than what is left of the block.
+    EXPECT_FALSE(HpackDecoder{}.decode(from_hex("400a 6375 7374"), fields));
+    // A size update above SETTINGS_HEADER_TABLE_SIZE.
+    EXPECT_FALSE(HpackDecoder{256}.decode(from_hex("3fe1 1f"), fields));
+    // Huffman padding longer than 7 bits (RFC 7541, section 5.2). With 3
+    // bits, the same name is valid.
+    EXPECT_FALSE(HpackDecoder{}.decode(from_hex("4082 1fff 00"), fields));
+    EXPECT_TRUE(HpackDecoder{}.decode(from_hex("4081 1f00"), fields));
+    EXPECT_EQ(fields.back(), (std::pair<std::string, std::string>{"a", ""}));
+}
+
+// One byte of indexed field may reference a table entry of any size, so the
+// limit applies to the decoded fields.
+TEST(HpackTest, LimitsDecodedListSize) {
+    // A literal field of 133 bytes (RFC 9113, section 6.5.2) that is indexed,
+    // then referenced nine times.
+    std::string block = "\x40\x01" "a" "\x64" + std::string(100, 'x');
+    block.append(9, '\xbe');
+
+    HeaderList fields;
+    EXPECT_TRUE(HpackDecoder{}.decode(block, fields, 10 * 133));
+    EXPECT_EQ(fields.size(), 10U);
+
+    block.push_back('\xbe');
+    fields.clear();
+    EXPECT_FALSE(HpackDecoder{}.decode(block, fields, 10 * 133));
+    EXPECT_LE(fields.size(), 10U);
+}
+
+TEST(HpackTest, TableEvictsOldestEntries) {
+    // Entries take the size of their name and value plus 32 bytes.
+    HpackTable table{2 * (32 + 2)};
+    table.insert("a", "1");
+    table.insert("b", "2");
+    table.insert("c", "3");
+
+    using Entry = std::pair<std::string_view, std::string_view>;
+    EXPECT_EQ(table.get(62), (Entry{"c", "3"}));
+    EXPECT_EQ(table.get(63), (Entry{"b", "2"}));
+    EXPECT_FALSE(table.get(64));
+    EXPECT_EQ(table.find("b", "2"), 63);
+    EXPECT_EQ(table.find("a", "1"), 0);
+    EXPECT_EQ(table.find(":method", "GET"), 2);
+    EXPECT_EQ(table.find(":method", "PUT"), -2);
+
+    table.set_max_size(32 + 2);
+    EXPECT_EQ(table.find("b", "2"), 0);
+    EXPECT_EQ(table.find("c", "3"), 62);
+}
+
+TEST(HpackTest, EncoderRoundTrips) {
+    HpackEncoder encoder;
+    HpackDecoder decoder;
+    HeaderList fields{
+        {":status", "200"},
+        {"content-type", "text/plain; charset=utf-8"},
+        {"content-length", "123"},
+        {"server", "co_http_uring"},
+        {"x-binary", std::string{"\xff\x00\x01", 3}},
+    };
+    std::size_t first_size = 0;
+
+    // Later blocks reuse the dynamic table.
+    for (int i = 0; i < 3; i++) {
+        std::string block;
+        encoder.encode(fields, block);
+        HeaderList decoded;
+        ASSERT_TRUE(decoder.decode(block, decoded));
+        EXPECT_EQ(decoded, fields);
+
+        if (i == 0) {
+            first_size = block.size();
+        } else {
+            EXPECT_LT(block.size(), first_size);
+        }
+    }
+}
+
+TEST(HpackTest, EncoderSignalsTableSizeChanges) {
+    HpackEncoder encoder;
+    HpackDecoder decoder{256};
+    HeaderList fields{{"x-custom", "value"}};
+    encoder.set_max_table_size(256);
+
+    for (int i = 0; i < 2; i++) {
+        std::string block;
+        encoder.encode(fields, block);
+        HeaderList decoded;
+        ASSERT_TRUE(decoder.decode(block, decoded));
+        EXPECT_EQ(decoded, fields);
+    }
+}
+
+} // namespace co_http_uring
@@ -0,0 +1,58 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_TEST_MEMORY_CONNECTION_HPP
+#define CO_HTTP_URING_TEST_MEMORY_CONNECTION_HPP
+
+#include "co_http_uring/connection_reader.hpp"
+#include "co_http_uring/connection_writer.hpp"
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/task.hpp"
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace co_http_uring::test {
+
+// A connection that receives `input` one chunk per read, and is then closed
+// by the peer, and that appends whatever is sent to `output`.
+struct MemoryConnection {
+    std::deque<std::string> input;
+    std::string output;
+    ConnectionReader reader{[this] { return receive_input(); }};
+    ConnectionWriter writer{[this](std::string_view data) {
+        return send_output(data);
+    }};
+
+    MemoryConnection() = default;
+
+    MemoryConnection(const MemoryConnection &) = delete;
+    MemoryConnection &operator=(const MemoryConnection &) = delete;
+
+    Task<std::optional<Error>> receive_input() {
+        if (input.empty()) {
+            co_return Error::CONNECTION_CLOSED;
+        }
+
+        std::string &chunk = input.front();
+        chunk.erase(0, reader.feed(chunk));
+
+        if (chunk.empty()) {
+            input.pop_front();
+        }
+
+        co_return {};
+    }
+
+    Task<std::optional<Error>> send_output(std::string_view data) {
+        output += data;
+        co_return {};
+    }
+};
+
+} // namespace co_http_uring::test
+
+#endif // CO_HTTP_URING_TEST_MEMORY_CONNECTION_HPP
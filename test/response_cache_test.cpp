@@ -0,0 +1,183 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memory_connection.hpp"
+#include "sync_await.hpp"
+
+#include "co_http_uring/response_cache.hpp"
+
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/request.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+
+using namespace std::literals::chrono_literals;
+
+namespace co_http_uring {
+
+namespace {
+
+using test::sync_await;
+
+Request parse_request(std::string text) {
+    test::MemoryConnection connection;
+    connection.input.push_back(std::move(text));
+    std::variant<Request, Error> request =
+        sync_await(Request::receive(connection.reader));
+
+    if (!std::holds_alternative<Request>(request)) {
+        ADD_FAILURE() << "invalid request";
+        return {};
+    }
+
+    return std::move(std::get<Request>(request));
+}
+
+Request get(std::string target) {
+    return parse_request("GET " + target + " HTTP/1.1\r\nHost: a\r\n\r\n");
+}
+
+// The size that a shard charges for an entry of a "GET /x HTTP/1.1 identity"
+// key and a one-byte response.
+constexpr std::size_t SMALL_ENTRY_SIZE = 24 + 1 + 160;
+
+} // namespace
+
+TEST(ResponseCacheTest, KeysOnMethodTargetVersionAndEncoding) {
+    ResponseCache cache{1024};
+
+    EXPECT_EQ(
+        cache.make_key(get("/users/1")),
+        "GET /users/1 HTTP/1.1 identity"
+    );
+    EXPECT_EQ(
+        cache.make_key(parse_request(
+            "HEAD /users/1 HTTP/1.0\r\n"
+            "Accept-Encoding: deflate, gzip;q=0.5\r\n"
+            "\r\n"
+        )),
+        "HEAD /users/1 HTTP/1.0 deflate"
+    );
+}
+
+TEST(ResponseCacheTest, KeysOnKeyHeaders) {
+    ResponseCache cache{1024, {"Accept-Language", "X-Tenant"}};
+
+    EXPECT_EQ(
+        cache.make_key(parse_request(
+            "GET / HTTP/1.1\r\n"
+            "Host: a\r\n"
+            "Accept-Language: en\r\n"
+            "Accept-Encoding: gzip\r\n"
+            "\r\n"
+        )),
+        "GET / HTTP/1.1 gzip\r\naccept-language: en\r\nx-tenant:"
+    );
+}
+
+TEST(ResponseCacheTest, CachesOnlySafeRequestsWithoutBodies) {
+    ResponseCache cache{1024};
+
+    EXPECT_TRUE(cache.is_cacheable(get("/")));
+    EXPECT_TRUE(cache.is_cacheable(parse_request(
+        "HEAD / HTTP/1.1\r\nHost: a\r\n\r\n"
+    )));
+    EXPECT_FALSE(cache.is_cacheable(parse_request(
+        "POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 2\r\n\r\n{}"
+    )));
+    EXPECT_FALSE(cache.is_cacheable(parse_request(
+        "GET /chat HTTP/1.1\r\n"
+        "Host: a\r\n"
+        "Connection: Upgrade\r\n"
+        "Upgrade: websocket\r\n"
+        "\r\n"
+    )));
+}
+
+TEST(ResponseCacheTest, EvictsLeastRecentlyUsedEntries) {
+    ResponseCache cache{3 * SMALL_ENTRY_SIZE};
+    ResponseCache::Shard &shard = cache.add_shard();
+
+    shard.insert("GET /a HTTP/1.1 identity", "a", 1min);
+    shard.insert("GET /b HTTP/1.1 identity", "b", 1min);
+    shard.insert("GET /c HTTP/1.1 identity", "c", 1min);
+    ASSERT_NE(shard.find("GET /a HTTP/1.1 identity"), nullptr);
+    shard.insert("GET /d HTTP/1.1 identity", "d", 1min);
+
+    EXPECT_EQ(shard.find("GET /b HTTP/1.1 identity"), nullptr);
+    std::shared_ptr<const std::string> a =
+        shard.find("GET /a HTTP/1.1 identity");
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(*a, "a");
+    EXPECT_NE(shard.find("GET /c HTTP/1.1 identity"), nullptr);
+    EXPECT_NE(shard.find("GET /d HTTP/1.1 identity"), nullptr);
+
+    ResponseCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 4U);
+    EXPECT_EQ(stats.misses, 1U);
+    EXPECT_EQ(stats.insertions, 4U);
+    EXPECT_EQ(stats.evictions, 1U);
+}
+
+TEST(ResponseCacheTest, SkipsResponsesLargerThanShard) {
+    ResponseCache cache{SMALL_ENTRY_SIZE};
+    ResponseCache::Shard &shard = cache.add_shard();
+
+    shard.insert("GET /a HTTP/1.1 identity", "aa", 1min);
+    EXPECT_EQ(shard.find("GET /a HTTP/1.1 identity"), nullptr);
+    EXPECT_EQ(cache.stats().insertions, 0U);
+}
+
+TEST(ResponseCacheTest, ExpiresEntries) {
+    ResponseCache cache{1024};
+    ResponseCache::Shard &shard = cache.add_shard();
+
+    shard.insert("GET /a HTTP/1.1 identity", "a", 0s);
+    EXPECT_EQ(shard.find("GET /a HTTP/1.1 identity"), nullptr);
+
+    ResponseCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.expirations, 1U);
+    EXPECT_EQ(stats.misses, 1U);
+}
+
+TEST(ResponseCacheTest, InvalidatesByPrefixAcrossShards) {
+    ResponseCache cache{1024};
+    ResponseCache::Shard &first = cache.add_shard();
+    ResponseCache::Shard &second = cache.add_shard();
+
+    first.insert("GET /users/1 HTTP/1.1 identity", "1", 1min);
+    first.insert("GET /posts/1 HTTP/1.1 identity", "1", 1min);
+    second.insert("HEAD /users/2 HTTP/1.1 gzip", "2", 1min);
+
+    // Keys start with the method, not the target.
+    EXPECT_EQ(cache.invalidate_prefix("/users/"), 0U);
+    EXPECT_EQ(cache.invalidate_target_prefix("/users/"), 2U);
+    EXPECT_EQ(first.find("GET /users/1 HTTP/1.1 identity"), nullptr);
+    EXPECT_EQ(second.find("HEAD /users/2 HTTP/1.1 gzip"), nullptr);
+    EXPECT_NE(first.find("GET /posts/1 HTTP/1.1 identity"), nullptr);
+
+    EXPECT_EQ(cache.invalidate_prefix("GET /posts/"), 1U);
+    EXPECT_EQ(cache.stats().invalidations, 3U);
+}
+
+TEST(ResponseCacheTest, RemovesShards) {
+    ResponseCache cache{1024};
+    ResponseCache::Shard &kept = cache.add_shard();
+    ResponseCache::Shard &removed = cache.add_shard();
+
+    kept.insert("GET /a HTTP/1.1 identity", "a", 1min);
+    removed.insert("GET /b HTTP/1.1 identity", "b", 1min);
+    cache.remove_shard(removed);
+
+    EXPECT_EQ(cache.stats().insertions, 1U);
+    EXPECT_EQ(cache.invalidate_target_prefix("/"), 1U);
+}
+
+} // namespace co_http_uring
@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <chrono>
 #include <coroutine>
+#include <memory_resource>
 #include <string_view>
 #include <thread>
 #include <variant>
@@ -39,7 +40,7 @@ Task<> handle_request(const Request &req, ResponseWriter res) {
     co_await res.write_status(StatusCode::OK);
 
     std::variant<std::string_view, Error> result = co_await req.body().read();
-    std::vector<char> buffer;
+    std::pmr::vector<char> buffer{req.memory_resource()};
 
     while (const auto *data = std::get_if<std::string_view>(&result)) {
         auto end_diff = buffer.cend() - buffer.cbegin();
@@ -68,7 +69,7 @@ TEST(ServerTest, ManualTest) {
         handle_request,
         static_cast<unsigned int>(4 * max_pending_conns + 2),
     };
-    server.run({INADDR_ANY, TEST_PORT}, max_pending_conns);
+    server.run(Ipv4Address{INADDR_ANY, TEST_PORT}, max_pending_conns);
 }
 
 } // namespace co_http_uring
@@ -0,0 +1,29 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CO_HTTP_URING_TEST_SYNC_AWAIT_HPP
+#define CO_HTTP_URING_TEST_SYNC_AWAIT_HPP
+
+#include "co_http_uring/task.hpp"
+
+#include <gtest/gtest.h>
+
+#include <utility>
+
+namespace co_http_uring::test {
+
+// Tasks under test that never wait on a ring have completed by the time their
+// initial call returns.
+template <typename T>
+T sync_await(Task<T> &&task) {
+    if (!task.await_ready()) {
+        ADD_FAILURE() << "task waits on a ring";
+        return T{};
+    }
+
+    return task.await_resume();
+}
+
+} // namespace co_http_uring::test
+
+#endif // CO_HTTP_URING_TEST_SYNC_AWAIT_HPP
@@ -0,0 +1,294 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "memory_connection.hpp"
+#include "sync_await.hpp"
+
+#include "co_http_uring/error.hpp"
+#include "co_http_uring/request.hpp"
+#include "co_http_uring/types.hpp"
+#include "co_http_uring/websocket.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace co_http_uring {
+
+namespace {
+
+using test::sync_await;
+
+// The masking key of the examples in RFC 6455, section 5.7.
+constexpr std::array<char, 4> MASKING_KEY{'\x37', '\xfa', '\x21', '\x3d'};
+
+constexpr u8 FIN = 0x80;
+constexpr u8 TEXT = 0x1;
+constexpr u8 BINARY = 0x2;
+constexpr u8 CONTINUATION = 0x0;
+constexpr u8 CLOSE = 0x8;
+constexpr u8 PING = 0x9;
+
+std::string make_frame(u8 first_byte, std::string_view payload, bool masked) {
+    std::string frame{static_cast<char>(first_byte)};
+    u8 mask_bit = masked ? 0x80 : 0;
+
+    if (payload.size() < 126) {
+        frame.push_back(static_cast<char>(mask_bit | payload.size()));
+    } else {
+        frame.push_back(static_cast<char>(mask_bit | 126));
+        frame.push_back(static_cast<char>(payload.size() >> 8));
+        frame.push_back(static_cast<char>(payload.size()));
+    }
+
+    if (!masked) {
+        return frame + std::string{payload};
+    }
+
+    frame.append(MASKING_KEY.data(), MASKING_KEY.size());
+
+    for (std::size_t i = 0; i < payload.size(); i++) {
+        frame.push_back(static_cast<char>(payload[i] ^ MASKING_KEY[i % 4]));
+    }
+
+    return frame;
+}
+
+// Clients must mask their frames.
+std::string client_frame(u8 first_byte, std::string_view payload) {
+    return make_frame(first_byte, payload, true);
+}
+
+std::string server_frame(u8 first_byte, std::string_view payload) {
+    return make_frame(first_byte, payload, false);
+}
+
+std::string close_payload(u16 code) {
+    return {static_cast<char>(code >> 8), static_cast<char>(code)};
+}
+
+} // namespace
+
+// A WebSocket over a connection that receives `connection_.input` and sends
+// to `connection_.output`.
+class WebSocketTest : public testing::Test {
+protected:
+    test::MemoryConnection connection_;
+
+    std::variant<WebSocketMessage, Error> receive(WebSocket &web_socket) {
+        return sync_await(web_socket.receive());
+    }
+
+    // Receives the only message of `connection_.input` as text.
+    std::variant<WebSocketMessage, Error> receive_text(std::string_view text) {
+        connection_.input.push_back(client_frame(FIN | TEXT, text));
+        WebSocket web_socket{connection_.reader, connection_.writer};
+        return receive(web_socket);
+    }
+};
+
+TEST(WebSocketAcceptKeyTest, MatchesRfc6455Example) {
+    // RFC 6455, section 1.3.
+    EXPECT_EQ(
+        WebSocket::make_accept_key("dGhlIHNhbXBsZSBub25jZQ=="),
+        "s3pPLMBiTxaQ9kYGzzhZRbK+xOo="
+    );
+}
+
+TEST_F(WebSocketTest, RecognizesUpgradeRequests) {
+    connection_.input.push_back(
+        "GET /chat HTTP/1.1\r\n"
+        "Host: server.example.com\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: keep-alive, Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n"
+        "GET /chat HTTP/1.1\r\n"
+        "Host: server.example.com\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n"
+    );
+
+    std::variant<Request, Error> upgrade =
+        sync_await(Request::receive(connection_.reader));
+    ASSERT_TRUE(std::holds_alternative<Request>(upgrade));
+    EXPECT_TRUE(WebSocket::is_upgrade_request(std::get<Request>(upgrade)));
+
+    std::variant<Request, Error> keyless =
+        sync_await(Request::receive(connection_.reader));
+    ASSERT_TRUE(std::holds_alternative<Request>(keyless));
+    EXPECT_FALSE(WebSocket::is_upgrade_request(std::get<Request>(keyless)));
+}
+
+TEST_F(WebSocketTest, ReceivesMaskedFrame) {
+    // RFC 6455, section 5.7.
+    connection_.input.push_back("\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58");
+    WebSocket web_socket{connection_.reader, connection_.writer};
+
+    std::variant<WebSocketMessage, Error> result = receive(web_socket);
+    ASSERT_TRUE(std::holds_alternative<WebSocketMessage>(result));
+    EXPECT_EQ(std::get<WebSocketMessage>(result).opcode, WebSocketOpcode::TEXT);
+    EXPECT_EQ(std::get<WebSocketMessage>(result).data, "Hello");
+}
+
+TEST_F(WebSocketTest, ReceivesFramesSplitAcrossReads) {
+    std::string payload(300, 'x');
+    std::string frame = client_frame(FIN | BINARY, payload);
+
+    for (char c : frame) {
+        connection_.input.emplace_back(1, c);
+    }
+
+    WebSocket web_socket{connection_.reader, connection_.writer};
+
+    std::variant<WebSocketMessage, Error> result = receive(web_socket);
+    ASSERT_TRUE(std::holds_alternative<WebSocketMessage>(result));
+    EXPECT_EQ(
+        std::get<WebSocketMessage>(result).opcode,
+        WebSocketOpcode::BINARY
+    );
+    EXPECT_EQ(std::get<WebSocketMessage>(result).data, payload);
+}
+
+TEST_F(WebSocketTest, JoinsFragmentsAndAnswersPingsBetweenThem) {
+    connection_.input.push_back(
+        client_frame(TEXT, "Hel") + client_frame(FIN | PING, "ping") +
+        client_frame(FIN | CONTINUATION, "lo") + client_frame(FIN | TEXT, "!")
+    );
+    WebSocket web_socket{connection_.reader, connection_.writer};
+
+    std::variant<WebSocketMessage, Error> result = receive(web_socket);
+    ASSERT_TRUE(std::holds_alternative<WebSocketMessage>(result));
+    EXPECT_EQ(std::get<WebSocketMessage>(result).data, "Hello");
+    EXPECT_EQ(connection_.output, server_frame(FIN | 0xa, "ping"));
+
+    result = receive(web_socket);
+    ASSERT_TRUE(std::holds_alternative<WebSocketMessage>(result));
+    EXPECT_EQ(std::get<WebSocketMessage>(result).data, "!");
+}
+
+TEST_F(WebSocketTest, EchoesCloseFrames) {
+    connection_.input.push_back(
+        client_frame(FIN | CLOSE, close_payload(1000) + "bye")
+    );
+    WebSocket web_socket{connection_.reader, connection_.writer};
+
+    EXPECT_EQ(
+        std::get<Error>(receive(web_socket)),
+        Error::CONNECTION_CLOSED
+    );
+    EXPECT_EQ(
+        connection_.output,
+        server_frame(FIN | CLOSE, close_payload(1000))
+    );
+    EXPECT_EQ(sync_await(web_socket.send("late")), Error::CONNECTION_CLOSED);
+}
+
+TEST_F(WebSocketTest, ClosesOnUnmaskedFrames) {
+    connection_.input.push_back(server_frame(FIN | TEXT, "Hello"));
+    WebSocket web_socket{connection_.reader, connection_.writer};
+
+    EXPECT_EQ(std::get<Error>(receive(web_socket)), Error::INVALID_REQUEST);
+    EXPECT_EQ(
+        connection_.output,
+        server_frame(FIN | CLOSE, close_payload(WebSocket::PROTOCOL_ERROR))
+    );
+}
+
+TEST_F(WebSocketTest, ClosesOnUnexpectedContinuation) {
+    connection_.input.push_back(client_frame(FIN | CONTINUATION, "Hello"));
+    WebSocket web_socket{connection_.reader, connection_.writer};
+
+    EXPECT_EQ(std::get<Error>(receive(web_socket)), Error::INVALID_REQUEST);
+    EXPECT_EQ(
+        connection_.output,
+        server_frame(FIN | CLOSE, close_payload(WebSocket::PROTOCOL_ERROR))
+    );
+}
+
+TEST_F(WebSocketTest, ClosesOnMessagesTooBig) {
+    connection_.input.push_back(
+        client_frame(TEXT, "Hel") + client_frame(FIN, "lo")
+    );
+    WebSocket web_socket{connection_.reader, connection_.writer, 4};
+
+    EXPECT_EQ(std::get<Error>(receive(web_socket)), Error::INVALID_REQUEST);
+    EXPECT_EQ(
+        connection_.output,
+        server_frame(FIN | CLOSE, close_payload(WebSocket::MESSAGE_TOO_BIG))
+    );
+}
+
+TEST_F(WebSocketTest, AcceptsValidUtf8) {
+    // Two, three and four-byte sequences, past the ASCII fast path.
+    std::string text =
+        "ASCII text, then h\xc3\xa9llo \xe2\x82\xac \xf0\x9d\x84\x9e";
+    std::variant<WebSocketMessage, Error> result = receive_text(text);
+
+    ASSERT_TRUE(std::holds_alternative<WebSocketMessage>(result));
+    EXPECT_EQ(std::get<WebSocketMessage>(result).data, text);
+}
+
+TEST_F(WebSocketTest, AcceptsUtf8SplitAcrossFragments) {
+    connection_.input.push_back(
+        client_frame(TEXT, "\xf0\x9d") + client_frame(FIN, "\x84\x9e")
+    );
+    WebSocket web_socket{connection_.reader, connection_.writer};
+
+    std::variant<WebSocketMessage, Error> result = receive(web_socket);
+    ASSERT_TRUE(std::holds_alternative<WebSocketMessage>(result));
+    EXPECT_EQ(std::get<WebSocketMessage>(result).data, "\xf0\x9d\x84\x9e");
+}
+
+TEST_F(WebSocketTest, RejectsInvalidUtf8) {
+    for (std::string_view text : {
+             "\x80",                  // Continuation byte first
+             "\xc0\xaf",              // Overlong encoding
+             "\xe2\x82",              // Truncated sequence
+             "\xed\xa0\x80",          // UTF-16 surrogate
+             "\xf4\x90\x80\x80",      // Past U+10FFFF
+             "\xff",                  // Never valid
+             "12345678\xe2\x28\xa1",  // Bad continuation after ASCII
+         }) {
+        SCOPED_TRACE(testing::PrintToString(text));
+        // What the last case left unread.
+        connection_.reader.consume(connection_.reader.buffered_size());
+        connection_.output.clear();
+
+        EXPECT_EQ(std::get<Error>(receive_text(text)), Error::INVALID_REQUEST);
+        EXPECT_EQ(
+            connection_.output,
+            server_frame(FIN | CLOSE, close_payload(WebSocket::INVALID_PAYLOAD))
+        );
+    }
+}
+
+TEST_F(WebSocketTest, AcceptsInvalidUtf8InBinaryMessages) {
+    connection_.input.push_back(client_frame(FIN | BINARY, "\xff\xfe"));
+    WebSocket web_socket{connection_.reader, connection_.writer};
+
+    std::variant<WebSocketMessage, Error> result = receive(web_socket);
+    ASSERT_TRUE(std::holds_alternative<WebSocketMessage>(result));
+    EXPECT_EQ(std::get<WebSocketMessage>(result).data, "\xff\xfe");
+}
+
+TEST_F(WebSocketTest, SendsUnmaskedFrames) {
+    WebSocket web_socket{connection_.reader, connection_.writer};
+    std::string payload(200, 'x');
+
+    EXPECT_FALSE(sync_await(web_socket.send("Hello")));
+    EXPECT_FALSE(sync_await(web_socket.send(payload, WebSocketOpcode::BINARY)));
+    EXPECT_EQ(
+        connection_.output,
+        server_frame(FIN | TEXT, "Hello") + server_frame(FIN | BINARY, payload)
+    );
+}
+
+} // namespace co_http_uring
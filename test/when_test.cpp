@@ -0,0 +1,204 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sync_await.hpp"
+
+#include "co_http_uring/when.hpp"
+
+#include "co_http_uring/request.hpp"
+#include "co_http_uring/response_writer.hpp"
+#include "co_http_uring/server.hpp"
+#include "co_http_uring/socket_address.hpp"
+#include "co_http_uring/task.hpp"
+#include "co_http_uring/timer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+extern "C" {
+#include <netinet/in.h>
+}
+
+using namespace std::literals::chrono_literals;
+
+namespace co_http_uring {
+
+namespace {
+
+using test::sync_await;
+
+Task<int> value(int n) {
+    co_return n;
+}
+
+Task<std::string> text(std::string s) {
+    co_return s;
+}
+
+Task<> nothing() {
+    co_return;
+}
+
+Task<int> fail() {
+    throw std::runtime_error{"failed"};
+    co_return 0;
+}
+
+Task<int> value_after(int n, std::chrono::nanoseconds duration) {
+    co_await sleep_for(duration);
+    co_return n;
+}
+
+// Resumes the awaiting coroutine on the thread that runs `server`.
+struct ScheduleOn {
+    Server &server;
+
+    [[nodiscard]] bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> coroutine) const {
+        server.schedule_remote(coroutine);
+    }
+
+    void await_resume() const {}
+};
+
+Task<> run_then_stop(Server &server, std::function<Task<>()> body) {
+    co_await ScheduleOn{server};
+    co_await body();
+    server.stop();
+}
+
+// Runs `body` on a server, for tasks that wait on its ring, and returns once
+// it has finished.
+void run_on_server(std::function<Task<>()> body) {
+    Server server{
+        [](const Request &, ResponseWriter) -> Task<> { co_return; },
+        16,
+    };
+    server.listen(Ipv4Address{INADDR_LOOPBACK, 0}, 1);
+    Task<> task = run_then_stop(server, std::move(body));
+    server.run();
+}
+
+} // namespace
+
+TEST(WhenTest, WhenAllReturnsEveryResult) {
+    auto [n, s, none] = sync_await(when_all(value(1), text("two"), nothing()));
+    EXPECT_EQ(n, 1);
+    EXPECT_EQ(s, "two");
+    EXPECT_EQ(none, std::monostate{});
+
+    std::vector<Task<int>> tasks;
+    tasks.push_back(value(1));
+    tasks.push_back(value(2));
+    tasks.push_back(value(3));
+    EXPECT_EQ(
+        sync_await(when_all(std::move(tasks))),
+        (std::vector<int>{1, 2, 3})
+    );
+    EXPECT_EQ(
+        sync_await(when_all(std::vector<Task<int>>{})),
+        std::vector<int>{}
+    );
+}
+
+TEST(WhenTest, WhenAnyReturnsFirstResult) {
+    std::variant<std::string, int> result =
+        sync_await(when_any(text("one"), value(2)));
+    EXPECT_EQ(result.index(), 0U);
+    EXPECT_EQ(std::get<0>(result), "one");
+
+    std::vector<Task<int>> tasks;
+    tasks.push_back(value(1));
+    tasks.push_back(value(2));
+    EXPECT_EQ(
+        sync_await(when_any(std::move(tasks))),
+        (std::pair<std::size_t, int>{0, 1})
+    );
+    EXPECT_EQ(
+        sync_await(when_any(std::vector<Task<int>>{})),
+        (std::pair<std::size_t, int>{0, 0})
+    );
+}
+
+TEST(WhenTest, RethrowsTaskExceptions) {
+    bool all_threw = false;
+    bool any_threw = false;
+
+    [&]() -> Task<> {
+        try {
+            co_await when_all(value(1), fail());
+        } catch (const std::runtime_error &) {
+            all_threw = true;
+        }
+
+        try {
+            co_await when_any(fail(), value(2));
+        } catch (const std::runtime_error &) {
+            any_threw = true;
+        }
+    }();
+
+    EXPECT_TRUE(all_threw);
+    EXPECT_TRUE(any_threw);
+}
+
+TEST(WhenTest, WhenAllRunsTasksConcurrently) {
+    std::tuple<int, int> result;
+    auto start = std::chrono::steady_clock::now();
+
+    run_on_server([&result]() -> Task<> {
+        result =
+            co_await when_all(value_after(1, 200ms), value_after(2, 200ms));
+    });
+
+    EXPECT_EQ(result, (std::tuple{1, 2}));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 390ms);
+}
+
+TEST(WhenTest, WhenAnyCancelsLosers) {
+    std::variant<int, int> result;
+    std::pair<std::size_t, int> vector_result;
+    auto start = std::chrono::steady_clock::now();
+
+    run_on_server([&result, &vector_result]() -> Task<> {
+        result = co_await when_any(value_after(1, 5s), value_after(2, 10ms));
+
+        std::vector<Task<int>> tasks;
+        tasks.push_back(value_after(1, 5s));
+        tasks.push_back(value_after(2, 5s));
+        tasks.push_back(value_after(3, 10ms));
+        vector_result = co_await when_any(std::move(tasks));
+    });
+
+    EXPECT_EQ(result.index(), 1U);
+    EXPECT_EQ(std::get<1>(result), 2);
+    EXPECT_EQ(vector_result, (std::pair<std::size_t, int>{2, 3}));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+
+TEST(WhenTest, WhenAnyCancelsTasksAddedAfterWinner) {
+    std::variant<int, int> result;
+    auto start = std::chrono::steady_clock::now();
+
+    // The first task finishes before the second starts.
+    run_on_server([&result]() -> Task<> {
+        result = co_await when_any(value(1), value_after(2, 5s));
+    });
+
+    EXPECT_EQ(result.index(), 0U);
+    EXPECT_EQ(std::get<0>(result), 1);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+
+} // namespace co_http_uring
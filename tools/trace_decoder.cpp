@@ -0,0 +1,285 @@
+// Copyright (C) 2022 OverMighty
+// SPDX-License-Identifier: Apache-2.0
+
+// Renders a dump written by co_http_uring::trace::dump() as a timeline per
+// connection, or as JSON for chrome://tracing and Perfetto.
+//
+// Usage: co_http_uring_trace [--chrome] <dump>
+
+#include <co_http_uring/trace.hpp>
+#include <co_http_uring/types.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace co_http_uring;
+
+namespace {
+
+using trace::Event;
+
+struct TimedRecord {
+    u32 thread;
+    i32 fixed_fd;
+    Event event;
+    // Since tracing started.
+    double us;
+};
+
+// Records of one connection, which starts at an accept of its fixed fd, or
+// at the start of the trace if the ring has wrapped since.
+struct Connection {
+    u32 thread;
+    i32 fixed_fd;
+    std::vector<TimedRecord> records;
+};
+
+struct FileCloser {
+    void operator()(std::FILE *file) const { std::fclose(file); }
+};
+
+template <typename T>
+bool read_value(std::FILE *file, T &value) {
+    return std::fread(&value, sizeof(value), 1, file) == 1;
+}
+
+std::optional<std::vector<TimedRecord>> read_dump(const char *path) {
+    std::unique_ptr<std::FILE, FileCloser> file{std::fopen(path, "rb")};
+
+    if (!file) {
+        fmt::print(stderr, "cannot open {}\n", path);
+        return {};
+    }
+
+    trace::FileHeader header{};
+
+    if (!read_value(file.get(), header) ||
+        header.magic != trace::FileHeader::MAGIC) {
+        fmt::print(stderr, "{} is not a co_http_uring trace\n", path);
+        return {};
+    }
+
+    // Timestamps are converted to time with the rate at which they advanced
+    // between the start of tracing and the dump.
+    double ns_per_tick = 1;
+
+    if (header.dump_timestamp > header.start_timestamp) {
+        ns_per_tick = static_cast<double>(header.dump_ns - header.start_ns) /
+            static_cast<double>(header.dump_timestamp - header.start_timestamp);
+    }
+
+    std::vector<TimedRecord> records;
+
+    for (u32 i = 0; i < header.thread_count; i++) {
+        trace::ThreadHeader thread_header{};
+
+        if (!read_value(file.get(), thread_header)) {
+            fmt::print(stderr, "{} is truncated\n", path);
+            return {};
+        }
+
+        for (u64 j = 0; j < thread_header.record_count; j++) {
+            trace::Record record{};
+
+            if (!read_value(file.get(), record)) {
+                fmt::print(stderr, "{} is truncated\n", path);
+                return {};
+            }
+
+            if (static_cast<std::size_t>(record.event) >= trace::EVENT_COUNT) {
+                continue;
+            }
+
+            // A record written before tracing started on another thread
+            // comes out negative rather than wrapping around.
+            double ticks = static_cast<double>(record.timestamp) -
+                static_cast<double>(header.start_timestamp);
+            records.push_back({
+                .thread = thread_header.thread,
+                .fixed_fd = record.fixed_fd,
+                .event = record.event,
+                .us = ticks * ns_per_tick / 1000,
+            });
+        }
+    }
+
+    return records;
+}
+
+std::vector<Connection> split_connections(
+    const std::vector<TimedRecord> &records
+) {
+    std::vector<Connection> connections;
+    std::map<std::pair<u32, i32>, std::size_t> current;
+
+    // Records of a thread are in order, and a fixed fd is only reused by a
+    // later accept.
+    for (const TimedRecord &record : records) {
+        auto key = std::pair{record.thread, record.fixed_fd};
+        auto it = current.find(key);
+
+        if (it == current.end() || record.event == Event::ACCEPT) {
+            connections.push_back({record.thread, record.fixed_fd, {}});
+            it = current.insert_or_assign(key, connections.size() - 1).first;
+        }
+
+        connections[it->second].records.push_back(record);
+    }
+
+    std::stable_sort(
+        connections.begin(),
+        connections.end(),
+        [](const Connection &a, const Connection &b) {
+            return a.records.front().us < b.records.front().us;
+        }
+    );
+    return connections;
+}
+
+void print_timeline(const std::vector<Connection> &connections) {
+    for (const Connection &conn : connections) {
+        fmt::print("thread {} fd {}", conn.thread, conn.fixed_fd);
+
+        if (conn.records.front().event != Event::ACCEPT) {
+            fmt::print(" (accepted before the trace)");
+        }
+
+        fmt::print("\n");
+        double previous_us = conn.records.front().us;
+
+        for (const TimedRecord &record : conn.records) {
+            fmt::print(
+                "  {:>14.3f} us  {:>+12.3f} us  {}\n",
+                record.us,
+                record.us - previous_us,
+                trace::event_name(record.event)
+            );
+            previous_us = record.us;
+        }
+
+        fmt::print("\n");
+    }
+}
+
+// The event that ends the span started by `event`, if it starts one.
+std::optional<Event> span_end(Event event) {
+    switch (event) {
+    case Event::RECV_SUBMIT: return Event::RECV_COMPLETE;
+    case Event::HANDLER_START: return Event::HANDLER_END;
+    case Event::SEND_SUBMIT: return Event::SEND_COMPLETE;
+    default: return {};
+    }
+}
+
+std::string_view span_name(Event start) {
+    switch (start) {
+    case Event::RECV_SUBMIT: return "recv";
+    case Event::HANDLER_START: return "handler";
+    default: return "send";
+    }
+}
+
+void print_chrome_trace(const std::vector<Connection> &connections) {
+    fmt::print("{{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+
+    auto print_event = [&first](std::string_view fields) {
+        fmt::print("{}\n{{{}}}", first ? "" : ",", fields);
+        first = false;
+    };
+
+    // Threads are processes and connections are threads, so that every
+    // connection gets a row of its own.
+    for (const Connection &conn : connections) {
+        std::vector<const TimedRecord *> open_spans;
+
+        for (const TimedRecord &record : conn.records) {
+            if (span_end(record.event)) {
+                open_spans.push_back(&record);
+                continue;
+            }
+
+            auto start = std::find_if(
+                open_spans.rbegin(),
+                open_spans.rend(),
+                [&record](const TimedRecord *span) {
+                    return span_end(span->event) == record.event;
+                }
+            );
+
+            if (start != open_spans.rend()) {
+                const TimedRecord &span = **start;
+                print_event(fmt::format(
+                    "\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},"
+                    "\"dur\":{:.3f},\"pid\":{},\"tid\":{}",
+                    span_name(span.event),
+                    span.us,
+                    record.us - span.us,
+                    conn.thread,
+                    conn.fixed_fd
+                ));
+                open_spans.erase(std::next(start).base());
+                continue;
+            }
+
+            print_event(fmt::format(
+                "\"name\":\"{}\",\"ph\":\"i\",\"s\":\"t\",\"ts\":{:.3f},"
+                "\"pid\":{},\"tid\":{}",
+                trace::event_name(record.event),
+                record.us,
+                conn.thread,
+                conn.fixed_fd
+            ));
+        }
+
+        // Spans still open when the trace was dumped.
+        for (const TimedRecord *span : open_spans) {
+            print_event(fmt::format(
+                "\"name\":\"{}\",\"ph\":\"B\",\"ts\":{:.3f},"
+                "\"pid\":{},\"tid\":{}",
+                span_name(span->event),
+                span->us,
+                conn.thread,
+                conn.fixed_fd
+            ));
+        }
+    }
+
+    fmt::print("\n]}}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    bool chrome = argc == 3 && std::string_view{argv[1]} == "--chrome";
+
+    if (argc != 2 && !chrome) {
+        fmt::print(stderr, "usage: {} [--chrome] <dump>\n", argv[0]);
+        return 2;
+    }
+
+    std::optional<std::vector<TimedRecord>> records = read_dump(argv[argc - 1]);
+
+    if (!records) {
+        return 1;
+    }
+
+    std::vector<Connection> connections = split_connections(*records);
+
+    if (chrome) {
+        print_chrome_trace(connections);
+    } else {
+        print_timeline(connections);
+    }
+
+    return 0;
+}